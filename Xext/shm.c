@@ -37,6 +37,10 @@ in this Software without prior written authorization from The Open Group.
 #include <sys/shm.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#ifdef SHM_FD_PASSING
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 #include <X11/X.h>
 #include <X11/Xproto.h>
 #include "misc.h"
@@ -54,6 +58,9 @@ in this Software without prior written authorization from The Open Group.
 #include <X11/extensions/shmproto.h>
 #include <X11/Xfuncproto.h>
 #include "protocol-versions.h"
+#include "busfault.h"
+#include "damage.h"
+#include "shmcaptureproto.h"
 
 /* Needed for Solaris cross-zone shared memory extension */
 #ifdef HAVE_SHMCTL64
@@ -89,6 +96,18 @@ in this Software without prior written authorization from The Open Group.
 
 #include "extinit.h"
 
+/* past this many boxes, the extents are copied in one go */
+#define SHM_CAPTURE_MAX_RECTS           32
+
+/* What the last SHM-CAPTURE GetImage put into a segment. */
+typedef struct _ShmCapture {
+    DamagePtr damage;           /* NULL once the drawable is gone */
+    DrawablePtr pDrawable;
+    int x, y;
+    unsigned int width, height;
+    unsigned long offset;
+} ShmCaptureRec, *ShmCapturePtr;
+
 typedef struct _ShmDesc {
     struct _ShmDesc *next;
     int shmid;
@@ -96,12 +115,19 @@ typedef struct _ShmDesc {
     char *addr;
     Bool writable;
     unsigned long size;
+    ShmCapturePtr capture;
+#ifdef SHM_FD_PASSING
+    Bool is_fd;                 /* mmap()ed file, not in Shmsegs */
+    struct busfault *busfault;
+    XID resource;               /* segment XID, None once detached */
+#endif
 } ShmDescRec, *ShmDescPtr;
 
 typedef struct _ShmScrPrivateRec {
     CloseScreenProcPtr CloseScreen;
     ShmFuncsPtr shmFuncs;
     DestroyPixmapProcPtr destroyPixmap;
+    Bool captureUntracked;      /* damage came too late for SHM-CAPTURE */
 } ShmScrPrivateRec;
 
 static PixmapPtr fbShmCreatePixmap(XSHM_CREATE_PIXMAP_ARGS);
@@ -377,6 +403,30 @@ shm_access(ClientPtr client, SHMPERM_TYPE * perm, int readonly)
     return (SHMPERM_MODE(perm) & mask) == mask ? 0 : -1;
 }
 
+static void
+ShmCaptureDamageDestroy(DamagePtr pDamage, void *closure)
+{
+    ShmCapturePtr capture = closure;
+
+    capture->damage = NULL;
+    capture->pDrawable = NULL;
+}
+
+static void
+ShmCaptureFree(ShmDescPtr shmdesc)
+{
+    ShmCapturePtr capture = shmdesc->capture;
+
+    if (!capture)
+        return;
+    if (capture->damage) {
+        DamageUnregister(capture->pDrawable, capture->damage);
+        DamageDestroy(capture->damage);
+    }
+    free(capture);
+    shmdesc->capture = NULL;
+}
+
 static int
 ProcShmAttach(ClientPtr client)
 {
@@ -423,6 +473,12 @@ ProcShmAttach(ClientPtr client)
         shmdesc->refcnt = 1;
         shmdesc->writable = !stuff->readOnly;
         shmdesc->size = SHM_SEGSZ(buf);
+        shmdesc->capture = NULL;
+#ifdef SHM_FD_PASSING
+        shmdesc->is_fd = FALSE;
+        shmdesc->busfault = NULL;
+        shmdesc->resource = None;
+#endif
         shmdesc->next = Shmsegs;
         Shmsegs = shmdesc;
     }
@@ -438,8 +494,22 @@ ShmDetachSegment(pointer value, /* must conform to DeleteType */
     ShmDescPtr shmdesc = (ShmDescPtr) value;
     ShmDescPtr *prev;
 
+#ifdef SHM_FD_PASSING
+    if (shmseg == shmdesc->resource)
+        shmdesc->resource = None;
+#endif
     if (--shmdesc->refcnt)
         return TRUE;
+    ShmCaptureFree(shmdesc);
+#ifdef SHM_FD_PASSING
+    if (shmdesc->is_fd) {
+        if (shmdesc->busfault)
+            busfault_unregister(shmdesc->busfault);
+        munmap(shmdesc->addr, shmdesc->size);
+        free(shmdesc);
+        return Success;
+    }
+#endif
     shmdt(shmdesc->addr);
     for (prev = &Shmsegs; *prev != shmdesc; prev = &(*prev)->next);
     *prev = shmdesc->next;
@@ -676,6 +746,8 @@ ProcShmGetImage(ClientPtr client)
 
     VERIFY_SHMSIZE(shmdesc, stuff->offset, length, client);
     xgi.size = length;
+    /* whatever was captured there may be overwritten now */
+    ShmCaptureFree(shmdesc);
 
     if (length == 0) {
         /* nothing to do */
@@ -712,6 +784,237 @@ ProcShmGetImage(ClientPtr client)
     return Success;
 }
 
+/*
+ * Find the capture record matching this request, or start a new one;
+ * *fresh is set when nothing of the area is in the segment yet.
+ */
+static ShmCapturePtr
+ShmCaptureLookup(ShmDescPtr shmdesc, DrawablePtr pDraw,
+                 xShmCaptureGetImageReq * stuff, Bool *fresh)
+{
+    ScreenPtr pScreen = pDraw->pScreen;
+    ShmScrPrivateRec *screen_priv = ShmGetScreenPriv(pScreen);
+    ShmCapturePtr capture = shmdesc->capture;
+    CreateGCProcPtr CreateGC = pScreen->CreateGC;
+
+    *fresh = FALSE;
+    if (capture && capture->pDrawable == pDraw &&
+        capture->x == stuff->x && capture->y == stuff->y &&
+        capture->width == stuff->width && capture->height == stuff->height &&
+        capture->offset == stuff->offset)
+        return capture;
+
+    ShmCaptureFree(shmdesc);
+    *fresh = TRUE;
+    /*
+     * Damage is normally set up at startup, by the DAMAGE extension or
+     * the software cursor.  If it is only set up here, it misses the
+     * drawing through GCs created before, and every capture on this
+     * screen has to copy everything.
+     */
+    if (!DamageSetup(pScreen))
+        return NULL;
+    if (pScreen->CreateGC != CreateGC)
+        screen_priv->captureUntracked = TRUE;
+    if (screen_priv->captureUntracked)
+        return NULL;
+    capture = malloc(sizeof(ShmCaptureRec));
+    if (!capture)
+        return NULL;
+    capture->damage = DamageCreate(NULL, ShmCaptureDamageDestroy,
+                                   DamageReportNone, FALSE, pDraw->pScreen,
+                                   capture);
+    if (!capture->damage) {
+        free(capture);
+        return NULL;
+    }
+    DamageRegister(pDraw, capture->damage);
+    capture->pDrawable = pDraw;
+    capture->x = stuff->x;
+    capture->y = stuff->y;
+    capture->width = stuff->width;
+    capture->height = stuff->height;
+    capture->offset = stuff->offset;
+    shmdesc->capture = capture;
+    return capture;
+}
+
+static int
+ProcShmCaptureQueryVersion(ClientPtr client)
+{
+    xShmCaptureQueryVersionReply rep = {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+        .majorVersion = SERVER_SHM_CAPTURE_MAJOR_VERSION,
+        .minorVersion = SERVER_SHM_CAPTURE_MINOR_VERSION
+    };
+
+    REQUEST_SIZE_MATCH(xShmCaptureQueryVersionReq);
+
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swaps(&rep.majorVersion);
+        swaps(&rep.minorVersion);
+    }
+    WriteToClient(client, sizeof(xShmCaptureQueryVersionReply), &rep);
+    return Success;
+}
+
+static int
+ProcShmCaptureGetImage(ClientPtr client)
+{
+    DrawablePtr pDraw;
+    ShmDescPtr shmdesc;
+    ShmCapturePtr capture;
+    PixmapPtr pPixmap;
+    GCPtr pGC;
+    ChangeGCVal subWindowMode;
+    xShmCaptureGetImageReply rep;
+    RegionRec region;
+    BoxRec box, *pBox;
+    xRectangle *rects;
+    long length;
+    Mask plane;
+    int nRects, i, rc;
+    Bool fresh;
+
+    REQUEST(xShmCaptureGetImageReq);
+
+    REQUEST_SIZE_MATCH(xShmCaptureGetImageReq);
+    if (stuff->format != ZPixmap) {
+        client->errorValue = stuff->format;
+        return BadValue;
+    }
+    rc = dixLookupDrawable(&pDraw, stuff->drawable, client, 0, DixReadAccess);
+    if (rc != Success)
+        return rc;
+    VERIFY_SHMPTR(stuff->shmseg, stuff->offset, TRUE, shmdesc, client);
+    if (pDraw->type == DRAWABLE_WINDOW) {
+        if (!((WindowPtr) pDraw)->realized ||
+            pDraw->x + stuff->x < 0 ||
+            pDraw->x + stuff->x + (int) stuff->width > pDraw->pScreen->width
+            || pDraw->y + stuff->y < 0 ||
+            pDraw->y + stuff->y + (int) stuff->height >
+            pDraw->pScreen->height ||
+            stuff->x < -wBorderWidth((WindowPtr) pDraw) ||
+            stuff->x + (int) stuff->width >
+            wBorderWidth((WindowPtr) pDraw) + (int) pDraw->width ||
+            stuff->y < -wBorderWidth((WindowPtr) pDraw) ||
+            stuff->y + (int) stuff->height >
+            wBorderWidth((WindowPtr) pDraw) + (int) pDraw->height)
+            return BadMatch;
+    }
+    else {
+        if (stuff->x < 0 ||
+            stuff->x + (int) stuff->width > pDraw->width ||
+            stuff->y < 0 || stuff->y + (int) stuff->height > pDraw->height)
+            return BadMatch;
+    }
+    /* planes left out would have to be cleared on every capture */
+    plane = ((Mask) 1) << (pDraw->depth - 1);
+    if ((stuff->planeMask & (plane | (plane - 1))) != (plane | (plane - 1)))
+        return BadMatch;
+
+    length = PixmapBytePad(stuff->width, pDraw->depth) * stuff->height;
+    VERIFY_SHMSIZE(shmdesc, stuff->offset, length, client);
+
+    /* what changed in the area since the last capture, in image
+     * coordinates */
+    box.x1 = 0;
+    box.y1 = 0;
+    box.x2 = stuff->width;
+    box.y2 = stuff->height;
+    RegionInit(&region, &box, 1);
+    capture = ShmCaptureLookup(shmdesc, pDraw, stuff, &fresh);
+    if (capture && !fresh) {
+        RegionTranslate(&region, stuff->x, stuff->y);
+        RegionIntersect(&region, &region, DamageRegion(capture->damage));
+        RegionTranslate(&region, -stuff->x, -stuff->y);
+    }
+    if (capture)
+        DamageEmpty(capture->damage);
+    if (RegionNumRects(&region) > SHM_CAPTURE_MAX_RECTS) {
+        box = *RegionExtents(&region);
+        RegionReset(&region, &box);
+    }
+    nRects = RegionNumRects(&region);
+
+    if (nRects && length) {
+        pPixmap = GetScratchPixmapHeader(pDraw->pScreen, stuff->width,
+                                         stuff->height, pDraw->depth,
+                                         BitsPerPixel(pDraw->depth),
+                                         PixmapBytePad(stuff->width,
+                                                       pDraw->depth),
+                                         shmdesc->addr + stuff->offset);
+        pGC = GetScratchGC(pDraw->depth, pDraw->pScreen);
+        if (!pPixmap || !pGC) {
+            if (pPixmap)
+                FreeScratchPixmapHeader(pPixmap);
+            if (pGC)
+                FreeScratchGC(pGC);
+            RegionUninit(&region);
+            ShmCaptureFree(shmdesc);
+            return BadAlloc;
+        }
+        subWindowMode.val = IncludeInferiors;
+        ChangeGC(NullClient, pGC, GCSubwindowMode, &subWindowMode);
+        ValidateGC(&pPixmap->drawable, pGC);
+        pBox = RegionRects(&region);
+        for (i = 0; i < nRects; i++, pBox++)
+            (*pGC->ops->CopyArea) (pDraw, &pPixmap->drawable, pGC,
+                                   stuff->x + pBox->x1, stuff->y + pBox->y1,
+                                   pBox->x2 - pBox->x1, pBox->y2 - pBox->y1,
+                                   pBox->x1, pBox->y1);
+        FreeScratchGC(pGC);
+        FreeScratchPixmapHeader(pPixmap);
+    }
+
+    rects = NULL;
+    if (nRects) {
+        rects = malloc(nRects * sizeof(xRectangle));
+        if (!rects) {
+            RegionUninit(&region);
+            /* the client cannot tell what changed, start over */
+            ShmCaptureFree(shmdesc);
+            return BadAlloc;
+        }
+    }
+    pBox = RegionRects(&region);
+    for (i = 0; i < nRects; i++, pBox++) {
+        rects[i].x = pBox->x1;
+        rects[i].y = pBox->y1;
+        rects[i].width = pBox->x2 - pBox->x1;
+        rects[i].height = pBox->y2 - pBox->y1;
+    }
+    RegionUninit(&region);
+
+    rep = (xShmCaptureGetImageReply) {
+        .type = X_Reply,
+        .depth = pDraw->depth,
+        .sequenceNumber = client->sequence,
+        .length = nRects * (sizeof(xRectangle) >> 2),
+        .visual = pDraw->type == DRAWABLE_WINDOW ?
+            wVisual((WindowPtr) pDraw) : None,
+        .size = length,
+        .nRects = nRects,
+    };
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swapl(&rep.visual);
+        swapl(&rep.size);
+        swapl(&rep.nRects);
+        SwapShorts((short *) rects, nRects * 4);
+    }
+    WriteToClient(client, sizeof(xShmCaptureGetImageReply), &rep);
+    if (nRects)
+        WriteToClient(client, nRects * sizeof(xRectangle), rects);
+    free(rects);
+    return Success;
+}
+
 #ifdef PANORAMIX
 static int
 ProcPanoramiXShmPutImage(ClientPtr client)
@@ -1096,6 +1399,194 @@ ProcShmCreatePixmap(ClientPtr client)
     return BadAlloc;
 }
 
+#ifdef SHM_FD_PASSING
+
+/*
+ * The client truncated the file behind an fd segment; busfault has already
+ * papered over the mapping with zeroes, so drop the segment before anyone
+ * else renders from it.
+ */
+static void
+ShmBusfaultNotify(void *context)
+{
+    ShmDescPtr shmdesc = context;
+
+    LogMessage(X_WARNING, "MIT-SHM: segment 0x%lx truncated by its client\n",
+               (unsigned long) shmdesc->resource);
+    busfault_unregister(shmdesc->busfault);
+    shmdesc->busfault = NULL;
+    if (shmdesc->resource != None)
+        FreeResource(shmdesc->resource, RT_NONE);
+}
+
+/*
+ * Wrap an mmap()ed file in a segment and register it as shmseg.  The
+ * mapping is owned by the segment from here on, even on failure.
+ */
+static int
+ShmAddFdSegment(XID shmseg, char *addr, unsigned long size, Bool readOnly)
+{
+    ShmDescPtr shmdesc;
+
+    shmdesc = malloc(sizeof(ShmDescRec));
+    if (!shmdesc) {
+        munmap(addr, size);
+        return BadAlloc;
+    }
+    shmdesc->next = NULL;
+    shmdesc->shmid = -1;
+    shmdesc->refcnt = 1;
+    shmdesc->addr = addr;
+    shmdesc->writable = !readOnly;
+    shmdesc->size = size;
+    shmdesc->capture = NULL;
+    shmdesc->is_fd = TRUE;
+    shmdesc->resource = shmseg;
+    shmdesc->busfault = busfault_register_mmap(addr, size,
+                                               ShmBusfaultNotify, shmdesc);
+    if (!shmdesc->busfault) {
+        munmap(addr, size);
+        free(shmdesc);
+        return BadAlloc;
+    }
+    if (!AddResource(shmseg, ShmSegType, (pointer) shmdesc))
+        return BadAlloc;
+    return Success;
+}
+
+static int
+doShmAttachFd(ClientPtr client, int fd)
+{
+    struct stat statb;
+    char *addr;
+
+    REQUEST(xShmAttachFdReq);
+
+    REQUEST_SIZE_MATCH(xShmAttachFdReq);
+    LEGAL_NEW_RESOURCE(stuff->shmseg, client);
+    if ((stuff->readOnly != xTrue) && (stuff->readOnly != xFalse)) {
+        client->errorValue = stuff->readOnly;
+        return BadValue;
+    }
+    if (fstat(fd, &statb) < 0 || statb.st_size <= 0)
+        return BadMatch;
+    addr = mmap(NULL, statb.st_size,
+                stuff->readOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+        return BadAccess;
+    return ShmAddFdSegment(stuff->shmseg, addr, statb.st_size,
+                           stuff->readOnly);
+}
+
+static int
+ProcShmAttachFd(ClientPtr client)
+{
+    int fd, rc;
+
+    /* Take the fd before any error can be returned, or it would be left
+     * queued for the next fd-passing request. */
+    fd = ReadFdFromClient(client);
+    if (fd < 0)
+        return BadMatch;
+    rc = doShmAttachFd(client, fd);
+    close(fd);
+    return rc;
+}
+
+/*
+ * Create an anonymous file of the given size to back a server-allocated
+ * segment.  Where the kernel supports sealing, the client is prevented
+ * from shrinking it underneath the server.
+ */
+static int
+ShmCreateFile(unsigned long size)
+{
+    int fd;
+
+#ifdef HAVE_MEMFD_CREATE
+    fd = memfd_create("xorg-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    static const char *const dirs[] = { "/dev/shm", "/tmp" };
+    char template[PATH_MAX];
+    int i;
+
+    fd = -1;
+    for (i = 0; fd < 0 && i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(template, sizeof(template), "%s/xorg-shm-XXXXXX", dirs[i]);
+        fd = mkstemp(template);
+        if (fd >= 0) {
+            unlink(template);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+#endif
+    if (fd < 0)
+        return -1;
+    if (ftruncate(fd, size) < 0) {
+        close(fd);
+        return -1;
+    }
+#if defined(HAVE_MEMFD_CREATE) && defined(F_SEAL_SHRINK)
+    (void) fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL);
+#endif
+    return fd;
+}
+
+static int
+ProcShmCreateSegment(ClientPtr client)
+{
+    int fd, rc;
+    char *addr;
+    xShmCreateSegmentReply rep = {
+        .type = X_Reply,
+        .nfd = 1,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+    };
+
+    REQUEST(xShmCreateSegmentReq);
+
+    REQUEST_SIZE_MATCH(xShmCreateSegmentReq);
+    LEGAL_NEW_RESOURCE(stuff->shmseg, client);
+    if ((stuff->readOnly != xTrue) && (stuff->readOnly != xFalse)) {
+        client->errorValue = stuff->readOnly;
+        return BadValue;
+    }
+    if (stuff->size == 0) {
+        client->errorValue = 0;
+        return BadValue;
+    }
+    fd = ShmCreateFile(stuff->size);
+    if (fd < 0)
+        return BadAlloc;
+    addr = mmap(NULL, stuff->size,
+                stuff->readOnly ? PROT_READ : PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return BadAlloc;
+    }
+    rc = ShmAddFdSegment(stuff->shmseg, addr, stuff->size, stuff->readOnly);
+    if (rc != Success) {
+        close(fd);
+        return rc;
+    }
+    /* the fd goes out with the reply and is closed once it has been sent */
+    if (WriteFdToClient(client, fd, TRUE) < 0) {
+        FreeResource(stuff->shmseg, RT_NONE);
+        close(fd);
+        return BadAlloc;
+    }
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+    }
+    WriteToClient(client, sizeof(rep), &rep);
+    return Success;
+}
+#endif                          /* SHM_FD_PASSING */
+
 static int
 ProcShmDispatch(ClientPtr client)
 {
@@ -1125,6 +1616,12 @@ ProcShmDispatch(ClientPtr client)
             return ProcPanoramiXShmCreatePixmap(client);
 #endif
         return ProcShmCreatePixmap(client);
+#ifdef SHM_FD_PASSING
+    case X_ShmAttachFd:
+        return ProcShmAttachFd(client);
+    case X_ShmCreateSegment:
+        return ProcShmCreateSegment(client);
+#endif
     default:
         return BadRequest;
     }
@@ -1225,6 +1722,30 @@ SProcShmCreatePixmap(ClientPtr client)
     return ProcShmCreatePixmap(client);
 }
 
+#ifdef SHM_FD_PASSING
+static int
+SProcShmAttachFd(ClientPtr client)
+{
+    REQUEST(xShmAttachFdReq);
+    swaps(&stuff->length);
+    /* ProcShmAttachFd checks the size once it has taken the fd */
+    if (client->req_len == bytes_to_int32(sizeof(xShmAttachFdReq)))
+        swapl(&stuff->shmseg);
+    return ProcShmAttachFd(client);
+}
+
+static int
+SProcShmCreateSegment(ClientPtr client)
+{
+    REQUEST(xShmCreateSegmentReq);
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xShmCreateSegmentReq);
+    swapl(&stuff->shmseg);
+    swapl(&stuff->size);
+    return ProcShmCreateSegment(client);
+}
+#endif
+
 static int
 SProcShmDispatch(ClientPtr client)
 {
@@ -1242,6 +1763,66 @@ SProcShmDispatch(ClientPtr client)
         return SProcShmGetImage(client);
     case X_ShmCreatePixmap:
         return SProcShmCreatePixmap(client);
+#ifdef SHM_FD_PASSING
+    case X_ShmAttachFd:
+        return SProcShmAttachFd(client);
+    case X_ShmCreateSegment:
+        return SProcShmCreateSegment(client);
+#endif
+    default:
+        return BadRequest;
+    }
+}
+
+static int
+ProcShmCaptureDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_ShmCaptureQueryVersion:
+        return ProcShmCaptureQueryVersion(client);
+    case X_ShmCaptureGetImage:
+        return ProcShmCaptureGetImage(client);
+    default:
+        return BadRequest;
+    }
+}
+
+static int
+SProcShmCaptureQueryVersion(ClientPtr client)
+{
+    REQUEST(xShmCaptureQueryVersionReq);
+
+    swaps(&stuff->length);
+    return ProcShmCaptureQueryVersion(client);
+}
+
+static int
+SProcShmCaptureGetImage(ClientPtr client)
+{
+    REQUEST(xShmCaptureGetImageReq);
+    swaps(&stuff->length);
+    REQUEST_SIZE_MATCH(xShmCaptureGetImageReq);
+    swapl(&stuff->drawable);
+    swaps(&stuff->x);
+    swaps(&stuff->y);
+    swaps(&stuff->width);
+    swaps(&stuff->height);
+    swapl(&stuff->planeMask);
+    swapl(&stuff->shmseg);
+    swapl(&stuff->offset);
+    return ProcShmCaptureGetImage(client);
+}
+
+static int
+SProcShmCaptureDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_ShmCaptureQueryVersion:
+        return SProcShmCaptureQueryVersion(client);
+    case X_ShmCaptureGetImage:
+        return SProcShmCaptureGetImage(client);
     default:
         return BadRequest;
     }
@@ -1293,5 +1874,8 @@ ShmExtensionInit(void)
         BadShmSegCode = extEntry->errorBase;
         SetResourceTypeErrorValue(ShmSegType, BadShmSegCode);
         EventSwapVector[ShmCompletionCode] = (EventSwapPtr) SShmCompletionEvent;
+        AddExtension(SHMCAPTURE_NAME, 0, 0,
+                     ProcShmCaptureDispatch, SProcShmCaptureDispatch,
+                     NULL, StandardMinorOpcode);
     }
 }
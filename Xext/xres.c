@@ -18,6 +18,8 @@
 #include "swaprep.h"
 #include "registry.h"
 #include <X11/extensions/XResproto.h>
+#include "clientstatsproto.h"
+#include "xace.h"
 #include "pixmapstr.h"
 #include "windowstr.h"
 #include "gcstruct.h"
@@ -1077,6 +1079,175 @@ ProcXResQueryResourceBytes (ClientPtr client)
     return rc;
 }
 
+static CARD32 *
+PutStatsValue(CARD32 *p, CARD64 value)
+{
+    *p++ = value & 0xffffffff;
+    *p++ = value >> 32;
+    return p;
+}
+
+static int
+ProcClientStatsQueryVersion(ClientPtr client)
+{
+    xClientStatsQueryVersionReply rep = {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = 0,
+        .majorVersion = SERVER_CLIENT_STATS_MAJOR_VERSION,
+        .minorVersion = SERVER_CLIENT_STATS_MINOR_VERSION
+    };
+
+    REQUEST_SIZE_MATCH(xClientStatsQueryVersionReq);
+
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swaps(&rep.majorVersion);
+        swaps(&rep.minorVersion);
+    }
+    WriteToClient(client, sizeof(xClientStatsQueryVersionReply), &rep);
+    return Success;
+}
+
+static int
+ProcClientStatsQueryClientStats(ClientPtr client)
+{
+    REQUEST(xClientStatsQueryClientStatsReq);
+    xClientStatsQueryClientStatsReply rep;
+    ClientPtr aboutClient;
+    ClientStatsPtr stats;
+    ClientIOStatsRec io;
+    CARD32 *body, *p;
+    int num_ops, i, len, rc;
+
+    REQUEST_SIZE_MATCH(xClientStatsQueryClientStatsReq);
+
+    if (stuff->xid == None)
+        aboutClient = client;
+    else {
+        rc = dixLookupClient(&aboutClient, stuff->xid, client,
+                             DixGetAttrAccess);
+        if (rc != Success)
+            return rc;
+    }
+    if (!aboutClient->clientStats) {
+        client->errorValue = stuff->xid;
+        return BadValue;
+    }
+    stats = aboutClient->clientStats;
+
+    num_ops = 0;
+    for (i = 0; i < 256; i++)
+        if (stats->ops[i].count)
+            num_ops++;
+
+    len = CLIENTSTATS_TOTALS * 2 + CLIENT_STATS_BUCKETS +
+        num_ops * bytes_to_int32(sz_xClientStatsOpStats);
+    body = malloc(len * sizeof(CARD32));
+    if (!body)
+        return BadAlloc;
+
+    GetClientIOStats(aboutClient, &io);
+    p = PutStatsValue(body, stats->micros);
+    p = PutStatsValue(p, io.inputBytes);
+    p = PutStatsValue(p, io.inputReads);
+    p = PutStatsValue(p, io.outputBytes);
+    p = PutStatsValue(p, io.outputWrites);
+    p = PutStatsValue(p, io.outputBlockedMicros);
+    for (i = 0; i < CLIENT_STATS_BUCKETS; i++)
+        *p++ = stats->histogram[i];
+    for (i = 0; i < 256; i++) {
+        if (!stats->ops[i].count)
+            continue;
+        *p++ = i;
+        *p++ = stats->ops[i].count;
+        p = PutStatsValue(p, stats->ops[i].micros);
+    }
+
+    rep = (xClientStatsQueryClientStatsReply) {
+        .type = X_Reply,
+        .sequenceNumber = client->sequence,
+        .length = len,
+        .requests = stats->requests,
+        .num_buckets = CLIENT_STATS_BUCKETS,
+        .num_ops = num_ops,
+        .weight = aboutClient->smart_weight
+    };
+    if (client->swapped) {
+        swaps(&rep.sequenceNumber);
+        swapl(&rep.length);
+        swapl(&rep.requests);
+        swapl(&rep.num_buckets);
+        swapl(&rep.num_ops);
+        swapl(&rep.weight);
+        SwapLongs(body, len);
+    }
+    WriteToClient(client, sizeof(xClientStatsQueryClientStatsReply), &rep);
+    WriteToClient(client, len * sizeof(CARD32), body);
+    free(body);
+
+    return Success;
+}
+
+static int
+ProcClientStatsSetClientWeight(ClientPtr client)
+{
+    REQUEST(xClientStatsSetClientWeightReq);
+    ClientPtr weightClient;
+    int rc;
+
+    REQUEST_SIZE_MATCH(xClientStatsSetClientWeightReq);
+
+    if (stuff->weight < SMART_MIN_WEIGHT || stuff->weight > SMART_MAX_WEIGHT) {
+        client->errorValue = stuff->weight;
+        return BadValue;
+    }
+
+    if (stuff->xid == None)
+        weightClient = client;
+    else {
+        rc = dixLookupClient(&weightClient, stuff->xid, client,
+                             DixSetAttrAccess);
+        if (rc != Success)
+            return rc;
+    }
+
+    /* Without a security module every lookup succeeds, so other
+     * clients are off limits unless the server was told otherwise. */
+    if (weightClient != client) {
+        if (!SmartScheduleOtherWeights || !client->local)
+            return BadAccess;
+        rc = XaceHook(XACE_SERVER_ACCESS, client, DixManageAccess);
+        if (rc != Success)
+            return rc;
+    }
+    /* a higher weight takes scheduler time from every other client */
+    else if (stuff->weight > client->smart_weight &&
+             stuff->weight > SMART_DEFAULT_WEIGHT)
+        return BadAccess;
+
+    weightClient->smart_weight = stuff->weight;
+    return Success;
+}
+
+static int
+ProcClientStatsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    switch (stuff->data) {
+    case X_ClientStatsQueryVersion:
+        return ProcClientStatsQueryVersion(client);
+    case X_ClientStatsQueryClientStats:
+        return ProcClientStatsQueryClientStats(client);
+    case X_ClientStatsSetClientWeight:
+        return ProcClientStatsSetClientWeight(client);
+    default: break;
+    }
+
+    return BadRequest;
+}
+
 static int
 ProcResDispatch(ClientPtr client)
 {
@@ -1183,10 +1354,52 @@ SProcResDispatch (ClientPtr client)
     return BadRequest;
 }
 
+static int
+SProcClientStatsQueryClientStats(ClientPtr client)
+{
+    REQUEST(xClientStatsQueryClientStatsReq);
+    REQUEST_SIZE_MATCH(xClientStatsQueryClientStatsReq);
+    swapl(&stuff->xid);
+    return ProcClientStatsQueryClientStats(client);
+}
+
+static int
+SProcClientStatsSetClientWeight(ClientPtr client)
+{
+    REQUEST(xClientStatsSetClientWeightReq);
+    REQUEST_SIZE_MATCH(xClientStatsSetClientWeightReq);
+    swapl(&stuff->xid);
+    swapl(&stuff->weight);
+    return ProcClientStatsSetClientWeight(client);
+}
+
+static int
+SProcClientStatsDispatch(ClientPtr client)
+{
+    REQUEST(xReq);
+    swaps(&stuff->length);
+
+    switch (stuff->data) {
+    case X_ClientStatsQueryVersion:    /* nothing to swap */
+        return ProcClientStatsQueryVersion(client);
+    case X_ClientStatsQueryClientStats:
+        return SProcClientStatsQueryClientStats(client);
+    case X_ClientStatsSetClientWeight:
+        return SProcClientStatsSetClientWeight(client);
+    default: break;
+    }
+
+    return BadRequest;
+}
+
 void
 ResExtensionInit(void)
 {
     (void) AddExtension(XRES_NAME, 0, 0,
                         ProcResDispatch, SProcResDispatch,
                         NULL, StandardMinorOpcode);
+    /* the statistics are not X-Resource protocol, keep them apart */
+    (void) AddExtension(CLIENTSTATS_NAME, 0, 0,
+                        ProcClientStatsDispatch, SProcClientStatsDispatch,
+                        NULL, StandardMinorOpcode);
 }
@@ -93,10 +93,12 @@ DeleteDeviceEvents(DeviceIntPtr dev, WindowPtr pWin, ClientPtr client)
     OtherInputMasks *pOthers;
     GrabPtr grab, next;
 
-    if ((pOthers = wOtherInputMasks(pWin)) != 0)
+    if ((pOthers = wOtherInputMasks(pWin)) != 0) {
         for (others = pOthers->inputClients; others; others = others->next)
             if (SameClient(others, client))
                 others->mask[dev->id] = NoEventMask;
+        InvalidateEventRecipients();
+    }
 
     for (grab = wPassiveGrabs(pWin); grab; grab = next) {
         next = grab->next;
@@ -2491,6 +2491,8 @@ RecalculateDeviceDeliverableEvents(WindowPtr pWin)
     WindowPtr pChild, tmp;
     int i;
 
+    InvalidateEventRecipients();
+
     pChild = pWin;
     while (1) {
         if ((inputMasks = wOtherInputMasks(pChild)) != 0) {
@@ -1195,11 +1195,15 @@ AssignTypeAndName(DeviceIntPtr dev, Atom type, const char *name)
 static void
 MakeDeviceTypeAtoms(void)
 {
+    const char *names[NUMTYPES];
+    Atom atoms[NUMTYPES];
     int i;
 
     for (i = 0; i < NUMTYPES; i++)
-        dev_type[i].type =
-            MakeAtom(dev_type[i].name, strlen(dev_type[i].name), 1);
+        names[i] = dev_type[i].name;
+    MakeAtoms(names, NUMTYPES, TRUE, atoms);
+    for (i = 0; i < NUMTYPES; i++)
+        dev_type[i].type = atoms[i];
 }
 
 /*****************************************************************************
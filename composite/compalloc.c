@@ -184,6 +184,7 @@ compRedirectWindow(ClientPtr pClient, WindowPtr pWin, int update)
             free(cw);
             return BadAlloc;
         }
+        DamageSetAccumulate(cw->damage, 0, 0);
 
         anyMarked = compMarkWindows(pWin, &pLayerWin);
 
@@ -272,6 +273,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
     Bool anyMarked = FALSE;
     WindowPtr pLayerWin;
     PixmapPtr pPixmap = NULL;
+    int pixmapWidth = 0, pixmapHeight = 0;
 
     if (!cw)
         return;
@@ -289,6 +291,8 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
         if (pWin->redirectDraw != RedirectDrawNone) {
             pPixmap = (*pScreen->GetWindowPixmap) (pWin);
+            pixmapWidth = cw->pixmapWidth;
+            pixmapHeight = cw->pixmapHeight;
             compSetParentPixmap(pWin);
         }
 
@@ -315,7 +319,7 @@ compFreeClientWindow(WindowPtr pWin, XID id)
 
     if (pPixmap) {
         compRestoreWindow(pWin, pPixmap);
-        (*pScreen->DestroyPixmap) (pPixmap);
+        compPoolPutPixmap(pScreen, pPixmap, pixmapWidth, pixmapHeight);
     }
 }
 
@@ -543,14 +547,14 @@ compUnredirectOneSubwindow(WindowPtr pParent, WindowPtr pWin)
 }
 
 static PixmapPtr
-compNewPixmap(WindowPtr pWin, int x, int y, int w, int h)
+compNewPixmap(WindowPtr pWin, int x, int y, int w, int h, Bool grow,
+              int *pw, int *ph)
 {
     ScreenPtr pScreen = pWin->drawable.pScreen;
     WindowPtr pParent = pWin->parent;
     PixmapPtr pPixmap;
 
-    pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h, pWin->drawable.depth,
-                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    pPixmap = compPoolGetPixmap(pWin, w, h, grow, pw, ph);
 
     if (!pPixmap)
         return 0;
@@ -618,8 +622,9 @@ compAllocPixmap(WindowPtr pWin)
     int y = pWin->drawable.y - bw;
     int w = pWin->drawable.width + (bw << 1);
     int h = pWin->drawable.height + (bw << 1);
-    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h);
     CompWindowPtr cw = GetCompWindow(pWin);
+    PixmapPtr pPixmap = compNewPixmap(pWin, x, y, w, h, FALSE,
+                                      &cw->pixmapWidth, &cw->pixmapHeight);
 
     if (!pPixmap)
         return FALSE;
@@ -685,6 +690,7 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     CompWindowPtr cw = GetCompWindow(pWin);
     int pix_x, pix_y;
     int pix_w, pix_h;
+    int new_w, new_h;
 
     assert(cw && pWin->redirectDraw != RedirectDrawNone);
     cw->oldx = pOld->screen_x;
@@ -694,10 +700,16 @@ compReallocPixmap(WindowPtr pWin, int draw_x, int draw_y,
     pix_w = w + (bw << 1);
     pix_h = h + (bw << 1);
     if (pix_w != pOld->drawable.width || pix_h != pOld->drawable.height) {
-        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h);
+        pNew = compNewPixmap(pWin, pix_x, pix_y, pix_w, pix_h,
+                             pix_w > pOld->drawable.width ||
+                             pix_h > pOld->drawable.height, &new_w, &new_h);
         if (!pNew)
             return FALSE;
         cw->pOldPixmap = pOld;
+        cw->oldPixmapWidth = cw->pixmapWidth;
+        cw->oldPixmapHeight = cw->pixmapHeight;
+        cw->pixmapWidth = new_w;
+        cw->pixmapHeight = new_h;
         compSetPixmap(pWin, pNew);
     }
     else {
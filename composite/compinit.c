@@ -59,6 +59,7 @@ compCloseScreen(ScreenPtr pScreen)
     Bool ret;
 
     free(cs->alternateVisuals);
+    compPoolFini(pScreen);
 
     pScreen->CloseScreen = cs->CloseScreen;
     pScreen->InstallColormap = cs->InstallColormap;
@@ -347,6 +348,12 @@ compScreenInit(ScreenPtr pScreen)
     cs->pOverlayWin = NULL;
     cs->pOverlayClients = NULL;
 
+    cs->poolCount = 0;
+    cs->poolBytes = 0;
+    cs->poolTimer = NULL;
+    cs->poolHits = 0;
+    cs->poolMisses = 0;
+
     cs->numAlternateVisuals = 0;
     cs->alternateVisuals = NULL;
 
@@ -97,6 +97,9 @@ typedef struct _CompWindow {
     int oldy;
     PixmapPtr pOldPixmap;
     int borderClipX, borderClipY;
+    /* storage size of the backing pixmaps, see comppool.c */
+    int pixmapWidth, pixmapHeight;
+    int oldPixmapWidth, oldPixmapHeight;
 } CompWindowRec, *CompWindowPtr;
 
 #define COMP_ORIGIN_INVALID	    0x80000000
@@ -119,6 +122,14 @@ typedef struct _CompOverlayClientRec {
     XID resource;
 } CompOverlayClientRec;
 
+#define COMP_POOL_PIXMAPS	8
+
+typedef struct _CompPoolPixmap {
+    PixmapPtr pPixmap;
+    int width, height;          /* storage size */
+    CARD32 time;                /* when it was put in the pool */
+} CompPoolPixmapRec, *CompPoolPixmapPtr;
+
 typedef struct _CompScreen {
     PositionWindowProcPtr PositionWindow;
     CopyWindowProcPtr CopyWindow;
@@ -162,6 +173,15 @@ typedef struct _CompScreen {
 
     GetImageProcPtr GetImage;
     SourceValidateProcPtr SourceValidate;
+
+    /*
+     * Backing pixmaps for reuse, oldest first
+     */
+    CompPoolPixmapRec pool[COMP_POOL_PIXMAPS];
+    int poolCount;
+    unsigned long poolBytes;
+    OsTimerPtr poolTimer;
+    unsigned long poolHits, poolMisses;
 } CompScreenRec, *CompScreenPtr;
 
 extern DevPrivateKeyRec CompScreenPrivateKeyRec;
@@ -254,6 +274,19 @@ Bool
 void
  compDestroyOverlayWindow(ScreenPtr pScreen);
 
+/*
+ * comppool.c
+ */
+
+PixmapPtr
+compPoolGetPixmap(WindowPtr pWin, int w, int h, Bool grow, int *pw, int *ph);
+
+void
+ compPoolPutPixmap(ScreenPtr pScreen, PixmapPtr pPixmap, int w, int h);
+
+void
+ compPoolFini(ScreenPtr pScreen);
+
 /*
  * compwindow.c
  */
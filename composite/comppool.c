@@ -0,0 +1,229 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Pool of backing pixmaps.
+ *
+ * Every resize of a redirected window allocates a new backing pixmap and
+ * frees the old one once its contents have been copied over; an
+ * interactive resize under a compositing manager does that on every
+ * step.  Instead of being destroyed, backing pixmaps nobody else holds
+ * on to are put in a small per-screen pool, and new backing pixmaps are
+ * taken from it when one of the right size is there.
+ *
+ * Where pixmaps are plain memory (the screen uses miModifyPixmapHeader),
+ * a pixmap can be handed out for any smaller size by changing its width
+ * and height while keeping its stride, so storage is allocated in size
+ * classes: rounded up to COMP_POOL_ALIGN pixels, with a quarter more
+ * room when a window grows.  A window being resized then mostly swaps
+ * between two pixmaps from the pool.  Elsewhere only pixmaps of exactly
+ * the size needed are reused.
+ *
+ * The pool holds at most COMP_POOL_PIXMAPS pixmaps and COMP_POOL_BYTES
+ * of storage, dropping the least recently pooled pixmap first, and
+ * pixmaps unused for COMP_POOL_AGE milliseconds are destroyed.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "compint.h"
+
+#define COMP_POOL_ALIGN         64
+#define COMP_POOL_BYTES         (64 << 20)
+#define COMP_POOL_AGE           1000    /* milliseconds */
+
+static Bool
+compPoolResizable(ScreenPtr pScreen)
+{
+    return pScreen->ModifyPixmapHeader == miModifyPixmapHeader;
+}
+
+static unsigned long
+compPoolBytes(CompPoolPixmapPtr pEntry)
+{
+    return (unsigned long) pEntry->pPixmap->devKind * pEntry->height;
+}
+
+/* The storage size to allocate for size, with room to grow */
+static int
+compPoolRound(int size, Bool grow)
+{
+    if (grow)
+        size += size / 4;
+    return (size + COMP_POOL_ALIGN - 1) & ~(COMP_POOL_ALIGN - 1);
+}
+
+/* Whether storage of capacity is worth using for size */
+static Bool
+compPoolFits(int capacity, int size)
+{
+    return capacity >= size && capacity <= compPoolRound(size, TRUE) +
+        COMP_POOL_ALIGN;
+}
+
+static void
+compPoolRemove(CompScreenPtr cs, int i, Bool destroy)
+{
+    CompPoolPixmapPtr pEntry = &cs->pool[i];
+
+    cs->poolBytes -= compPoolBytes(pEntry);
+    if (destroy) {
+        PixmapPtr pPixmap = pEntry->pPixmap;
+
+        (*pPixmap->drawable.pScreen->DestroyPixmap) (pPixmap);
+    }
+    cs->poolCount--;
+    memmove(pEntry, pEntry + 1, (cs->poolCount - i) * sizeof(*pEntry));
+}
+
+static CARD32
+compPoolExpire(OsTimerPtr pTimer, CARD32 now, pointer arg)
+{
+    CompScreenPtr cs = GetCompScreen((ScreenPtr) arg);
+
+    /* the pool is kept oldest first */
+    while (cs->poolCount && (INT32) (now - cs->pool[0].time) >= COMP_POOL_AGE)
+        compPoolRemove(cs, 0, TRUE);
+    if (!cs->poolCount)
+        return 0;
+    return COMP_POOL_AGE - (now - cs->pool[0].time);
+}
+
+/*
+ * A backing pixmap of w by h for pWin, from the pool if there is a
+ * suitable one.  The size of its storage is returned in *pw and *ph, for
+ * compPoolPutPixmap.  grow says the window is getting larger.
+ */
+PixmapPtr
+compPoolGetPixmap(WindowPtr pWin, int w, int h, Bool grow, int *pw, int *ph)
+{
+    ScreenPtr pScreen = pWin->drawable.pScreen;
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    Bool resizable = compPoolResizable(pScreen);
+    CompPoolPixmapPtr pEntry;
+    PixmapPtr pPixmap;
+    int i, best = -1;
+    unsigned long area, bestArea = 0;
+
+    for (i = 0; i < cs->poolCount; i++) {
+        pEntry = &cs->pool[i];
+        if (pEntry->pPixmap->drawable.depth != pWin->drawable.depth)
+            continue;
+        if (resizable ? !compPoolFits(pEntry->width, w) ||
+            !compPoolFits(pEntry->height, h) :
+            pEntry->width != w || pEntry->height != h)
+            continue;
+        area = (unsigned long) pEntry->width * pEntry->height;
+        if (best < 0 || area < bestArea) {
+            best = i;
+            bestArea = area;
+        }
+    }
+
+    if (best >= 0) {
+        pEntry = &cs->pool[best];
+        pPixmap = pEntry->pPixmap;
+        *pw = pEntry->width;
+        *ph = pEntry->height;
+        compPoolRemove(cs, best, FALSE);
+        if (pPixmap->drawable.width != w || pPixmap->drawable.height != h)
+            (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+        cs->poolHits++;
+        return pPixmap;
+    }
+
+    cs->poolMisses++;
+    if (resizable) {
+        *pw = compPoolRound(w, grow);
+        *ph = compPoolRound(h, grow);
+    }
+    else {
+        *pw = w;
+        *ph = h;
+    }
+    pPixmap = (*pScreen->CreatePixmap) (pScreen, *pw, *ph,
+                                        pWin->drawable.depth,
+                                        CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    if (!pPixmap && (*pw != w || *ph != h)) {
+        *pw = w;
+        *ph = h;
+        pPixmap = (*pScreen->CreatePixmap) (pScreen, w, h,
+                                            pWin->drawable.depth,
+                                            CREATE_PIXMAP_USAGE_BACKING_PIXMAP);
+    }
+    if (pPixmap && (*pw != w || *ph != h))
+        (*pScreen->ModifyPixmapHeader) (pPixmap, w, h, 0, 0, 0, NULL);
+    return pPixmap;
+}
+
+/*
+ * Done with a backing pixmap whose storage is w by h.  Pixmaps still
+ * referenced elsewhere, say named by a compositing manager, or with
+ * damage registered on them, are just released.
+ */
+void
+compPoolPutPixmap(ScreenPtr pScreen, PixmapPtr pPixmap, int w, int h)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+    CompPoolPixmapPtr pEntry;
+
+    if (pPixmap->refcnt != 1 || DamagePixmapHasDamage(pPixmap) ||
+        (unsigned long) pPixmap->devKind * h > COMP_POOL_BYTES ||
+        (!cs->poolTimer &&
+         !(cs->poolTimer = TimerSet(NULL, 0, 0, compPoolExpire, pScreen)))) {
+        (*pScreen->DestroyPixmap) (pPixmap);
+        return;
+    }
+
+    if (cs->poolCount == COMP_POOL_PIXMAPS)
+        compPoolRemove(cs, 0, TRUE);
+    pEntry = &cs->pool[cs->poolCount++];
+    pEntry->pPixmap = pPixmap;
+    pEntry->width = w;
+    pEntry->height = h;
+    pEntry->time = GetTimeInMillis();
+    cs->poolBytes += compPoolBytes(pEntry);
+
+    /* the new pixmap alone fits, so it isn't the one dropped */
+    while (cs->poolBytes > COMP_POOL_BYTES)
+        compPoolRemove(cs, 0, TRUE);
+
+    if (cs->poolCount == 1)
+        TimerSet(cs->poolTimer, 0, COMP_POOL_AGE, compPoolExpire, pScreen);
+}
+
+void
+compPoolFini(ScreenPtr pScreen)
+{
+    CompScreenPtr cs = GetCompScreen(pScreen);
+
+    while (cs->poolCount)
+        compPoolRemove(cs, 0, TRUE);
+    TimerFree(cs->poolTimer);
+    cs->poolTimer = NULL;
+    LogMessageVerb(X_INFO, 3, "Composite: screen %d backing pixmap pool: "
+                   "%lu hits, %lu misses\n", pScreen->myNum,
+                   cs->poolHits, cs->poolMisses);
+}
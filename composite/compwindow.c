@@ -169,7 +169,11 @@ compCheckRedirect(WindowPtr pWin)
 
             compSetParentPixmap(pWin);
             compRestoreWindow(pWin, pPixmap);
-            (*pScreen->DestroyPixmap) (pPixmap);
+            if (cw)
+                compPoolPutPixmap(pScreen, pPixmap, cw->pixmapWidth,
+                                  cw->pixmapHeight);
+            else
+                (*pScreen->DestroyPixmap) (pPixmap);
         }
     }
     else if (should) {
@@ -360,7 +364,8 @@ compFreeOldPixmap(WindowPtr pWin)
         CompWindowPtr cw = GetCompWindow(pWin);
 
         if (cw->pOldPixmap) {
-            (*pScreen->DestroyPixmap) (cw->pOldPixmap);
+            compPoolPutPixmap(pScreen, cw->pOldPixmap, cw->oldPixmapWidth,
+                              cw->oldPixmapHeight);
             cw->pOldPixmap = NullPixmap;
         }
     }
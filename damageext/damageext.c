@@ -219,6 +219,7 @@ ProcDamageCreate(ClientPtr client)
         return BadAlloc;
 
     DamageSetReportAfterOp(pDamageExt->pDamage, TRUE);
+    DamageSetAccumulate(pDamageExt->pDamage, 0, 0);
     DamageRegister(pDamageExt->pDrawable, pDamageExt->pDamage);
 
     if (pDrawable->type == DRAWABLE_WINDOW) {
@@ -56,90 +56,161 @@ SOFTWARE.
 #include "resource.h"
 #include "dix.h"
 
-#define InitialTableSize 100
+/*
+ * Atoms are numbered from 1 in the order they are made; nodeTable maps
+ * an atom to its name.  Names are found through an open addressing hash
+ * table of atoms, probed linearly and kept at most half full, which
+ * holds a copy of each name's hash so that most probes that don't match
+ * are rejected without looking at the name.
+ */
+
+#define InitialTableSize 128    /* a power of two */
 
 typedef struct _Node {
-    struct _Node *left, *right;
-    Atom a;
-    unsigned int fingerPrint;
     const char *string;
+    unsigned int len;
+    unsigned int hash;
 } NodeRec, *NodePtr;
 
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
 static unsigned long tableLength;
-static NodePtr *nodeTable;
+static NodePtr nodeTable;
+static unsigned long hashSize;
+static Atom *atomHash;
 
-void FreeAtom(NodePtr patom);
+static unsigned int
+AtomHash(const char *string, unsigned len)
+{
+    unsigned int hash = 2166136261U;    /* FNV-1a */
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+    while (len--) {
+        hash ^= (unsigned char) *string++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/*
+ * The bucket holding the atom named string, or the empty bucket where it
+ * would go.
+ */
+static Atom *
+AtomBucket(const char *string, unsigned len, unsigned int hash)
 {
-    NodePtr *np;
-    unsigned i;
-    int comp;
-    unsigned int fp = 0;
-
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
+    unsigned long i = hash & (hashSize - 1);
+    NodePtr nd;
+
+    while (atomHash[i] != None) {
+        nd = &nodeTable[atomHash[i]];
+        if (nd->hash == hash && nd->len == len &&
+            memcmp(nd->string, string, len) == 0)
+            break;
+        i = (i + 1) & (hashSize - 1);
     }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
+    return &atomHash[i];
+}
+
+/*
+ * Make room for count more atoms, growing both tables by doubling.
+ */
+static Bool
+ReserveAtoms(unsigned long count)
+{
+    unsigned long length, size, i;
+    NodePtr table;
+    Atom *hash, a;
+
+    length = tableLength;
+    while (lastAtom + count >= length)
+        length <<= 1;
+    if (length != tableLength) {
+        table = realloc(nodeTable, length * sizeof(NodeRec));
+        if (!table)
+            return FALSE;
+        nodeTable = table;
+        tableLength = length;
     }
-    if (makeit) {
-        NodePtr nd;
 
-        nd = malloc(sizeof(NodeRec));
-        if (!nd)
-            return BAD_RESOURCE;
-        if (lastAtom < XA_LAST_PREDEFINED) {
-            nd->string = string;
+    size = hashSize;
+    while ((lastAtom + count) * 2 >= size)
+        size <<= 1;
+    if (size != hashSize) {
+        hash = calloc(size, sizeof(Atom));
+        if (!hash)
+            return FALSE;
+        free(atomHash);
+        atomHash = hash;
+        hashSize = size;
+        for (a = 1; a <= lastAtom; a++) {
+            i = nodeTable[a].hash & (hashSize - 1);
+            while (atomHash[i] != None)
+                i = (i + 1) & (hashSize - 1);
+            atomHash[i] = a;
         }
-        else {
-            nd->string = strndup(string, len);
-            if (!nd->string) {
-                free(nd);
-                return BAD_RESOURCE;
-            }
-        }
-        if ((lastAtom + 1) >= tableLength) {
-            NodePtr *table;
-
-            table = realloc(nodeTable, tableLength * (2 * sizeof(NodePtr)));
-            if (!table) {
-                if (nd->string != string) {
-                    /* nd->string has been strdup'ed */
-                    free((char *) nd->string);
-                }
-                free(nd);
-                return BAD_RESOURCE;
-            }
-            tableLength <<= 1;
-            nodeTable = table;
-        }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
-        nd->a = ++lastAtom;
-        nodeTable[lastAtom] = nd;
-        return nd->a;
     }
-    else
+    return TRUE;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+    const char *nul;
+    unsigned int hash;
+    Atom *bucket;
+    NodePtr nd;
+
+    /* a name ends at the first NUL, where the copy kept of it ends */
+    if ((nul = memchr(string, '\0', len)))
+        len = nul - string;
+    hash = AtomHash(string, len);
+    bucket = AtomBucket(string, len, hash);
+    if (*bucket != None)
+        return *bucket;
+    if (!makeit)
         return None;
+
+    if (lastAtom + 1 >= tableLength || (lastAtom + 1) * 2 >= hashSize) {
+        if (!ReserveAtoms(1))
+            return BAD_RESOURCE;
+        bucket = AtomBucket(string, len, hash);
+    }
+
+    nd = &nodeTable[lastAtom + 1];
+    if (lastAtom < XA_LAST_PREDEFINED) {
+        nd->string = string;
+    }
+    else {
+        nd->string = strndup(string, len);
+        if (!nd->string)
+            return BAD_RESOURCE;
+    }
+    nd->len = len;
+    nd->hash = hash;
+    *bucket = ++lastAtom;
+    return lastAtom;
+}
+
+/*
+ * MakeAtom() for count NUL-terminated names at once, for extensions that
+ * set up a list of atoms.  The atoms, or None or BAD_RESOURCE as from
+ * MakeAtom(), are stored in atoms; returns FALSE if any is BAD_RESOURCE.
+ */
+Bool
+MakeAtoms(const char **names, int count, Bool makeit, Atom *atoms)
+{
+    Bool ret = TRUE;
+    int i;
+
+    /* one resize up front rather than several along the way */
+    if (makeit && count > 0)
+        (void) ReserveAtoms(count);
+
+    for (i = 0; i < count; i++) {
+        atoms[i] = MakeAtom(names[i], strlen(names[i]), makeit);
+        if (atoms[i] == BAD_RESOURCE)
+            ret = FALSE;
+    }
+    return ret;
 }
 
 Bool
@@ -151,13 +222,9 @@ ValidAtom(Atom atom)
 const char *
 NameForAtom(Atom atom)
 {
-    NodePtr node;
-
-    if (atom > lastAtom)
+    if (atom == None || atom > lastAtom)
         return 0;
-    if ((node = nodeTable[atom]) == NULL)
-        return 0;
-    return node->string;
+    return nodeTable[atom].string;
 }
 
 void
@@ -166,32 +233,25 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
+    Atom a;
+
+    if (nodeTable == NULL)
         return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
+    /*
+     * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
+     * cast here
+     */
+    for (a = XA_LAST_PREDEFINED + 1; a <= lastAtom; a++)
+        free((char *) nodeTable[a].string);
     free(nodeTable);
     nodeTable = NULL;
+    tableLength = 0;
+    free(atomHash);
+    atomHash = NULL;
+    hashSize = 0;
     lastAtom = None;
 }
 
@@ -200,10 +260,11 @@ InitAtoms(void)
 {
     FreeAllAtoms();
     tableLength = InitialTableSize;
-    nodeTable = malloc(InitialTableSize * sizeof(NodePtr));
-    if (!nodeTable)
+    nodeTable = malloc(InitialTableSize * sizeof(NodeRec));
+    hashSize = InitialTableSize * 2;
+    atomHash = calloc(hashSize, sizeof(Atom));
+    if (!nodeTable || !atomHash)
         AtomError();
-    nodeTable[None] = NULL;
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
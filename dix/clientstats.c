@@ -0,0 +1,242 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Per-client dispatch statistics.
+ *
+ * Dispatch() times every request and hands the result to
+ * ClientStatsRecordRequest(), which counts it in the client's
+ * ClientStatsRec by major opcode and in a log2 latency histogram, and
+ * in server-wide totals by major and minor opcode.  Together with the
+ * byte and blocking counters of the OS layer (GetClientIOStats) this
+ * is enough to tell which client, and which request, is keeping the
+ * server busy.  The numbers are exported through the CLIENT-STATS
+ * extension and logged by LogClientStats(), which the server runs
+ * when it receives SIGUSR2.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/X.h>
+#include "misc.h"
+#include "os.h"
+#include "dixstruct.h"
+#include "registry.h"
+#include "clientstats.h"
+
+/* Server-wide totals.  Core requests have no minor opcode; extension
+ * requests get a table of minor opcodes once they are first seen. */
+static ClientOpStatsRec coreOpStats[EXTENSION_BASE];
+static ClientOpStatsPtr extensionOpStats[256 - EXTENSION_BASE];
+
+void
+ReserveClientStats(ClientPtr client)
+{
+    client->clientStats = calloc(1, sizeof(ClientStatsRec));
+}
+
+void
+ReleaseClientStats(ClientPtr client)
+{
+    free(client->clientStats);
+    client->clientStats = NULL;
+}
+
+static int
+StatsBucket(CARD64 micros)
+{
+    int bucket = 0;
+
+    while (micros && bucket < CLIENT_STATS_BUCKETS - 1) {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void
+ClientStatsRecordRequest(ClientPtr client, CARD64 micros)
+{
+    ClientStatsPtr stats = client->clientStats;
+    ClientOpStatsPtr op;
+    int major = client->majorOp;
+
+    if (!stats)
+        return;
+
+    stats->requests++;
+    stats->micros += micros;
+    stats->histogram[StatsBucket(micros)]++;
+    stats->ops[major].count++;
+    stats->ops[major].micros += micros;
+
+    if (major < EXTENSION_BASE)
+        op = &coreOpStats[major];
+    else {
+        ClientOpStatsPtr *minors = &extensionOpStats[major - EXTENSION_BASE];
+
+        if (!*minors && !(*minors = calloc(256, sizeof(ClientOpStatsRec))))
+            return;
+        op = &(*minors)[client->minorOp];
+    }
+    op->count++;
+    op->micros += micros;
+}
+
+ClientOpStatsPtr
+GetRequestStats(int major, int minor)
+{
+    ClientOpStatsPtr op;
+
+    if (major < 0 || major > 255 || minor < 0 || minor > 255)
+        return NULL;
+    if (major < EXTENSION_BASE)
+        op = minor ? NULL : &coreOpStats[major];
+    else if (extensionOpStats[major - EXTENSION_BASE])
+        op = &extensionOpStats[major - EXTENSION_BASE][minor];
+    else
+        op = NULL;
+    return (op && op->count) ? op : NULL;
+}
+
+/* Upper bound, in us, of the bucket holding the pct'th percentile. */
+static unsigned long
+StatsPercentile(ClientStatsPtr stats, int pct)
+{
+    unsigned long seen = 0, want;
+    int i;
+
+    want = (stats->requests * pct + 99) / 100;
+    for (i = 0; i < CLIENT_STATS_BUCKETS - 1; i++) {
+        seen += stats->histogram[i];
+        if (seen >= want)
+            break;
+    }
+    return 1UL << i;
+}
+
+static int
+CompareClientTime(const void *a, const void *b)
+{
+    ClientStatsPtr sa = clients[*(const int *) a]->clientStats;
+    ClientStatsPtr sb = clients[*(const int *) b]->clientStats;
+
+    return (sa->micros < sb->micros) - (sa->micros > sb->micros);
+}
+
+#define LOG_TOP_REQUESTS 5
+
+/* Keep ops/majors/minors sorted by time, at most n entries. */
+static void
+InsertTopRequest(ClientOpStatsPtr *ops, int *majors, int *minors, int n,
+                 ClientOpStatsPtr op, int major, int minor)
+{
+    int i;
+
+    if (!op->count)
+        return;
+    for (i = n; i > 0 && (!ops[i - 1] || ops[i - 1]->micros < op->micros);
+         i--) {
+        if (i < n) {
+            ops[i] = ops[i - 1];
+            majors[i] = majors[i - 1];
+            minors[i] = minors[i - 1];
+        }
+    }
+    if (i < n) {
+        ops[i] = op;
+        majors[i] = major;
+        minors[i] = minor;
+    }
+}
+
+void
+LogClientStats(void)
+{
+    ClientOpStatsPtr ops[LOG_TOP_REQUESTS];
+    int majors[LOG_TOP_REQUESTS], minors[LOG_TOP_REQUESTS];
+    int *order, n, i, j, k;
+
+    order = malloc(currentMaxClients * sizeof(int));
+    if (!order)
+        return;
+    for (n = 0, i = 1; i < currentMaxClients; i++)
+        if (clients[i] && clients[i]->clientStats)
+            order[n++] = i;
+    qsort(order, n, sizeof(int), CompareClientTime);
+
+    LogMessage(X_INFO, "Dispatch statistics for %d clients:\n", n);
+    for (i = 0; i < n; i++) {
+        ClientPtr client = clients[order[i]];
+        ClientStatsPtr stats = client->clientStats;
+        ClientIOStatsRec io;
+        const char *cmdname = GetClientCmdName(client);
+
+        GetClientIOStats(client, &io);
+        LogMessage(X_NONE, "  client %d (%s, pid %ld, weight %u): "
+                   "%lu requests, %llu us, latency p50 < %lu us "
+                   "p99 < %lu us\n",
+                   client->index, cmdname ? cmdname : "unknown",
+                   (long) GetClientPid(client), client->smart_weight,
+                   stats->requests,
+                   (unsigned long long) stats->micros,
+                   StatsPercentile(stats, 50), StatsPercentile(stats, 99));
+        LogMessage(X_NONE, "    %lu bytes in %lu reads, %lu bytes out in "
+                   "%lu writes, %llu us blocked on output\n",
+                   io.inputBytes, io.inputReads, io.outputBytes,
+                   io.outputWrites,
+                   (unsigned long long) io.outputBlockedMicros);
+
+        memset(ops, 0, sizeof(ops));
+        for (j = 0; j < 256; j++)
+            InsertTopRequest(ops, majors, minors, LOG_TOP_REQUESTS,
+                             &stats->ops[j], j, 0);
+        for (j = 0; j < LOG_TOP_REQUESTS && ops[j]; j++)
+            LogMessage(X_NONE, "    %-32s %10lu requests %12llu us\n",
+                       LookupMajorName(majors[j]), ops[j]->count,
+                       (unsigned long long) ops[j]->micros);
+    }
+    free(order);
+
+    memset(ops, 0, sizeof(ops));
+    for (j = 0; j < EXTENSION_BASE; j++)
+        InsertTopRequest(ops, majors, minors, LOG_TOP_REQUESTS,
+                         &coreOpStats[j], j, 0);
+    for (j = EXTENSION_BASE; j < 256; j++) {
+        if (!extensionOpStats[j - EXTENSION_BASE])
+            continue;
+        for (k = 0; k < 256; k++)
+            InsertTopRequest(ops, majors, minors, LOG_TOP_REQUESTS,
+                             &extensionOpStats[j - EXTENSION_BASE][k], j, k);
+    }
+    LogMessage(X_INFO, "Most expensive requests overall:\n");
+    for (j = 0; j < LOG_TOP_REQUESTS && ops[j]; j++)
+        LogMessage(X_NONE, "  %-34s %10lu requests %12llu us\n",
+                   LookupRequestName(majors[j], minors[j]), ops[j]->count,
+                   (unsigned long long) ops[j]->micros);
+}
@@ -1120,6 +1120,9 @@ RemoveDevice(DeviceIntPtr dev, BOOL sendevent)
     initialized = dev->inited;
     deviceid = dev->id;
 
+    /* recipients are cached by device id, and the id will be reused */
+    InvalidateEventRecipients();
+
     if (initialized) {
         if (DevHasCursor(dev))
             screen->DisplayCursor(dev, screen, NullCursor);
@@ -128,6 +128,7 @@ int ProcInitialConnection();
 #include "xkbsrv.h"
 #include "site.h"
 #include "client.h"
+#include "slab.h"
 
 #ifdef XSERVER_DTRACE
 #include "registry.h"
@@ -231,10 +232,11 @@ Bool SmartScheduleDisable = FALSE;
 long SmartScheduleSlice = SMART_SCHEDULE_DEFAULT_INTERVAL;
 long SmartScheduleInterval = SMART_SCHEDULE_DEFAULT_INTERVAL;
 long SmartScheduleMaxSlice = SMART_SCHEDULE_MAX_SLICE;
+Bool SmartScheduleOtherWeights = FALSE;
 long SmartScheduleTime;
 int SmartScheduleLatencyLimited = 0;
 static ClientPtr SmartLastClient;
-static int SmartLastIndex[SMART_MAX_PRIORITY - SMART_MIN_PRIORITY + 1];
+static CARD64 SmartMinVruntime;
 
 #ifdef SMART_DEBUG
 long SmartLastPrint;
@@ -242,54 +244,54 @@ long SmartLastPrint;
 
 void Dispatch(void);
 
-static int
+/*
+ * Weighted fair scheduling.  Every client accrues virtual runtime: the
+ * time it spent being dispatched, scaled by SMART_DEFAULT_WEIGHT over
+ * its weight.  Of the ready clients the one with the least virtual
+ * runtime runs next, so busy clients share the server in proportion to
+ * their weights no matter how much they send.  A client coming back
+ * from idle is moved up to at most one interval behind the others: it
+ * cannot bank time while sleeping, but it does get to run ahead of the
+ * busy clients right away.  Clients that were just sent critical
+ * events (smart_priority > 0) get another interval of credit.
+ */
+int
 SmartScheduleClient(int *clientReady, int nready)
 {
-    ClientPtr pClient;
+    ClientPtr pClient, pBest = NULL;
+    CARD64 credit, floor, key, bestKey = 0;
     int i;
-    int client;
-    int bestPrio, best = 0;
-    int bestRobin, robin;
     long now = SmartScheduleTime;
-    long idle;
 
-    bestPrio = -0x7fffffff;
-    bestRobin = 0;
-    idle = 2 * SmartScheduleSlice;
+    credit = (CARD64) SmartScheduleInterval * 1000;
+    floor = SmartMinVruntime > credit ? SmartMinVruntime - credit : 0;
     for (i = 0; i < nready; i++) {
-        client = clientReady[i];
-        pClient = clients[client];
-        /* Praise clients which are idle */
-        if ((now - pClient->smart_check_tick) >= idle) {
-            if (pClient->smart_priority < 0)
-                pClient->smart_priority++;
-        }
-        pClient->smart_check_tick = now;
-
-        /* check priority to select best client */
-        robin =
-            (pClient->index -
-             SmartLastIndex[pClient->smart_priority -
-                            SMART_MIN_PRIORITY]) & 0xff;
-        if (pClient->smart_priority > bestPrio ||
-            (pClient->smart_priority == bestPrio && robin > bestRobin)) {
-            bestPrio = pClient->smart_priority;
-            bestRobin = robin;
-            best = client;
+        pClient = clients[clientReady[i]];
+        if (pClient->smart_vruntime < floor)
+            pClient->smart_vruntime = floor;
+
+        key = pClient->smart_vruntime;
+        if (pClient->smart_priority > 0)
+            key = key > credit ? key - credit : 0;
+        if (!pBest || key < bestKey) {
+            pBest = pClient;
+            bestKey = key;
         }
 #ifdef SMART_DEBUG
         if ((now - SmartLastPrint) >= 5000)
-            fprintf(stderr, " %2d: %3d", client, pClient->smart_priority);
+            fprintf(stderr, " %2d: %llu", pClient->index,
+                    (unsigned long long) pClient->smart_vruntime);
 #endif
     }
 #ifdef SMART_DEBUG
     if ((now - SmartLastPrint) >= 5000) {
-        fprintf(stderr, " use %2d\n", best);
+        fprintf(stderr, " use %2d\n", pBest->index);
         SmartLastPrint = now;
     }
 #endif
-    pClient = clients[best];
-    SmartLastIndex[bestPrio - SMART_MIN_PRIORITY] = pClient->index;
+    pClient = pBest;
+    if (pClient->smart_vruntime > SmartMinVruntime)
+        SmartMinVruntime = pClient->smart_vruntime;
     /*
      * Set current client pointer
      */
@@ -314,7 +316,22 @@ SmartScheduleClient(int *clientReady, int nready)
     else {
         SmartScheduleSlice = SmartScheduleInterval;
     }
-    return best;
+    return pClient->index;
+}
+
+/*
+ * Charge a client for micros of dispatch time.  Any boost from critical
+ * events has been used up by running.
+ */
+void
+SmartScheduleAccount(ClientPtr client, CARD64 micros)
+{
+    if (!micros)
+        micros = 1;
+    client->smart_vruntime += micros * SMART_DEFAULT_WEIGHT /
+        client->smart_weight;
+    if (client->smart_priority > 0)
+        client->smart_priority = 0;
 }
 
 void
@@ -343,6 +360,7 @@ Dispatch(void)
     int nready;
     HWEventQueuePtr *icheck = checkForInput;
     long start_tick;
+    CARD64 start_time;
 
     nextFreeClientID = 1;
     nClients = 0;
@@ -358,6 +376,12 @@ Dispatch(void)
             FlushIfCriticalOutputPending();
         }
 
+        if (clientStatsDumpPending) {
+            clientStatsDumpPending = FALSE;
+            LogClientStats();
+            LogSlabStats();
+        }
+
         nready = WaitForSomething(clientReady);
 
         if (nready && !SmartScheduleDisable) {
@@ -383,18 +407,15 @@ Dispatch(void)
             isItTimeToYield = FALSE;
 
             start_tick = SmartScheduleTime;
+            start_time = GetTimeInMicros();
             while (!isItTimeToYield) {
                 if (*icheck[0] != *icheck[1])
                     ProcessInputEvents();
 
                 FlushIfCriticalOutputPending();
                 if (!SmartScheduleDisable &&
-                    (SmartScheduleTime - start_tick) >= SmartScheduleSlice) {
-                    /* Penalize clients which consume ticks */
-                    if (client->smart_priority > SMART_MIN_PRIORITY)
-                        client->smart_priority--;
+                    (SmartScheduleTime - start_tick) >= SmartScheduleSlice)
                     break;
-                }
                 /* now, finally, deal with client requests */
 
                 /* Update currentTime so request time checks, such as for input
@@ -427,11 +448,15 @@ Dispatch(void)
                 if (result > (maxBigRequestSize << 2))
                     result = BadLength;
                 else {
+                    CARD64 start = GetTimeInMicros();
+
                     result = XaceHookDispatch(client, client->majorOp);
                     if (result == Success)
                         result =
                             (*client->requestVector[client->majorOp]) (client);
                     XaceHookAuditEnd(client, result);
+                    ClientStatsRecordRequest(client,
+                                             GetTimeInMicros() - start);
                 }
 #ifdef XSERVER_DTRACE
                 if (XSERVER_REQUEST_DONE_ENABLED())
@@ -453,8 +478,10 @@ Dispatch(void)
             }
             FlushAllOutput();
             client = clients[clientReady[nready]];
-            if (client)
+            if (client) {
                 client->smart_stop_tick = SmartScheduleTime;
+                SmartScheduleAccount(client, GetTimeInMicros() - start_time);
+            }
         }
         dispatchException &= ~DE_PRIORITYCHANGE;
     }
@@ -467,6 +494,61 @@ Dispatch(void)
     SmartScheduleLatencyLimited = 0;
 }
 
+/*
+ * Request coalescing, enabled with -coalesce.
+ *
+ * Toolkits often send runs of drawing requests that differ only in the
+ * shapes they draw.  A request handler that has validated its request
+ * can call CoalesceRequests() to take the following requests of the
+ * run along: they must be completely buffered already, have the same
+ * opcodes and the same headerSize bytes of header apart from the
+ * length, and carry whole units of unitSize bytes.  As they name the
+ * same objects they would have passed validation as well, so they are
+ * consumed as part of the current request and all the shapes are
+ * drawn with a single call down the GC ops, as if the client had sent
+ * one request.  Returns the number of data bytes appended.
+ */
+Bool requestCoalescing = FALSE;
+
+#define COALESCE_MAX_REQUESTS   256
+
+int
+CoalesceRequests(ClientPtr client, int headerSize, int unitSize)
+{
+    xReq *stuff = (xReq *) client->requestBuffer;
+    xReq *next;
+    int len, count, appended = 0;
+
+    /* the hooks and wrappers need to see every request */
+    if (!requestCoalescing || client->requestVector != ProcVector)
+        return 0;
+#ifdef PANORAMIX
+    if (!noPanoramiXExtension)
+        return 0;
+#endif
+#ifdef XACE
+    if (XaceHooks[XACE_CORE_DISPATCH] || XaceHooks[XACE_EXT_DISPATCH] ||
+        XaceHooks[XACE_AUDIT_BEGIN] || XaceHooks[XACE_AUDIT_END])
+        return 0;
+#endif
+
+    for (count = 0; count < COALESCE_MAX_REQUESTS; count++) {
+        next = PeekNextRequest(client, &len);
+        if (!next || len < headerSize || (len - headerSize) % unitSize ||
+            client->req_len + bytes_to_int32(len - headerSize) >
+            maxBigRequestSize)
+            break;
+        if (next->reqType != stuff->reqType || next->data != stuff->data ||
+            memcmp((char *) next + sz_xReq, (char *) stuff + sz_xReq,
+                   headerSize - sz_xReq))
+            break;
+        AppendNextRequest(client, headerSize);
+        appended += len - headerSize;
+        client->sequence++;
+    }
+    return appended;
+}
+
 static int VendorRelease = VENDOR_RELEASE;
 static char *VendorString = VENDOR_NAME;
 
@@ -1743,6 +1825,8 @@ ProcPolySegment(ClientPtr client)
     nsegs = (client->req_len << 2) - sizeof(xPolySegmentReq);
     if (nsegs & 4)
         return BadLength;
+    nsegs += CoalesceRequests(client, sizeof(xPolySegmentReq),
+                              sizeof(xSegment));
     nsegs >>= 3;
     if (nsegs)
         (*pGC->ops->PolySegment) (pDraw, pGC, nsegs, (xSegment *) &stuff[1]);
@@ -1834,6 +1918,8 @@ ProcPolyFillRectangle(ClientPtr client)
     things = (client->req_len << 2) - sizeof(xPolyFillRectangleReq);
     if (things & 4)
         return BadLength;
+    things += CoalesceRequests(client, sizeof(xPolyFillRectangleReq),
+                               sizeof(xRectangle));
     things >>= 3;
 
     if (things)
@@ -1970,6 +2056,64 @@ ProcPutImage(ClientPtr client)
     return Success;
 }
 
+/*
+ * GetImage replies hand each band to the output path by reference so a
+ * client that is not keeping up never makes the server copy the image a
+ * second time.  The band buffer is allocated once per request, sized to
+ * the largest band, and is reused as soon as the output path releases
+ * the previous band, which for a client that keeps up is right after
+ * it was written.  Only a band still queued when the next one is due
+ * makes DoGetImage allocate another buffer.
+ */
+typedef struct _ImageBand {
+    int refcnt;                 /* DoGetImage plus queued output */
+    char *data;
+} ImageBandRec, *ImageBandPtr;
+
+static ImageBandPtr
+AllocImageBand(long length)
+{
+    ImageBandPtr band = calloc(1, sizeof(ImageBandRec) + length);
+
+    if (band) {
+        band->refcnt = 1;
+        band->data = (char *) (band + 1);
+    }
+    return band;
+}
+
+static void
+ReleaseImageBand(pointer closure)
+{
+    ImageBandPtr band = closure;
+
+    if (--band->refcnt == 0)
+        free(band);
+}
+
+static ImageBandPtr
+NextImageBand(ClientPtr client, ImageBandPtr band, long length)
+{
+    ImageBandPtr next;
+
+    if (band->refcnt == 1)
+        return band;
+    /* the reply is already under way, so there is no error to return */
+    if (!(next = AllocImageBand(length))) {
+        MarkClientException(client);
+        return NULL;
+    }
+    ReleaseImageBand(band);
+    return next;
+}
+
+static void
+WriteImageBand(ClientPtr client, int count, ImageBandPtr band)
+{
+    band->refcnt++;
+    WriteToClientRef(client, count, band->data, ReleaseImageBand, band);
+}
+
 static int
 DoGetImage(ClientPtr client, int format, Drawable drawable,
            int x, int y, int width, int height,
@@ -1983,7 +2127,8 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
     int relx, rely;
     long widthBytesLine, length;
     Mask plane = 0;
-    char *pBuf;
+    char *pBuf = NULL, *pBand;
+    ImageBandPtr band = NULL;
     xGetImageReply xgi;
     RegionPtr pVisibleRegion = NULL;
 
@@ -2109,7 +2254,7 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                 length += widthBytesLine;
             }
         }
-        if (!(pBuf = calloc(1, length)))
+        if (!(band = AllocImageBand(length)))
             return BadAlloc;
         WriteReplyToClient(client, sizeof(xGetImageReply), &xgi);
     }
@@ -2128,25 +2273,31 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         linesDone = 0;
         while (height - linesDone > 0) {
             nlines = min(linesPerBuf, height - linesDone);
+            if (band) {
+                if (!(band = NextImageBand(client, band, length)))
+                    goto out;
+                pBand = band->data;
+            }
+            else
+                pBand = pBuf;
             (*pDraw->pScreen->GetImage) (pDraw,
                                          x,
                                          y + linesDone,
                                          width,
                                          nlines,
-                                         format, planemask, (pointer) pBuf);
+                                         format, planemask, (pointer) pBand);
             if (pVisibleRegion)
                 XaceCensorImage(client, pVisibleRegion, widthBytesLine,
                                 pDraw, x, y + linesDone, width,
-                                nlines, format, pBuf);
+                                nlines, format, pBand);
 
             /* Note that this is NOT a call to WriteSwappedDataToClient,
                as we do NOT byte swap */
             if (!im_return) {
-                ReformatImage(pBuf, (int) (nlines * widthBytesLine),
+                ReformatImage(pBand, (int) (nlines * widthBytesLine),
                               BitsPerPixel(pDraw->depth), ClientOrder(client));
 
-/* Don't split me, gcc pukes when you do */
-                WriteToClient(client, (int) (nlines * widthBytesLine), pBuf);
+                WriteImageBand(client, (int) (nlines * widthBytesLine), band);
             }
             linesDone += nlines;
         }
@@ -2158,17 +2309,24 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                 linesDone = 0;
                 while (height - linesDone > 0) {
                     nlines = min(linesPerBuf, height - linesDone);
+                    if (band) {
+                        if (!(band = NextImageBand(client, band, length)))
+                            goto out;
+                        pBand = band->data;
+                    }
+                    else
+                        pBand = pBuf;
                     (*pDraw->pScreen->GetImage) (pDraw,
                                                  x,
                                                  y + linesDone,
                                                  width,
                                                  nlines,
-                                                 format, plane, (pointer) pBuf);
+                                                 format, plane, (pointer) pBand);
                     if (pVisibleRegion)
                         XaceCensorImage(client, pVisibleRegion,
                                         widthBytesLine,
                                         pDraw, x, y + linesDone, width,
-                                        nlines, format, pBuf);
+                                        nlines, format, pBand);
 
                     /* Note: NOT a call to WriteSwappedDataToClient,
                        as we do NOT byte swap */
@@ -2176,23 +2334,23 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                         pBuf += nlines * widthBytesLine;
                     }
                     else {
-                        ReformatImage(pBuf,
+                        ReformatImage(pBand,
                                       (int) (nlines * widthBytesLine),
                                       1, ClientOrder(client));
 
-/* Don't split me, gcc pukes when you do */
-                        WriteToClient(client, (int) (nlines * widthBytesLine),
-				      pBuf);
+                        WriteImageBand(client, (int) (nlines * widthBytesLine),
+                                       band);
                     }
                     linesDone += nlines;
                 }
             }
         }
     }
+ out:
     if (pVisibleRegion)
         RegionDestroy(pVisibleRegion);
-    if (!im_return)
-        free(pBuf);
+    if (band)
+        ReleaseImageBand(band);
     return Success;
 }
 
@@ -3402,6 +3560,7 @@ CloseDownClient(ClientPtr client)
         /* Disable client ID tracking. This must be done after
          * ClientStateCallback. */
         ReleaseClientIds(client);
+        ReleaseClientStats(client);
 #ifdef XSERVER_DTRACE
         XSERVER_CLIENT_DISCONNECT(client->index);
 #endif
@@ -3440,8 +3599,10 @@ InitClient(ClientPtr client, int i, pointer ospriv)
     QueryMinMaxKeyCodes(&client->minKC, &client->maxKC);
     client->smart_start_tick = SmartScheduleTime;
     client->smart_stop_tick = SmartScheduleTime;
-    client->smart_check_tick = SmartScheduleTime;
+    client->smart_weight = SMART_DEFAULT_WEIGHT;
+    client->smart_vruntime = SmartMinVruntime;
     client->clientIds = NULL;
+    client->clientStats = NULL;
 }
 
 /************************
@@ -3485,6 +3646,7 @@ NextAvailableClient(pointer ospriv)
     /* Enable client ID tracking. This must be done before
      * ClientStateCallback. */
     ReserveClientIds(client);
+    ReserveClientStats(client);
 
     if (ClientStateCallback) {
         NewClientInfoRec clientinfo;
@@ -3639,6 +3801,12 @@ ProcEstablishConnection(ClientPtr client)
                                   (unsigned short) prefix->nbytesAuthString,
                                   auth_string);
 
+    if (reason == ClientAuthorizationPending) {
+        /* run this request again once the answer is known */
+        ResetCurrentRequest(client);
+        IgnoreClient(client);
+        return Success;
+    }
     return (SendConnSetup(client, reason));
 }
 
@@ -2029,6 +2029,154 @@ DeliverToWindowOwner(DeviceIntPtr dev, WindowPtr win,
     return EVENT_NOT_DELIVERED;
 }
 
+/*
+ * Event recipient cache.  Windows with many clients selecting on them, the
+ * root window above all, would otherwise walk the full client list and
+ * check every client's mask for every event.  Instead, the clients whose
+ * mask accepts an event are collected once per window, event level,
+ * device and filter (or XI2 event type) and reused until any selection
+ * changes.
+ */
+
+#define RECIPIENT_SETS 8        /* per window */
+
+typedef struct _EventRecipient {
+    ClientPtr client;
+    Mask mask;
+} EventRecipientRec, *EventRecipientPtr;
+
+typedef struct _EventRecipients {
+    unsigned long serial;
+    int level;
+    int deviceid;
+    int type;                   /* filter, or XI2 event type */
+    int num;
+    int size;
+    EventRecipientPtr recipients;
+} EventRecipientsRec, *EventRecipientsPtr;
+
+typedef struct _EventRecipientCache {
+    int next;                   /* set to replace next */
+    EventRecipientsRec sets[RECIPIENT_SETS];
+} EventRecipientCacheRec, *EventRecipientCachePtr;
+
+static DevPrivateKeyRec EventRecipientsKeyRec;
+
+#define EventRecipientsKey (&EventRecipientsKeyRec)
+
+static unsigned long recipientsSerial = 1;
+
+/**
+ * Drop all cached event recipients.  Must be called whenever an event
+ * selection of any client on any window changes.
+ */
+void
+InvalidateEventRecipients(void)
+{
+    recipientsSerial++;
+}
+
+/**
+ * Free the event recipient cache of win.  Events delivered to win later
+ * on, like the PropertyNotify of a window being destroyed, may allocate
+ * it again.
+ */
+void
+FreeEventRecipients(WindowPtr win)
+{
+    EventRecipientCachePtr cache;
+    int i;
+
+    if (!dixPrivateKeyRegistered(EventRecipientsKey))
+        return;
+    cache = dixLookupPrivate(&win->devPrivates, EventRecipientsKey);
+    if (!cache)
+        return;
+    for (i = 0; i < RECIPIENT_SETS; i++)
+        free(cache->sets[i].recipients);
+    free(cache);
+    dixSetPrivate(&win->devPrivates, EventRecipientsKey, NULL);
+}
+
+/**
+ * Return the clients in iclients, the client list of win for this
+ * event, whose event mask accepts the event, or NULL if they can't be
+ * cached.
+ */
+static EventRecipientsPtr
+GetEventRecipients(DeviceIntPtr dev, WindowPtr win, xEvent *events,
+                   Mask filter, InputClients * iclients)
+{
+    EventRecipientCachePtr cache;
+    EventRecipientsPtr set;
+    EventRecipientPtr recipients;
+    int i, n, level, deviceid, type;
+    Mask mask;
+
+    /* nobody but the owner to deliver to, nothing worth caching */
+    if (!iclients || filter == CantBeFiltered ||
+        !dixPrivateKeyRegistered(EventRecipientsKey))
+        return NULL;
+
+    if ((type = xi2_get_type(events))) {
+        level = XI2;
+        deviceid = dev->id;
+    }
+    else if (core_get_type(events) != 0) {
+        level = CORE;
+        deviceid = XIAllDevices;
+        type = filter;
+    }
+    else {
+        level = XI;
+        deviceid = dev->id;
+        type = filter;
+    }
+
+    cache = dixLookupPrivate(&win->devPrivates, EventRecipientsKey);
+    if (!cache) {
+        cache = calloc(1, sizeof(EventRecipientCacheRec));
+        if (!cache)
+            return NULL;
+        dixSetPrivate(&win->devPrivates, EventRecipientsKey, cache);
+    }
+
+    for (i = 0; i < RECIPIENT_SETS; i++) {
+        set = &cache->sets[i];
+        if (set->serial == recipientsSerial && set->level == level &&
+            set->deviceid == deviceid && set->type == type)
+            return set;
+    }
+
+    set = &cache->sets[cache->next];
+    cache->next = (cache->next + 1) % RECIPIENT_SETS;
+    set->serial = 0;
+
+    for (n = 0; iclients; iclients = iclients->next) {
+        mask = GetEventMask(dev, events, iclients);
+        if (!(mask & filter))
+            continue;
+        if (n == set->size) {
+            recipients = realloc(set->recipients,
+                                 (n + 8) * sizeof(EventRecipientRec));
+            if (!recipients)
+                return NULL;
+            set->recipients = recipients;
+            set->size = n + 8;
+        }
+        set->recipients[n].client = rClient(iclients);
+        set->recipients[n].mask = mask;
+        n++;
+    }
+
+    set->serial = recipientsSerial;
+    set->level = level;
+    set->deviceid = deviceid;
+    set->type = type;
+    set->num = n;
+    return set;
+}
+
 /**
  * Get the list of clients that should be tried for event delivery on the
  * given window.
@@ -2071,43 +2219,72 @@ GetClientsForDelivery(DeviceIntPtr dev, WindowPtr win,
  * Try delivery on each client in inputclients, provided the event mask
  * accepts it and there is no interfering core grab..
  */
+static void
+DeliverEventToInputClient(DeviceIntPtr dev, ClientPtr client, Mask mask,
+                          WindowPtr win, xEvent *events,
+                          int count, Mask filter, GrabPtr grab,
+                          enum EventDeliveryState *rc,
+                          ClientPtr *client_return, Mask *mask_return)
+{
+    int attempt;
+
+    if (IsInterferingGrab(client, dev, events))
+        return;
+
+    if (IsWrongPointerBarrierClient(client, dev, events))
+        return;
+
+    if (XaceHook(XACE_RECEIVE_ACCESS, client, win, events, count))
+        /* do nothing */ ;
+    else if ((attempt = TryClientEvents(client, dev,
+                                        events, count,
+                                        mask, filter, grab))) {
+        if (attempt > 0) {
+            *rc = EVENT_DELIVERED;
+            *client_return = client;
+            *mask_return = mask;
+            /* Success overrides non-success, so if we've been
+             * successful on one client, return that */
+        }
+        else if (*rc == EVENT_NOT_DELIVERED)
+            *rc = EVENT_REJECTED;
+    }
+}
+
 static enum EventDeliveryState
 DeliverEventToInputClients(DeviceIntPtr dev, InputClients * inputclients,
                            WindowPtr win, xEvent *events,
                            int count, Mask filter, GrabPtr grab,
                            ClientPtr *client_return, Mask *mask_return)
 {
-    int attempt;
     enum EventDeliveryState rc = EVENT_NOT_DELIVERED;
 
-    for (; inputclients; inputclients = inputclients->next) {
-        Mask mask;
-        ClientPtr client = rClient(inputclients);
+    for (; inputclients; inputclients = inputclients->next)
+        DeliverEventToInputClient(dev, rClient(inputclients),
+                                  GetEventMask(dev, events, inputclients),
+                                  win, events, count, filter, grab,
+                                  &rc, client_return, mask_return);
 
-        if (IsInterferingGrab(client, dev, events))
-            continue;
+    return rc;
+}
 
-        if (IsWrongPointerBarrierClient(client, dev, events))
-            continue;
+/**
+ * Try delivery on each of the cached recipients.
+ */
+static enum EventDeliveryState
+DeliverEventToRecipients(DeviceIntPtr dev, EventRecipientsPtr set,
+                         WindowPtr win, xEvent *events,
+                         int count, Mask filter, GrabPtr grab,
+                         ClientPtr *client_return, Mask *mask_return)
+{
+    enum EventDeliveryState rc = EVENT_NOT_DELIVERED;
+    int i;
 
-        mask = GetEventMask(dev, events, inputclients);
-
-        if (XaceHook(XACE_RECEIVE_ACCESS, client, win, events, count))
-            /* do nothing */ ;
-        else if ((attempt = TryClientEvents(client, dev,
-                                            events, count,
-                                            mask, filter, grab))) {
-            if (attempt > 0) {
-                rc = EVENT_DELIVERED;
-                *client_return = client;
-                *mask_return = mask;
-                /* Success overrides non-success, so if we've been
-                 * successful on one client, return that */
-            }
-            else if (rc == EVENT_NOT_DELIVERED)
-                rc = EVENT_REJECTED;
-        }
-    }
+    for (i = 0; i < set->num; i++)
+        DeliverEventToInputClient(dev, set->recipients[i].client,
+                                  set->recipients[i].mask,
+                                  win, events, count, filter, grab,
+                                  &rc, client_return, mask_return);
 
     return rc;
 }
@@ -2125,10 +2302,15 @@ DeliverEventToWindowMask(DeviceIntPtr dev, WindowPtr win, xEvent *events,
                          ClientPtr *client_return, Mask *mask_return)
 {
     InputClients *iclients;
+    EventRecipientsPtr set;
 
     if (!GetClientsForDelivery(dev, win, events, filter, &iclients))
         return EVENT_SKIP;
 
+    if ((set = GetEventRecipients(dev, win, events, filter, iclients)))
+        return DeliverEventToRecipients(dev, set, win, events, count, filter,
+                                        grab, client_return, mask_return);
+
     return DeliverEventToInputClients(dev, iclients, win, events, count, filter,
                                       grab, client_return, mask_return);
 
@@ -2274,8 +2456,9 @@ DeliverRawEvent(RawDeviceEvent *ev, DeviceIntPtr device)
 {
     GrabPtr grab = device->deviceGrab.grab;
     xEvent *xi;
-    int i, rc;
+    int i, j, rc;
     int filter;
+    EventRecipientsPtr set;
 
     rc = EventToXI2((InternalEvent *) ev, (xEvent **) &xi);
     if (rc != Success) {
@@ -2297,6 +2480,23 @@ DeliverRawEvent(RawDeviceEvent *ev, DeviceIntPtr device)
         if (!GetClientsForDelivery(device, root, xi, filter, &inputclients))
             continue;
 
+        if ((set = GetEventRecipients(device, root, xi, filter,
+                                      inputclients))) {
+            for (j = 0; j < set->num; j++) {
+                ClientPtr c;    /* unused */
+                Mask m;         /* unused */
+                enum EventDeliveryState state = EVENT_NOT_DELIVERED;
+
+                if (!FilterRawEvents(set->recipients[j].client, grab, root))
+                    DeliverEventToInputClient(device,
+                                              set->recipients[j].client,
+                                              set->recipients[j].mask,
+                                              root, xi, 1, filter, NULL,
+                                              &state, &c, &m);
+            }
+            continue;
+        }
+
         for (; inputclients; inputclients = inputclients->next) {
             ClientPtr c;        /* unused */
             Mask m;             /* unused */
@@ -2779,6 +2979,63 @@ PointInBorderSize(WindowPtr pWin, int x, int y)
     return FALSE;
 }
 
+/* TRUE if the pointer at x/y is inside pWin for the purpose of XYToWindow */
+static Bool
+WindowContainsPointer(WindowPtr pWin, int x, int y)
+{
+    BoxRec box;
+
+    return (pWin->mapped) &&
+        (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
+        (x < pWin->drawable.x + (int) pWin->drawable.width +
+         wBorderWidth(pWin)) &&
+        (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
+        (y < pWin->drawable.y + (int) pWin->drawable.height +
+         wBorderWidth(pWin))
+        /* When a window is shaped, a further check
+         * is made to see if the point is inside
+         * borderSize
+         */
+        && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
+        && (!wInputShape(pWin) ||
+            RegionContainsPoint(wInputShape(pWin),
+                                x - pWin->drawable.x,
+                                y - pWin->drawable.y, &box))
+#ifdef ROOTLESS
+        /* In rootless mode windows may be offscreen, even when
+         * they're in X's stack. (E.g. if the native window system
+         * implements some form of virtual desktop system).
+         */
+        && !pWin->rootlessUnhittable
+#endif
+        ;
+}
+
+/*
+ * The topmost child of pParent containing the pointer at x/y.  Parents
+ * with many children have an index that narrows down the children worth
+ * testing, see winindex.c.
+ */
+static WindowPtr
+ChildContainingPointer(WindowPtr pParent, int x, int y)
+{
+    WindowPtr pWin, *candidates;
+    int i, n;
+
+    candidates = WindowIndexLookup(pParent, x, y, &n);
+    if (candidates) {
+        for (i = 0; i < n; i++)
+            if (WindowContainsPointer(candidates[i], x, y))
+                return candidates[i];
+        return NullWindow;
+    }
+
+    for (pWin = pParent->firstChild; pWin; pWin = pWin->nextSib)
+        if (WindowContainsPointer(pWin, x, y))
+            return pWin;
+    return NullWindow;
+}
+
 /**
  * Traversed from the root window to the window at the position x/y. While
  * traversing, it sets up the traversal history in the spriteTrace array.
@@ -2794,7 +3051,6 @@ WindowPtr
 XYToWindow(SpritePtr pSprite, int x, int y)
 {
     WindowPtr pWin;
-    BoxRec box;
 
     pSprite->spriteTraceGood = 1;       /* root window still there */
     if (pSprite->redirectWindow == PointerRootWin) {
@@ -2803,46 +3059,17 @@ XYToWindow(SpritePtr pSprite, int x, int y)
     else if (pSprite->redirectWindow) {
         pWin = pSprite->redirectWindow;
         pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-        pWin = pWin->firstChild;
     }
     else
-        pWin = RootWindow(pSprite)->firstChild;
-    while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
-            /* When a window is shaped, a further check
-             * is made to see if the point is inside
-             * borderSize
-             */
-            && (!wBoundingShape(pWin) || PointInBorderSize(pWin, x, y))
-            && (!wInputShape(pWin) ||
-                RegionContainsPoint(wInputShape(pWin),
-                                    x - pWin->drawable.x,
-                                    y - pWin->drawable.y, &box))
-#ifdef ROOTLESS
-            /* In rootless mode windows may be offscreen, even when
-             * they're in X's stack. (E.g. if the native window system
-             * implements some form of virtual desktop system).
-             */
-            && !pWin->rootlessUnhittable
-#endif
-            ) {
-            if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
-                pSprite->spriteTraceSize += 10;
-                pSprite->spriteTrace = realloc(pSprite->spriteTrace,
-                                               pSprite->spriteTraceSize *
-                                               sizeof(WindowPtr));
-            }
-            pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-            pWin = pWin->firstChild;
+        pWin = RootWindow(pSprite);
+    while ((pWin = ChildContainingPointer(pWin, x, y))) {
+        if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
+            pSprite->spriteTraceSize += 10;
+            pSprite->spriteTrace = realloc(pSprite->spriteTrace,
+                                           pSprite->spriteTraceSize *
+                                           sizeof(WindowPtr));
         }
-        else
-            pWin = pWin->nextSib;
+        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
     }
     return DeepestSpriteWin(pSprite);
 }
@@ -4315,6 +4542,8 @@ RecalculateDeliverableEvents(WindowPtr pWin)
     OtherClients *others;
     WindowPtr pChild;
 
+    InvalidateEventRecipients();
+
     pChild = pWin;
     while (1) {
         if (pChild->optional) {
@@ -5289,6 +5518,10 @@ InitEvents(void)
     InputEventList = InitEventList(GetMaximumEventsNum());
     if (!InputEventList)
         FatalError("[dix] Failed to allocate input event list.\n");
+
+    if (!dixRegisterPrivateKey(EventRecipientsKey, PRIVATE_WINDOW, 0))
+        FatalError("[dix] Failed to register event recipients key.\n");
+    InvalidateEventRecipients();
 }
 
 void
@@ -5757,6 +5990,9 @@ DeleteWindowFromAnyEvents(WindowPtr pWin, Bool freeResources)
     }
 
     DeleteWindowFromAnyExtEvents(pWin, freeResources);
+
+    if (freeResources)
+        FreeEventRecipients(pWin);
 }
 
 /**
@@ -126,6 +126,8 @@ TimeStamp lastDeviceEventTime[MAXDEVICES];
 
 int defaultColorVisualClass = -1;
 int monitorResolution = 0;
+int renderThreads = 1;
+int shadowRefreshRate = 60;
 
 char *display;
 int displayfd;
@@ -40,6 +40,7 @@ from The Open Group.
 #include "gcstruct.h"
 #include "servermd.h"
 #include "site.h"
+#include "slab.h"
 
 /*
  *  Scratch pixmap management and device independent pixmap allocation
@@ -103,18 +104,42 @@ FreeScratchPixmapsForScreen(ScreenPtr pScreen)
     FreeScratchPixmapHeader(pScreen->pScratchPixmap);
 }
 
+/* Pixmap headers, and pixmaps with up to PIXMAP_SLAB_DATA bytes of
+ * pixels such as tiles and stipples, come from slab caches, one for
+ * every PIXMAP_SLAB_ALIGN multiple of data size. */
+#define PIXMAP_SLAB_DATA        512
+#define PIXMAP_SLAB_ALIGN       64
+
+static SlabCachePtr pixmapCaches[PIXMAP_SLAB_DATA / PIXMAP_SLAB_ALIGN + 1];
+
+static PixmapPtr
+AllocatePixmapFromSlab(ScreenPtr pScreen, int pixDataSize)
+{
+    int class = (pixDataSize + PIXMAP_SLAB_ALIGN - 1) / PIXMAP_SLAB_ALIGN;
+    unsigned int size = pScreen->totalPixmapSize + class * PIXMAP_SLAB_ALIGN;
+
+    if (!pixmapCaches[class] || SlabCacheSize(pixmapCaches[class]) != size)
+        pixmapCaches[class] = SlabGetCache("PIXMAP", size);
+    if (!pixmapCaches[class])
+        return NullPixmap;
+    return SlabAlloc(pixmapCaches[class]);
+}
+
 /* callable by ddx */
 PixmapPtr
 AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
 {
-    PixmapPtr pPixmap;
+    PixmapPtr pPixmap = NullPixmap;
 
     assert(pScreen->totalPixmapSize > 0);
 
     if (pScreen->totalPixmapSize > ((size_t) - 1) - pixDataSize)
         return NullPixmap;
 
-    pPixmap = malloc(pScreen->totalPixmapSize + pixDataSize);
+    if (pixDataSize <= PIXMAP_SLAB_DATA)
+        pPixmap = AllocatePixmapFromSlab(pScreen, pixDataSize);
+    if (!pPixmap)
+        pPixmap = malloc(pScreen->totalPixmapSize + pixDataSize);
     if (!pPixmap)
         return NullPixmap;
 
@@ -127,7 +152,8 @@ void
 FreePixmap(PixmapPtr pPixmap)
 {
     dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
-    free(pPixmap);
+    if (!SlabFree(pPixmap))
+        free(pPixmap);
 }
 
 PixmapPtr PixmapShareToSlave(PixmapPtr pixmap, ScreenPtr slave)
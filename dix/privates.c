@@ -63,6 +63,7 @@ from The Open Group.
 #include "scrnintstr.h"
 #include "extnsionst.h"
 #include "inputstr.h"
+#include "slab.h"
 
 static DevPrivateSetRec global_keys[PRIVATE_LAST];
 
@@ -129,6 +130,15 @@ static const Bool screen_specific_private[PRIVATE_LAST] = {
     [PRIVATE_GLYPHSET] = FALSE,
 };
 
+/* Objects allocated from slab caches, see dix/slab.c.  Every object of
+ * these types must be freed with dixFreeObjectWithPrivates. */
+static const Bool slab_private[PRIVATE_LAST] = {
+    [PRIVATE_WINDOW] = TRUE,
+    [PRIVATE_GC] = TRUE,
+};
+
+static SlabCachePtr slab_caches[PRIVATE_LAST];
+
 typedef Bool (*FixupFunc) (PrivatePtr *privates, int offset, unsigned bytes);
 
 typedef enum { FixupMove, FixupRealloc } FixupType;
@@ -536,7 +546,8 @@ _dixFreeObjectWithPrivates(void *object, PrivatePtr privates,
                            DevPrivateType type)
 {
     _dixFiniPrivates(privates, type);
-    free(object);
+    if (!slab_private[type] || !SlabFree(object))
+        free(object);
 }
 
 /*
@@ -701,7 +712,17 @@ _dixAllocateScreenObjectWithPrivates(ScreenPtr pScreen,
     /* round up so that void * is aligned */
     baseSize = (baseSize + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
     totalSize = baseSize + privates_size;
-    object = malloc(totalSize);
+    if (slab_private[type]) {
+        /* screens normally agree on the size of the privates */
+        if (!slab_caches[type] ||
+            SlabCacheSize(slab_caches[type]) != totalSize)
+            slab_caches[type] = SlabGetCache(key_names[type], totalSize);
+        object = slab_caches[type] ? SlabAlloc(slab_caches[type]) : NULL;
+        if (!object)
+            object = malloc(totalSize);
+    }
+    else
+        object = malloc(totalSize);
     if (!object)
         return NULL;
 
@@ -773,5 +794,8 @@ dixResetPrivates(void)
         global_keys[t].offset = 0;
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
+        slab_caches[t] = NULL;
     }
+    /* the privates of the next generation have different sizes */
+    SlabShrink();
 }
@@ -86,6 +86,361 @@ PrintPropertys(WindowPtr pWin)
 }
 #endif
 
+/*
+ * Property index.
+ *
+ * The properties of a window are a list, newest first, and that order is
+ * what ListProperties reports.  Looking a property up means walking the
+ * list, which on a root window carrying hundreds of properties costs
+ * every GetProperty and ChangeProperty a few hundred compares.  Windows
+ * whose list is at least PROPERTY_INDEX_MIN long get a hash table from
+ * property name to the first property of that name in the list, kept in
+ * a window private.  Each entry also remembers the property in front of
+ * it, so a property can be unlinked without walking the list either.
+ *
+ * The list stays the authoritative store: the index is built from it the
+ * first time a lookup has to walk far, and is updated when properties
+ * are added or removed.  Security modules may keep several properties of
+ * the same name; once that happens, removals fall back to walking the
+ * list and drop the index, which the next long walk rebuilds.
+ */
+
+#define PROPERTY_INDEX_MIN      16
+#define PROPERTY_INDEX_INITIAL  64      /* buckets, a power of two */
+
+typedef struct _PropertyIndexEntry {
+    Atom name;                  /* None for an empty bucket */
+    PropertyPtr prop;           /* first property named name */
+    PropertyPtr prev;           /* the one in front of it, NULL for head */
+} PropertyIndexEntryRec, *PropertyIndexEntryPtr;
+
+typedef struct _PropertyIndex {
+    int num;
+    int size;
+    Bool duplicates;            /* some name is in the list twice */
+    PropertyIndexEntryPtr entries;
+} PropertyIndexRec, *PropertyIndexPtr;
+
+static DevPrivateKeyRec PropertyIndexKeyRec;
+
+#define PropertyIndexKey (&PropertyIndexKeyRec)
+
+/*
+ * Register the private holding the index; called before the root
+ * windows are created.
+ */
+Bool
+InitPropertyIndex(void)
+{
+    return dixRegisterPrivateKey(&PropertyIndexKeyRec, PRIVATE_WINDOW, 0);
+}
+
+static PropertyIndexPtr
+GetPropertyIndex(WindowPtr pWin)
+{
+    if (!dixPrivateKeyRegistered(PropertyIndexKey))
+        return NULL;
+    return dixLookupPrivate(&pWin->devPrivates, PropertyIndexKey);
+}
+
+static void
+PropertyIndexFree(WindowPtr pWin)
+{
+    PropertyIndexPtr index = GetPropertyIndex(pWin);
+
+    if (index) {
+        free(index->entries);
+        free(index);
+        dixSetPrivate(&pWin->devPrivates, PropertyIndexKey, NULL);
+    }
+}
+
+static inline unsigned int
+PropertyIndexHash(PropertyIndexPtr index, Atom name)
+{
+    return (name * 2654435761U) & (index->size - 1);
+}
+
+static PropertyIndexEntryPtr
+PropertyIndexFind(PropertyIndexPtr index, Atom name)
+{
+    unsigned int i = PropertyIndexHash(index, name);
+
+    while (index->entries[i].name != None) {
+        if (index->entries[i].name == name)
+            return &index->entries[i];
+        i = (i + 1) & (index->size - 1);
+    }
+    return NULL;
+}
+
+/* The caller makes sure name isn't there yet and a bucket is free */
+static void
+PropertyIndexAdd(PropertyIndexPtr index, PropertyPtr pProp, PropertyPtr prev)
+{
+    unsigned int i = PropertyIndexHash(index, pProp->propertyName);
+
+    while (index->entries[i].name != None)
+        i = (i + 1) & (index->size - 1);
+    index->entries[i].name = pProp->propertyName;
+    index->entries[i].prop = pProp;
+    index->entries[i].prev = prev;
+    index->num++;
+}
+
+/* Empty a bucket, moving up the entries that probed past it */
+static void
+PropertyIndexRemove(PropertyIndexPtr index, PropertyIndexEntryPtr entry)
+{
+    unsigned int mask = index->size - 1;
+    unsigned int i = entry - index->entries;
+    unsigned int j = i, home;
+
+    for (;;) {
+        index->entries[i].name = None;
+        do {
+            j = (j + 1) & mask;
+            if (index->entries[j].name == None) {
+                index->num--;
+                return;
+            }
+            home = PropertyIndexHash(index, index->entries[j].name);
+        } while (i <= j ? (i < home && home <= j) : (i < home || home <= j));
+        index->entries[i] = index->entries[j];
+        i = j;
+    }
+}
+
+static Bool
+PropertyIndexResize(PropertyIndexPtr index, int size)
+{
+    PropertyIndexEntryPtr old = index->entries;
+    int i, oldSize = index->size;
+
+    index->entries = calloc(size, sizeof(PropertyIndexEntryRec));
+    if (!index->entries) {
+        index->entries = old;
+        return FALSE;
+    }
+    index->size = size;
+    index->num = 0;
+    for (i = 0; i < oldSize; i++)
+        if (old[i].name != None)
+            PropertyIndexAdd(index, old[i].prop, old[i].prev);
+    free(old);
+    return TRUE;
+}
+
+static void
+PropertyIndexBuild(WindowPtr pWin)
+{
+    PropertyIndexPtr index;
+    PropertyPtr pProp, prev = NULL;
+    int num = 0, size = PROPERTY_INDEX_INITIAL;
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+        num++;
+    while (size < num * 2)
+        size <<= 1;
+
+    index = calloc(1, sizeof(PropertyIndexRec));
+    if (!index)
+        return;
+    index->entries = calloc(size, sizeof(PropertyIndexEntryRec));
+    if (!index->entries) {
+        free(index);
+        return;
+    }
+    index->size = size;
+
+    for (pProp = wUserProps(pWin); pProp; prev = pProp, pProp = pProp->next) {
+        if (PropertyIndexFind(index, pProp->propertyName))
+            index->duplicates = TRUE;
+        else
+            PropertyIndexAdd(index, pProp, prev);
+    }
+    dixSetPrivate(&pWin->devPrivates, PropertyIndexKey, index);
+}
+
+/* pProp was just put at the head of the list, in front of next */
+static void
+PropertyIndexInsertHead(WindowPtr pWin, PropertyPtr pProp, PropertyPtr next)
+{
+    PropertyIndexPtr index = GetPropertyIndex(pWin);
+    PropertyIndexEntryPtr entry;
+
+    if (!index)
+        return;
+
+    if (next && (entry = PropertyIndexFind(index, next->propertyName)) &&
+        entry->prop == next)
+        entry->prev = pProp;
+
+    if ((entry = PropertyIndexFind(index, pProp->propertyName))) {
+        entry->prop = pProp;
+        entry->prev = NULL;
+        index->duplicates = TRUE;
+        return;
+    }
+    if (index->num * 2 >= index->size &&
+        !PropertyIndexResize(index, index->size * 2)) {
+        PropertyIndexFree(pWin);
+        return;
+    }
+    PropertyIndexAdd(index, pProp, NULL);
+}
+
+static PropertyPtr
+FindProperty(WindowPtr pWin, Atom propertyName)
+{
+    PropertyIndexPtr index = GetPropertyIndex(pWin);
+    PropertyIndexEntryPtr entry;
+    PropertyPtr pProp;
+    int walked = 0;
+
+    if (index) {
+        entry = PropertyIndexFind(index, propertyName);
+        return entry ? entry->prop : NULL;
+    }
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next) {
+        if (pProp->propertyName == propertyName)
+            break;
+        walked++;
+    }
+
+    if (walked >= PROPERTY_INDEX_MIN &&
+        dixPrivateKeyRegistered(PropertyIndexKey))
+        PropertyIndexBuild(pWin);
+    return pProp;
+}
+
+/*
+ * Take pProp off the list of pWin, without freeing it.
+ */
+static void
+UnlinkProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    PropertyIndexPtr index = GetPropertyIndex(pWin);
+    PropertyIndexEntryPtr entry = NULL;
+    PropertyPtr prevProp;
+
+    if (index && !index->duplicates &&
+        (entry = PropertyIndexFind(index, pProp->propertyName)) &&
+        entry->prop == pProp) {
+        prevProp = entry->prev;
+        PropertyIndexRemove(index, entry);
+    }
+    else {
+        if (index) {
+            PropertyIndexFree(pWin);
+            index = NULL;
+        }
+        /* Need to traverse to find the previous element */
+        prevProp = NULL;
+        if (pWin->optional->userProps != pProp) {
+            prevProp = pWin->optional->userProps;
+            while (prevProp->next != pProp)
+                prevProp = prevProp->next;
+        }
+    }
+
+    if (prevProp)
+        prevProp->next = pProp->next;
+    else
+        pWin->optional->userProps = pProp->next;
+
+    if (index && pProp->next &&
+        (entry = PropertyIndexFind(index, pProp->next->propertyName)) &&
+        entry->prop == pProp->next)
+        entry->prev = prevProp;
+
+    if (!pWin->optional->userProps) {
+        PropertyIndexFree(pWin);
+        CheckWindowOptionalNeed(pWin);
+    }
+}
+
+/*
+ * Property data.
+ *
+ * The value of a property lives in a buffer with a small header in front
+ * of it, which pProp->data points past, so code reading pProp->data sees
+ * plain bytes.  The header holds the size of the buffer and a reference
+ * count.
+ *
+ * Appending grows the buffer geometrically and writes the new bytes past
+ * the old ones, so a client building a large property a piece at a time,
+ * as INCR selection transfers do, no longer copies all of it on every
+ * append.  Everything else that changes a value builds a new buffer, so
+ * the bytes of a value never change once written.  That lets GetProperty
+ * hand the value to the output path by reference: the reply holds a
+ * reference until it has been written, and a property replaced or
+ * deleted in the meantime only drops its own.
+ */
+
+typedef struct _PropertyData {
+    unsigned long refcnt;
+    unsigned long capacity;     /* bytes available after the header */
+} PropertyDataRec, *PropertyDataPtr;
+
+#define PropertyDataHeader(data) ((PropertyDataPtr) (data) - 1)
+
+static unsigned char *
+PropertyDataAlloc(unsigned long capacity)
+{
+    PropertyDataPtr header = malloc(sizeof(PropertyDataRec) + capacity);
+
+    if (!header)
+        return NULL;
+    header->refcnt = 1;
+    header->capacity = capacity;
+    return (unsigned char *) (header + 1);
+}
+
+static void
+PropertyDataRef(pointer data)
+{
+    PropertyDataHeader(data)->refcnt++;
+}
+
+static void
+PropertyDataUnref(pointer data)
+{
+    PropertyDataPtr header;
+
+    if (!data)
+        return;
+    header = PropertyDataHeader(data);
+    if (--header->refcnt == 0)
+        free(header);
+}
+
+/*
+ * Make room for len more bytes after the used bytes of pProp.  Returns
+ * the data to write them to, which is pProp->data when there was room
+ * already, or NULL if out of memory.  A new buffer is only set up here;
+ * the caller installs it.
+ */
+static unsigned char *
+PropertyDataGrow(PropertyPtr pProp, unsigned long used, unsigned long len)
+{
+    PropertyDataPtr header = PropertyDataHeader(pProp->data);
+    unsigned long capacity;
+    unsigned char *data;
+
+    if (used + len <= header->capacity)
+        return pProp->data;
+
+    capacity = max(used + len, 2 * header->capacity);
+    data = PropertyDataAlloc(capacity);
+    if (!data && capacity > used + len)
+        data = PropertyDataAlloc(used + len);
+    if (data)
+        memcpy(data, pProp->data, used);
+    return data;
+}
+
 int
 dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
                   ClientPtr client, Mask access_mode)
@@ -95,10 +450,7 @@ dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
-
+    pProp = FindProperty(pWin, propertyName);
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
     *result = pProp;
@@ -263,8 +615,8 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         pProp = dixAllocateObjectWithPrivates(PropertyRec, PRIVATE_PROPERTY);
         if (!pProp)
             return BadAlloc;
-        data = malloc(totalSize);
-        if (!data && len) {
+        data = PropertyDataAlloc(totalSize);
+        if (!data) {
             dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
             return BadAlloc;
         }
@@ -277,13 +629,14 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         rc = XaceHookPropertyAccess(pClient, pWin, &pProp,
                                     DixCreateAccess | DixWriteAccess);
         if (rc != Success) {
-            free(data);
+            PropertyDataUnref(data);
             dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
             pClient->errorValue = property;
             return rc;
         }
         pProp->next = pWin->optional->userProps;
         pWin->optional->userProps = pProp;
+        PropertyIndexInsertHead(pWin, pProp, pProp->next);
     }
     else if (rc == Success) {
         /* To append or prepend to a property the request format and type
@@ -300,8 +653,8 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         savedProp = *pProp;
 
         if (mode == PropModeReplace) {
-            data = malloc(totalSize);
-            if (!data && len)
+            data = PropertyDataAlloc(totalSize);
+            if (!data)
                 return BadAlloc;
             memcpy(data, value, totalSize);
             pProp->data = data;
@@ -313,16 +666,18 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             /* do nothing */
         }
         else if (mode == PropModeAppend) {
-            data = malloc((pProp->size + len) * sizeInBytes);
+            /* the bytes past size aren't part of the value, so they can
+               be written in place even while a reply references it */
+            data = PropertyDataGrow(pProp, pProp->size * sizeInBytes,
+                                    totalSize);
             if (!data)
                 return BadAlloc;
-            memcpy(data, pProp->data, pProp->size * sizeInBytes);
             memcpy(data + pProp->size * sizeInBytes, value, totalSize);
             pProp->data = data;
             pProp->size += len;
         }
         else if (mode == PropModePrepend) {
-            data = malloc(sizeInBytes * (len + pProp->size));
+            data = PropertyDataAlloc(sizeInBytes * (len + pProp->size));
             if (!data)
                 return BadAlloc;
             memcpy(data + totalSize, pProp->data, pProp->size * sizeInBytes);
@@ -336,11 +691,11 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         rc = XaceHookPropertyAccess(pClient, pWin, &pProp, access_mode);
         if (rc == Success) {
             if (savedProp.data != pProp->data)
-                free(savedProp.data);
+                PropertyDataUnref(savedProp.data);
         }
         else {
             if (savedProp.data != pProp->data)
-                free(pProp->data);
+                PropertyDataUnref(pProp->data);
             *pProp = savedProp;
             return rc;
         }
@@ -365,7 +720,7 @@ ChangeWindowProperty(WindowPtr pWin, Atom property, Atom type, int format,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -373,21 +728,9 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        UnlinkProperty(pWin, pProp);
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp->propertyName);
-        free(pProp->data);
+        PropertyDataUnref(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
     }
     return rc;
@@ -398,11 +741,12 @@ DeleteAllWindowProperties(WindowPtr pWin)
 {
     PropertyPtr pProp, pNextProp;
 
+    PropertyIndexFree(pWin);
     pProp = wUserProps(pWin);
     while (pProp) {
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp->propertyName);
         pNextProp = pProp->next;
-        free(pProp->data);
+        PropertyDataUnref(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
         pProp = pNextProp;
     }
@@ -440,7 +784,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -538,25 +882,21 @@ ProcGetProperty(ClientPtr client)
             client->pSwapReplyFunc = (ReplySwapPtr) WriteToClient;
             break;
         }
-        WriteSwappedDataToClient(client, len, (char *) pProp->data + ind);
-    }
-
-    if (stuff->delete && (reply.bytesAfter == 0)) {
-        /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
+        if (client->swapped) {
+            WriteSwappedDataToClient(client, len, (char *) pProp->data + ind);
         }
         else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
+            /* no copy; the reference keeps the data around until written */
+            PropertyDataRef(pProp->data);
+            WriteToClientRef(client, len, (char *) pProp->data + ind,
+                             PropertyDataUnref, pProp->data);
         }
+    }
 
-        free(pProp->data);
+    if (stuff->delete && (reply.bytesAfter == 0)) {
+        /* Delete the Property */
+        UnlinkProperty(pWin, pProp);
+        PropertyDataUnref(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
     }
     return Success;
@@ -85,6 +85,10 @@ Equipment Corporation.
 #include "gc.h"
 #include <pixman.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #undef assert
 #ifdef REGION_DEBUG
 #define assert(expr) { \
@@ -361,6 +365,116 @@ RegionRectAlloc(RegionPtr pRgn, int n)
     return TRUE;
 }
 
+/*======================================================================
+ *	    Band primitives
+ *====================================================================*/
+
+/*
+ * The loops over the boxes of a band are done two boxes at a time with
+ * SSE2 where the compiler provides it: a BoxRec is four shorts, so a
+ * 128-bit register holds the x1, y1, x2, y2 of two boxes.  Any odd box
+ * left over is handled by the plain C loop, which is also all that is
+ * used elsewhere, so the results are the same either way.
+ */
+
+/* Returns the end of the band that starts at r */
+_X_INLINE static BoxPtr
+RegionFindBandEnd(BoxPtr r, BoxPtr rEnd)
+{
+    short y1 = r->y1;
+
+#ifdef __SSE2__
+    __m128i vy1 = _mm_set1_epi16(y1);
+
+    /* compare the y1 of both boxes, bytes 2-3 and 10-11 of the mask */
+    while (rEnd - r >= 2 &&
+           (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((__m128i *) r),
+                                              vy1)) & 0x0c0c) == 0x0c0c)
+        r += 2;
+#endif
+    while (r != rEnd && r->y1 == y1)
+        r++;
+    return r;
+}
+
+/* TRUE if the n boxes at a and b have the same x1 and x2 */
+_X_INLINE static Bool
+RegionBandsMatch(BoxPtr a, BoxPtr b, int n)
+{
+#ifdef __SSE2__
+    /* compare x1 and x2 of both boxes, bytes 0-1 and 4-5 of each half */
+    for (; n >= 2; n -= 2, a += 2, b += 2) {
+        __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128((__m128i *) a),
+                                     _mm_loadu_si128((__m128i *) b));
+
+        if ((_mm_movemask_epi8(eq) & 0x3333) != 0x3333)
+            return FALSE;
+    }
+#endif
+    for (; n; n--, a++, b++)
+        if (a->x1 != b->x1 || a->x2 != b->x2)
+            return FALSE;
+    return TRUE;
+}
+
+/* Copy the x1 and x2 of n boxes from src to dst, setting y1 and y2;
+ * dst may be src */
+_X_INLINE static void
+RegionCopyBand(BoxPtr dst, BoxPtr src, int n, short y1, short y2)
+{
+#ifdef __SSE2__
+    const __m128i xmask = _mm_set_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+    const __m128i y = _mm_set_epi16(y2, 0, y1, 0, y2, 0, y1, 0);
+
+    for (; n >= 2; n -= 2, dst += 2, src += 2) {
+        __m128i box = _mm_loadu_si128((__m128i *) src);
+
+        _mm_storeu_si128((__m128i *) dst,
+                         _mm_or_si128(_mm_and_si128(box, xmask), y));
+    }
+#endif
+    for (; n; n--, dst++, src++) {
+        dst->x1 = src->x1;
+        dst->y1 = y1;
+        dst->x2 = src->x2;
+        dst->y2 = y2;
+    }
+}
+
+/* Widen *x1 and *x2 to the smallest x1 and largest x2 of n boxes */
+_X_INLINE static void
+RegionBandsExtentsX(BoxPtr box, int n, short *x1, short *x2)
+{
+    short minx = *x1, maxx = *x2;
+
+#ifdef __SSE2__
+    if (n >= 2) {
+        __m128i vmin = _mm_set1_epi16(minx);
+        __m128i vmax = _mm_set1_epi16(maxx);
+
+        for (; n >= 2; n -= 2, box += 2) {
+            __m128i b = _mm_loadu_si128((__m128i *) box);
+
+            vmin = _mm_min_epi16(vmin, b);
+            vmax = _mm_max_epi16(vmax, b);
+        }
+        /* x1 is in words 0 and 4, x2 in words 2 and 6 */
+        minx = min((short) _mm_extract_epi16(vmin, 0),
+                   (short) _mm_extract_epi16(vmin, 4));
+        maxx = max((short) _mm_extract_epi16(vmax, 2),
+                   (short) _mm_extract_epi16(vmax, 6));
+    }
+#endif
+    for (; n; n--, box++) {
+        if (box->x1 < minx)
+            minx = box->x1;
+        if (box->x2 > maxx)
+            maxx = box->x2;
+    }
+    *x1 = minx;
+    *x2 = maxx;
+}
+
 /*======================================================================
  *	    Generic Region Operator
  *====================================================================*/
@@ -419,26 +533,15 @@ RegionCoalesce(RegionPtr pReg,  /* Region to coalesce                */
      */
     y2 = pCurBox->y2;
 
-    do {
-        if ((pPrevBox->x1 != pCurBox->x1) || (pPrevBox->x2 != pCurBox->x2)) {
-            return curStart;
-        }
-        pPrevBox++;
-        pCurBox++;
-        numRects--;
-    } while (numRects);
+    if (!RegionBandsMatch(pPrevBox, pCurBox, numRects))
+        return curStart;
 
     /*
      * The bands may be merged, so set the bottom y of each box
      * in the previous band to the bottom y of the current band.
      */
-    numRects = curStart - prevStart;
     pReg->data->numRects -= numRects;
-    do {
-        pPrevBox--;
-        pPrevBox->y2 = y2;
-        numRects--;
-    } while (numRects);
+    RegionCopyBand(pPrevBox, pPrevBox, numRects, pPrevBox->y1, y2);
     return prevStart;
 }
 
@@ -478,16 +581,17 @@ RegionAppendNonO(RegionPtr pReg, BoxPtr r, BoxPtr rEnd, int y1, int y2)
 
     assert(y1 < y2);
     assert(newRects != 0);
+#ifdef REGION_DEBUG
+    /* the vector copy below has no room for per box checks */
+    for (pNextRect = r; pNextRect != rEnd; pNextRect++)
+        assert(pNextRect->x1 < pNextRect->x2);
+#endif
 
     /* Make sure we have enough space for all rectangles to be added */
     RECTALLOC(pReg, newRects);
     pNextRect = RegionTop(pReg);
     pReg->data->numRects += newRects;
-    do {
-        assert(r->x1 < r->x2);
-        ADDRECT(pNextRect, r->x1, y1, r->x2, y2);
-        r++;
-    } while (r != rEnd);
+    RegionCopyBand(pNextRect, r, newRects, y1, y2);
 
     return TRUE;
 }
@@ -495,10 +599,7 @@ RegionAppendNonO(RegionPtr pReg, BoxPtr r, BoxPtr rEnd, int y1, int y2)
 #define FindBand(r, rBandEnd, rEnd, ry1)		    \
 {							    \
     ry1 = r->y1;					    \
-    rBandEnd = r+1;					    \
-    while ((rBandEnd != rEnd) && (rBandEnd->y1 == ry1)) {   \
-	rBandEnd++;					    \
-    }							    \
+    rBandEnd = RegionFindBandEnd(r, rEnd);		    \
 }
 
 #define	AppendRegions(newReg, r, rEnd)					\
@@ -811,13 +912,8 @@ RegionSetExtents(RegionPtr pReg)
     pReg->extents.y2 = pBoxEnd->y2;
 
     assert(pReg->extents.y1 < pReg->extents.y2);
-    while (pBox <= pBoxEnd) {
-        if (pBox->x1 < pReg->extents.x1)
-            pReg->extents.x1 = pBox->x1;
-        if (pBox->x2 > pReg->extents.x2)
-            pReg->extents.x2 = pBox->x2;
-        pBox++;
-    };
+    RegionBandsExtentsX(pBox, pBoxEnd - pBox + 1,
+                        &pReg->extents.x1, &pReg->extents.x2);
 
     assert(pReg->extents.x1 < pReg->extents.x2);
 }
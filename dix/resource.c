@@ -105,8 +105,18 @@ Equipment Corporation.
  *      A resource ID is a 32 bit quantity, the upper 2 bits of which are
  *	off-limits for client-visible resources.  The next 8 bits are
  *      used as client ID, and the low 22 bits come from the client.
- *	A resource ID is "hashed" by extracting and xoring subfields
- *      (varying with the size of the hash table).
+ *
+ *      Each client has an open addressing hash table of its resources,
+ *      with linear probing: the id, type and value of a resource live
+ *      in the slot itself, so a lookup touches one or two cache lines
+ *      instead of walking a chain of separately allocated records.
+ *      Deleting moves the following entries of the run back instead of
+ *      leaving tombstones.  This keeps every resource sharing an id in
+ *      the order it was added, which FreeResource relies on to free
+ *      them newest first, like the bucket chains used to.  When a table
+ *      fills up, a table of twice the size is allocated and the entries
+ *      are moved over a few at a time by the following AddResource
+ *      calls, instead of all at once.
  *
  *      It is sometimes necessary for the server to create an ID that looks
  *      like it belongs to a client.  This ID, however,  must not be one
@@ -152,31 +162,45 @@ typedef const char *string;
 #define TypeNameString(t) LookupResourceName(t)
 #endif
 
-static void RebuildTable(int    /*client */
-    );
-
 #define SERVER_MINID 32
 
-#define INITBUCKETS 64
-#define INITHASHSIZE 6
-#define MAXHASHSIZE 11
+#define INITHASHSIZE 6          /* log(2) of the initial table size */
+#define MIGRATE_SLOTS 8         /* slots moved per AddResource when growing */
 
+/* A slot of a resource table; free slots have type RT_NONE */
 typedef struct _Resource {
-    struct _Resource *next;
     XID id;
     RESTYPE type;
     pointer value;
 } ResourceRec, *ResourcePtr;
 
-typedef struct _ClientResource {
-    ResourcePtr *resources;
+typedef struct _ResourceTable {
+    ResourcePtr slots;
+    int size;                   /* number of slots, a power of two */
+    int hashsize;               /* log(2)(size) */
     int elements;
-    int buckets;
-    int hashsize;               /* log(2)(buckets) */
+} ResourceTableRec, *ResourceTablePtr;
+
+typedef struct _ClientResource {
+    ResourceTableRec table;     /* where new resources are added */
+    ResourceTableRec old;       /* being moved into table while growing */
+    int migrated;               /* slots of old already moved */
+    unsigned int moves;         /* bumped whenever entries change slots */
+    unsigned int generation;    /* bumped whenever slot arrays change */
     XID fakeID;
     XID endFakeID;
 } ClientResourceRec;
 
+/* Walks all resources of a client, see NextResource */
+typedef struct _ResourceIter {
+    ClientResourceRec *rrec;
+    int table;                  /* 0 for old, 1 for table */
+    int start;                  /* a free slot, where the walk begins */
+    int slot;                   /* slots walked from start */
+    unsigned int moves;
+    unsigned int generation;
+} ResourceIterRec;
+
 RESTYPE lastResourceType;
 static RESTYPE lastResourceClass;
 RESTYPE TypeMask;
@@ -601,6 +625,244 @@ CreateNewResourceClass(void)
 
 static ClientResourceRec clientTable[MAXCLIENTS];
 
+static _X_INLINE int
+ResourceSlot(XID id, int hashsize)
+{
+    /* Fibonacci hashing scatters the sequential ids clients allocate,
+     * which would otherwise form long runs of occupied slots */
+    return (CARD32) (id * 2654435761U) >> (32 - hashsize);
+}
+
+static Bool
+InitResourceTable(ResourceTablePtr table, int hashsize)
+{
+    table->slots = calloc(1 << hashsize, sizeof(ResourceRec));
+    if (!table->slots)
+        return FALSE;
+    table->size = 1 << hashsize;
+    table->hashsize = hashsize;
+    table->elements = 0;
+    return TRUE;
+}
+
+static void
+FreeResourceTable(ResourceTablePtr table)
+{
+    free(table->slots);
+    table->slots = NULL;
+    table->size = 0;
+    table->hashsize = 0;
+    table->elements = 0;
+}
+
+/*
+ * Find the newest resource with the given id whose type is type, or
+ * whose type is in rclass when type is RT_NONE.  Resources sharing an
+ * id follow each other in the order they were added, so keep looking
+ * to the end of the run.
+ */
+static ResourcePtr
+FindInTable(ResourceTablePtr table, XID id, RESTYPE type, RESTYPE rclass)
+{
+    ResourcePtr res, found = NULL;
+    int i, mask;
+
+    if (!table->elements)
+        return NULL;
+    mask = table->size - 1;
+    for (i = ResourceSlot(id, table->hashsize);
+         (res = &table->slots[i])->type != RT_NONE; i = (i + 1) & mask) {
+        if (res->id == id && (type ? res->type == type : res->type & rclass))
+            found = res;
+    }
+    return found;
+}
+
+/* All resources sharing an id are always in the same table */
+static ResourcePtr
+FindResource(ClientResourceRec *rrec, XID id, RESTYPE type, RESTYPE rclass)
+{
+    ResourcePtr res;
+
+    res = FindInTable(&rrec->table, id, type, rclass);
+    if (!res && rrec->old.slots)
+        res = FindInTable(&rrec->old, id, type, rclass);
+    return res;
+}
+
+static void
+InsertInTable(ResourceTablePtr table, XID id, RESTYPE type, pointer value)
+{
+    ResourcePtr res;
+    int i, mask = table->size - 1;
+
+    for (i = ResourceSlot(id, table->hashsize);
+         (res = &table->slots[i])->type != RT_NONE; i = (i + 1) & mask);
+    res->id = id;
+    res->type = type;
+    res->value = value;
+    table->elements++;
+}
+
+/*
+ * Empty a slot and move later entries of the run back into the hole
+ * when that keeps them reachable from their home slot.  No entry is
+ * moved ahead of another one with the same home.
+ */
+static void
+RemoveFromTable(ClientResourceRec *rrec, ResourceTablePtr table,
+                ResourcePtr res)
+{
+    int i, j, home, mask = table->size - 1;
+
+    i = j = res - table->slots;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (table->slots[j].type == RT_NONE)
+            break;
+        home = ResourceSlot(table->slots[j].id, table->hashsize);
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        table->slots[i] = table->slots[j];
+        i = j;
+        rrec->moves++;
+    }
+    table->slots[i].type = RT_NONE;
+    table->slots[i].value = NULL;
+    table->elements--;
+}
+
+static void
+RemoveResource(ClientResourceRec *rrec, ResourcePtr res)
+{
+    ResourceTablePtr table = &rrec->table;
+
+    if (res < table->slots || res >= table->slots + table->size)
+        table = &rrec->old;
+    RemoveFromTable(rrec, table, res);
+}
+
+/* Move every resource with the given id from old to table, oldest first */
+static void
+MigrateResourceID(ClientResourceRec *rrec, XID id)
+{
+    ResourcePtr res;
+    int i, mask = rrec->old.size - 1;
+
+    for (;;) {
+        for (i = ResourceSlot(id, rrec->old.hashsize);
+             (res = &rrec->old.slots[i])->type != RT_NONE && res->id != id;
+             i = (i + 1) & mask);
+        if (res->type == RT_NONE)
+            break;
+        InsertInTable(&rrec->table, res->id, res->type, res->value);
+        RemoveFromTable(rrec, &rrec->old, res);
+        rrec->moves++;
+    }
+}
+
+/* Move the resources in the next count slots of old to table */
+static void
+MigrateResources(ClientResourceRec *rrec, int count)
+{
+    ResourcePtr res;
+
+    while (count-- > 0 && rrec->migrated < rrec->old.size) {
+        res = &rrec->old.slots[rrec->migrated];
+        /* moving an id can pull another entry into this slot */
+        while (res->type != RT_NONE)
+            MigrateResourceID(rrec, res->id);
+        rrec->migrated++;
+    }
+    if (rrec->migrated == rrec->old.size) {
+        FreeResourceTable(&rrec->old);
+        rrec->generation++;
+    }
+}
+
+/*
+ * Start moving the resources to a table twice the size once the table
+ * is half full.  By the time the new one is half full the old one has
+ * long been emptied, MIGRATE_SLOTS at a time.
+ */
+static void
+GrowResourceTable(ClientResourceRec *rrec)
+{
+    ResourceTableRec table;
+
+    if (rrec->old.slots)
+        MigrateResources(rrec, rrec->old.size);
+    if (!InitResourceTable(&table, rrec->table.hashsize + 1))
+        return;
+    rrec->old = rrec->table;
+    rrec->table = table;
+    rrec->migrated = 0;
+    rrec->generation++;
+}
+
+static void
+InitResourceIter(ResourceIterRec * iter, ClientResourceRec *rrec)
+{
+    iter->rrec = rrec;
+    iter->table = 0;
+    iter->start = -1;
+    iter->slot = 0;
+    iter->moves = rrec->moves;
+    iter->generation = rrec->generation;
+}
+
+/*
+ * Return the next resource of the client, or NULL when all were seen.
+ * The callers may add and free resources between calls.  Each table is
+ * walked starting from a free slot so that no run wraps around the end
+ * of the walk.  Entries only ever move back within their run, so when
+ * anything moved the walk resumes at the start of the current run; when
+ * the tables themselves changed it starts over.  Either way some
+ * resources can be returned twice.
+ */
+static ResourcePtr
+NextResource(ResourceIterRec * iter)
+{
+    ClientResourceRec *rrec = iter->rrec;
+    ResourceTablePtr table;
+    ResourcePtr res;
+    int mask;
+
+    if (iter->generation != rrec->generation) {
+        iter->table = 0;
+        iter->start = -1;
+        iter->slot = 0;
+    }
+    else if (iter->moves != rrec->moves && iter->start >= 0) {
+        table = iter->table ? &rrec->table : &rrec->old;
+        mask = table->size - 1;
+        while (iter->slot > 0 &&
+               table->slots[(iter->start + iter->slot - 1) & mask].type !=
+               RT_NONE)
+            iter->slot--;
+    }
+    iter->moves = rrec->moves;
+    iter->generation = rrec->generation;
+
+    for (; iter->table < 2; iter->table++, iter->start = -1, iter->slot = 0) {
+        table = iter->table ? &rrec->table : &rrec->old;
+        if (!table->elements)
+            continue;
+        mask = table->size - 1;
+        if (iter->start < 0) {
+            /* the tables are never full */
+            for (iter->start = 0; table->slots[iter->start].type != RT_NONE;
+                 iter->start++);
+        }
+        while (iter->slot < table->size) {
+            res = &table->slots[(iter->start + iter->slot++) & mask];
+            if (res->type != RT_NONE)
+                return res;
+        }
+    }
+    return NULL;
+}
+
 /*****************
  * InitClientResources
  *    When a new client is created, call this to allocate space
@@ -610,7 +872,7 @@ static ClientResourceRec clientTable[MAXCLIENTS];
 Bool
 InitClientResources(ClientPtr client)
 {
-    int i, j;
+    ClientResourceRec *rrec;
 
     if (client == serverClient) {
         lastResourceType = RT_LASTPREDEF;
@@ -622,24 +884,19 @@ InitClientResources(ClientPtr client)
             return FALSE;
         memcpy(resourceTypes, predefTypes, sizeof(predefTypes));
     }
-    clientTable[i = client->index].resources =
-        malloc(INITBUCKETS * sizeof(ResourcePtr));
-    if (!clientTable[i].resources)
+    rrec = &clientTable[client->index];
+    if (!InitResourceTable(&rrec->table, INITHASHSIZE))
         return FALSE;
-    clientTable[i].buckets = INITBUCKETS;
-    clientTable[i].elements = 0;
-    clientTable[i].hashsize = INITHASHSIZE;
+    rrec->migrated = 0;
+    rrec->generation++;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
      * clients, we can start from zero, with SERVER_BIT set.
      */
-    clientTable[i].fakeID = client->clientAsMask |
+    rrec->fakeID = client->clientAsMask |
         (client->index ? SERVER_BIT : SERVER_MINID);
-    clientTable[i].endFakeID = (clientTable[i].fakeID | RESOURCE_ID_MASK) + 1;
-    for (j = 0; j < INITBUCKETS; j++) {
-        clientTable[i].resources[j] = NULL;
-    }
+    rrec->endFakeID = (rrec->fakeID | RESOURCE_ID_MASK) + 1;
     return TRUE;
 }
 
@@ -662,8 +919,8 @@ HashResourceID(XID id, int numBits)
         case 11:
             return ((int)(0x7FF & (id ^ (id>>11))));
     }
-    if (numBits >= 11)
-        return ((int)(0x7FF & (id ^ (id>>11))));
+    if (numBits > 11 && numBits < 32)
+        return ((int)(((1 << numBits) - 1) & (id ^ (id>>numBits))));
     else
     {
         assert(numBits >= 0);
@@ -674,15 +931,10 @@ HashResourceID(XID id, int numBits)
 static XID
 AvailableID(int client, XID id, XID maxid, XID goodid)
 {
-    ResourcePtr res;
-
     if ((goodid >= id) && (goodid <= maxid))
         return goodid;
     for (; id <= maxid; id++) {
-        res = clientTable[client].resources[HashResourceID(id, clientTable[client].hashsize)];
-        while (res && (res->id != id))
-            res = res->next;
-        if (!res)
+        if (!FindResource(&clientTable[client], id, RT_NONE, RC_ANY))
             return id;
     }
     return 0;
@@ -692,9 +944,8 @@ void
 GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
 {
     XID id, maxid;
-    ResourcePtr *resp;
+    ResourceIterRec iter;
     ResourcePtr res;
-    int i;
     XID goodid;
 
     id = (Mask) client << CLIENTOFFSET;
@@ -702,18 +953,16 @@ GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
         id |= client ? SERVER_BIT : SERVER_MINID;
     maxid = id | RESOURCE_ID_MASK;
     goodid = 0;
-    for (resp = clientTable[client].resources, i = clientTable[client].buckets;
-         --i >= 0;) {
-        for (res = *resp++; res; res = res->next) {
-            if ((res->id < id) || (res->id > maxid))
-                continue;
-            if (((res->id - id) >= (maxid - res->id)) ?
-                (goodid = AvailableID(client, id, res->id - 1, goodid)) :
-                !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
-                maxid = res->id - 1;
-            else
-                id = res->id + 1;
-        }
+    InitResourceIter(&iter, &clientTable[client]);
+    while ((res = NextResource(&iter))) {
+        if ((res->id < id) || (res->id > maxid))
+            continue;
+        if (((res->id - id) >= (maxid - res->id)) ?
+            (goodid = AvailableID(client, id, res->id - 1, goodid)) :
+            !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
+            maxid = res->id - 1;
+        else
+            id = res->id + 1;
     }
     if (id > maxid)
         id = maxid = 0;
@@ -791,79 +1040,38 @@ AddResource(XID id, RESTYPE type, pointer value)
 {
     int client;
     ClientResourceRec *rrec;
-    ResourcePtr res, *head;
+    ResourceRec res;
 
 #ifdef XSERVER_DTRACE
     XSERVER_RESOURCE_ALLOC(id, type, value, TypeNameString(type));
 #endif
     client = CLIENT_ID(id);
     rrec = &clientTable[client];
-    if (!rrec->buckets) {
+    if (!rrec->table.slots) {
         ErrorF("[dix] AddResource(%lx, %x, %lx), client=%d \n",
                (unsigned long) id, type, (unsigned long) value, client);
         FatalError("client not in use\n");
     }
-    if ((rrec->elements >= 4 * rrec->buckets) && (rrec->hashsize < MAXHASHSIZE))
-        RebuildTable(client);
-    head = &rrec->resources[HashResourceID(id, clientTable[client].hashsize)];
-    res = malloc(sizeof(ResourceRec));
-    if (!res) {
+    if (rrec->old.slots) {
+        /* keep the resources sharing this id together, in order */
+        MigrateResourceID(rrec, id);
+        MigrateResources(rrec, MIGRATE_SLOTS);
+    }
+    if (rrec->table.elements >= rrec->table.size / 2)
+        GrowResourceTable(rrec);
+    /* always leave a free slot to end the runs */
+    if (rrec->table.elements >= rrec->table.size - 1) {
         (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
         return FALSE;
     }
-    res->next = *head;
-    res->id = id;
-    res->type = type;
-    res->value = value;
-    *head = res;
-    rrec->elements++;
-    CallResourceStateCallback(ResourceStateAdding, res);
+    InsertInTable(&rrec->table, id, type, value);
+    res.id = id;
+    res.type = type;
+    res.value = value;
+    CallResourceStateCallback(ResourceStateAdding, &res);
     return TRUE;
 }
 
-static void
-RebuildTable(int client)
-{
-    int j;
-    ResourcePtr res, next;
-    ResourcePtr **tails, *resources;
-    ResourcePtr **tptr, *rptr;
-
-    /*
-     * For now, preserve insertion order, since some ddx layers depend
-     * on resources being free in the opposite order they are added.
-     */
-
-    j = 2 * clientTable[client].buckets;
-    tails = malloc(j * sizeof(ResourcePtr *));
-    if (!tails)
-        return;
-    resources = malloc(j * sizeof(ResourcePtr));
-    if (!resources) {
-        free(tails);
-        return;
-    }
-    for (rptr = resources, tptr = tails; --j >= 0; rptr++, tptr++) {
-        *rptr = NULL;
-        *tptr = rptr;
-    }
-    clientTable[client].hashsize++;
-    for (j = clientTable[client].buckets,
-         rptr = clientTable[client].resources; --j >= 0; rptr++) {
-        for (res = *rptr; res; res = next) {
-            next = res->next;
-            res->next = NULL;
-            tptr = &tails[HashResourceID(res->id, clientTable[client].hashsize)];
-            **tptr = res;
-            *tptr = &res->next;
-        }
-    }
-    free(tails);
-    clientTable[client].buckets *= 2;
-    free(clientTable[client].resources);
-    clientTable[client].resources = resources;
-}
-
 static void
 doFreeResource(ResourcePtr res, Bool skip)
 {
@@ -871,42 +1079,28 @@ doFreeResource(ResourcePtr res, Bool skip)
 
     if (!skip)
         resourceTypes[res->type & TypeMask].deleteFunc(res->value, res->id);
-
-    free(res);
 }
 
 void
 FreeResource(XID id, RESTYPE skipDeleteFuncType)
 {
     int cid;
+    ClientResourceRec *rrec;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
-    int *eltptr;
-    int elements;
-
-    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-        eltptr = &clientTable[cid].elements;
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id) {
-                RESTYPE rtype = res->type;
-
+    ResourceRec this;
+
+    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].table.slots) {
+        rrec = &clientTable[cid];
+        /* look again every time, the delete functions may free
+         * or add other resources */
+        while ((res = FindResource(rrec, id, RT_NONE, RC_ANY))) {
+            this = *res;
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+            XSERVER_RESOURCE_FREE(this.id, this.type,
+                                  this.value, TypeNameString(this.type));
 #endif
-                *prev = res->next;
-                elements = --*eltptr;
-
-                doFreeResource(res, rtype == skipDeleteFuncType);
-
-                if (*eltptr != elements)
-                    prev = head;        /* prev may no longer be valid */
-            }
-            else
-                prev = &res->next;
+            RemoveResource(rrec, res);
+            doFreeResource(&this, this.type == skipDeleteFuncType);
         }
     }
 }
@@ -915,28 +1109,21 @@ void
 FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 {
     int cid;
+    ClientResourceRec *rrec;
     ResourcePtr res;
-    ResourcePtr *prev, *head;
-
-    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
+    ResourceRec this;
 
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id && res->type == type) {
+    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].table.slots) {
+        rrec = &clientTable[cid];
+        res = FindResource(rrec, id, type, RC_ANY);
+        if (res) {
+            this = *res;
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+            XSERVER_RESOURCE_FREE(this.id, this.type,
+                                  this.value, TypeNameString(this.type));
 #endif
-                *prev = res->next;
-                clientTable[cid].elements--;
-
-                doFreeResource(res, skipFree);
-
-                break;
-            }
-            else
-                prev = &res->next;
+            RemoveResource(rrec, res);
+            doFreeResource(&this, skipFree);
         }
     }
 }
@@ -953,14 +1140,12 @@ ChangeResourceValue(XID id, RESTYPE rtype, pointer value)
     int cid;
     ResourcePtr res;
 
-    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if ((res->id == id) && (res->type == rtype)) {
-                res->value = value;
-                return TRUE;
-            }
+    if (((cid = CLIENT_ID(id)) < MAXCLIENTS) && clientTable[cid].table.slots) {
+        res = FindResource(&clientTable[cid], id, rtype, RC_ANY);
+        if (res) {
+            res->value = value;
+            return TRUE;
+        }
     }
     return FALSE;
 }
@@ -975,26 +1160,16 @@ void
 FindClientResourcesByType(ClientPtr client,
                           RESTYPE type, FindResType func, pointer cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ResourceIterRec iter;
+    ResourcePtr this;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                elements = *eltptr;
-                (*func) (this->value, this->id, cdata);
-                if (*eltptr != elements)
-                    next = resources[i];        /* start over */
-            }
-        }
+    InitResourceIter(&iter, &clientTable[client->index]);
+    while ((this = NextResource(&iter))) {
+        if (!type || this->type == type)
+            (*func) (this->value, this->id, cdata);
     }
 }
 
@@ -1010,25 +1185,15 @@ void FindSubResources(pointer    resource,
 void
 FindAllClientResources(ClientPtr client, FindAllRes func, pointer cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ResourceIterRec iter;
+    ResourcePtr this;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            elements = *eltptr;
-            (*func) (this->value, this->id, this->type, cdata);
-            if (*eltptr != elements)
-                next = resources[i];    /* start over */
-        }
-    }
+    InitResourceIter(&iter, &clientTable[client->index]);
+    while ((this = NextResource(&iter)))
+        (*func) (this->value, this->id, this->type, cdata);
 }
 
 pointer
@@ -1036,24 +1201,20 @@ LookupClientResourceComplex(ClientPtr client,
                             RESTYPE type,
                             FindComplexResType func, pointer cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
+    ResourceIterRec iter;
+    ResourcePtr this;
     pointer value;
-    int i;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                /* workaround func freeing the type as DRI1 does */
-                value = this->value;
-                if ((*func) (value, this->id, cdata))
-                    return value;
-            }
+    InitResourceIter(&iter, &clientTable[client->index]);
+    while ((this = NextResource(&iter))) {
+        if (!type || this->type == type) {
+            /* workaround func freeing the type as DRI1 does */
+            value = this->value;
+            if ((*func) (value, this->id, cdata))
+                return value;
         }
     }
     return NULL;
@@ -1062,38 +1223,25 @@ LookupClientResourceComplex(ClientPtr client,
 void
 FreeClientNeverRetainResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    ResourcePtr *prev;
-    int j, elements;
-    int *eltptr;
+    ClientResourceRec *rrec;
+    ResourceIterRec iter;
+    ResourcePtr res;
+    ResourceRec this;
 
     if (!client)
         return;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        prev = &resources[j];
-        while ((this = *prev)) {
-            RESTYPE rtype = this->type;
-
-            if (rtype & RC_NEVERRETAIN) {
+    rrec = &clientTable[client->index];
+    InitResourceIter(&iter, rrec);
+    while ((res = NextResource(&iter))) {
+        if (res->type & RC_NEVERRETAIN) {
+            this = *res;
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(this->id, this->type,
-                                      this->value, TypeNameString(this->type));
+            XSERVER_RESOURCE_FREE(this.id, this.type,
+                                  this.value, TypeNameString(this.type));
 #endif
-                *prev = this->next;
-                clientTable[client->index].elements--;
-                elements = *eltptr;
-
-                doFreeResource(this, FALSE);
-
-                if (*eltptr != elements)
-                    prev = &resources[j];       /* prev may no longer be valid */
-            }
-            else
-                prev = &this->next;
+            RemoveResource(rrec, res);
+            doFreeResource(&this, FALSE);
         }
     }
 }
@@ -1101,9 +1249,9 @@ FreeClientNeverRetainResources(ClientPtr client)
 void
 FreeClientResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    int j;
+    ClientResourceRec *rrec;
+    ResourceIterRec iter;
+    ResourcePtr res;
 
     /* This routine shouldn't be called with a null client, but just in
        case ... */
@@ -1113,35 +1261,24 @@ FreeClientResources(ClientPtr client)
 
     HandleSaveSet(client);
 
-    resources = clientTable[client->index].resources;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        /* It may seem silly to update the head of this resource list as
-           we delete the members, since the entire list will be deleted any way, 
-           but there are some resource deletion functions "FreeClientPixels" for 
-           one which do a LookupID on another resource id (a Colormap id in this
-           case), so the resource list must be kept valid up to the point that
-           it is deleted, so every time we delete a resource, we must update the
-           head, just like in FreeResource. I hope that this doesn't slow down
-           mass deletion appreciably. PRH */
-
-        ResourcePtr *head;
-
-        head = &resources[j];
-
-        for (this = *head; this; this = *head) {
-#ifdef XSERVER_DTRACE
-            XSERVER_RESOURCE_FREE(this->id, this->type,
-                                  this->value, TypeNameString(this->type));
-#endif
-            *head = this->next;
-            clientTable[client->index].elements--;
-
-            doFreeResource(this, FALSE);
+    /* Resources are freed one id at a time, newest first, and the
+       table is kept valid throughout: some resource deletion functions
+       ("FreeClientPixels" for one) do a LookupID on another resource id
+       (a Colormap id in this case). */
+    rrec = &clientTable[client->index];
+    InitResourceIter(&iter, rrec);
+    while (rrec->table.elements + rrec->old.elements) {
+        res = NextResource(&iter);
+        if (!res) {
+            /* resources added while freeing */
+            InitResourceIter(&iter, rrec);
+            continue;
         }
+        FreeResource(res->id, RT_NONE);
     }
-    free(clientTable[client->index].resources);
-    clientTable[client->index].resources = NULL;
-    clientTable[client->index].buckets = 0;
+    FreeResourceTable(&rrec->table);
+    FreeResourceTable(&rrec->old);
+    rrec->generation++;
 }
 
 void
@@ -1150,7 +1287,7 @@ FreeAllResources(void)
     int i;
 
     for (i = currentMaxClients; --i >= 0;) {
-        if (clientTable[i].buckets)
+        if (clientTable[i].table.slots)
             FreeClientResources(clients[i]);
     }
 }
@@ -1191,13 +1328,8 @@ dixLookupResourceByType(pointer *result, XID id, RESTYPE rtype,
     if ((rtype & TypeMask) > lastResourceType)
         return BadImplementation;
 
-    if ((cid < MAXCLIENTS) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && res->type == rtype)
-                break;
-    }
+    if ((cid < MAXCLIENTS) && clientTable[cid].table.slots)
+        res = FindResource(&clientTable[cid], id, rtype, RC_ANY);
     if (!res)
         return resourceTypes[rtype & TypeMask].errorValue;
 
@@ -1224,13 +1356,8 @@ dixLookupResourceByClass(pointer *result, XID id, RESTYPE rclass,
 
     *result = NULL;
 
-    if ((cid < MAXCLIENTS) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && (res->type & rclass))
-                break;
-    }
+    if ((cid < MAXCLIENTS) && clientTable[cid].table.slots)
+        res = FindResource(&clientTable[cid], id, RT_NONE, rclass);
     if (!res)
         return BadValue;
 
@@ -0,0 +1,358 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Slab caches for frequently created server objects.
+ *
+ * Windows, GCs and pixmap headers are allocated together with their
+ * privates, so every object of a type has the same size for the life
+ * of a server generation.  A slab cache hands out objects of one size
+ * from SLAB_BYTES blocks aligned to their own size: allocating and
+ * freeing is a list operation, objects start on a cache line and
+ * objects of a type stay close together in memory.
+ *
+ * The slab an object belongs to is found by masking its address.  The
+ * slabs are registered in a hash table, so that SlabFree() can also be
+ * handed objects which came from malloc without touching memory that
+ * is not ours.  Each cache keeps at most one empty slab around;
+ * SlabShrink() releases those at server reset, when the sizes of the
+ * privates may change.  The caches themselves are never freed, so
+ * callers can hold on to them.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "misc.h"
+#include "os.h"
+#include "list.h"
+#include "slab.h"
+
+#define SLAB_SHIFT      14
+#define SLAB_BYTES      (1 << SLAB_SHIFT)
+#define SLAB_ALIGN      64      /* cache line */
+
+typedef struct _SlabCache SlabCacheRec;
+
+typedef struct _Slab {
+    struct xorg_list entry;     /* in partial or full of the cache */
+    SlabCachePtr cache;
+    void *memory;               /* as returned by the allocator */
+    void *freeList;
+    unsigned int used;
+} SlabRec, *SlabPtr;
+
+struct _SlabCache {
+    struct xorg_list entry;     /* in slabCaches */
+    const char *name;
+    unsigned int size;
+    unsigned int stride;        /* size rounded up for alignment */
+    unsigned int perSlab;
+    unsigned int offset;        /* of the first object in a slab */
+    struct xorg_list partial;   /* slabs with free objects */
+    struct xorg_list full;
+    SlabPtr empty;              /* kept for reuse */
+    unsigned long live;
+    unsigned long slabs;
+    unsigned long allocs;
+};
+
+static struct xorg_list slabCaches = { &slabCaches, &slabCaches };
+
+/* Hash set of all slabs, see SlabFree */
+static SlabPtr *slabTable;
+static int slabTableBits;
+static int slabCount;
+
+static _X_INLINE int
+SlabHash(SlabPtr slab)
+{
+    return (CARD32) (((uintptr_t) slab >> SLAB_SHIFT) * 2654435761U) >>
+        (32 - slabTableBits);
+}
+
+static Bool
+SlabRegistered(SlabPtr slab)
+{
+    int i, mask;
+
+    if (!slabCount)
+        return FALSE;
+    mask = (1 << slabTableBits) - 1;
+    for (i = SlabHash(slab); slabTable[i]; i = (i + 1) & mask)
+        if (slabTable[i] == slab)
+            return TRUE;
+    return FALSE;
+}
+
+static void
+SlabInsert(SlabPtr slab)
+{
+    int i, mask = (1 << slabTableBits) - 1;
+
+    for (i = SlabHash(slab); slabTable[i]; i = (i + 1) & mask);
+    slabTable[i] = slab;
+    slabCount++;
+}
+
+static Bool
+SlabRegister(SlabPtr slab)
+{
+    SlabPtr *old = slabTable;
+    int i, oldSize = slabTable ? 1 << slabTableBits : 0;
+
+    if (slabCount * 2 >= oldSize) {
+        slabTable = calloc(oldSize ? oldSize * 2 : 64, sizeof(SlabPtr));
+        if (!slabTable) {
+            slabTable = old;
+            return FALSE;
+        }
+        slabTableBits = oldSize ? slabTableBits + 1 : 6;
+        slabCount = 0;
+        for (i = 0; i < oldSize; i++)
+            if (old[i])
+                SlabInsert(old[i]);
+        free(old);
+    }
+    SlabInsert(slab);
+    return TRUE;
+}
+
+static void
+SlabUnregister(SlabPtr slab)
+{
+    int i, j, home, mask = (1 << slabTableBits) - 1;
+
+    for (i = SlabHash(slab); slabTable[i] != slab; i = (i + 1) & mask);
+    /* move the rest of the run back, as in dix/resource.c */
+    for (j = i;;) {
+        j = (j + 1) & mask;
+        if (!slabTable[j])
+            break;
+        home = SlabHash(slabTable[j]);
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        slabTable[i] = slabTable[j];
+        i = j;
+    }
+    slabTable[i] = NULL;
+    slabCount--;
+}
+
+static SlabPtr
+SlabCreate(SlabCachePtr cache)
+{
+    void *memory;
+    SlabPtr slab;
+    char *object;
+    unsigned int i;
+
+#ifdef HAVE_POSIX_MEMALIGN
+    if (posix_memalign(&memory, SLAB_BYTES, SLAB_BYTES))
+        return NULL;
+    slab = memory;
+#else
+    memory = malloc(2 * SLAB_BYTES);
+    if (!memory)
+        return NULL;
+    slab = (SlabPtr) (((uintptr_t) memory + SLAB_BYTES - 1) &
+                      ~(uintptr_t) (SLAB_BYTES - 1));
+#endif
+    if (!SlabRegister(slab)) {
+        free(memory);
+        return NULL;
+    }
+    slab->cache = cache;
+    slab->memory = memory;
+    slab->used = 0;
+    slab->freeList = NULL;
+    object = (char *) slab + cache->offset + cache->perSlab * cache->stride;
+    for (i = 0; i < cache->perSlab; i++) {
+        object -= cache->stride;
+        *(void **) object = slab->freeList;
+        slab->freeList = object;
+    }
+    cache->slabs++;
+    return slab;
+}
+
+static void
+SlabDestroy(SlabPtr slab)
+{
+    slab->cache->slabs--;
+    SlabUnregister(slab);
+    free(slab->memory);
+}
+
+SlabCachePtr
+SlabGetCache(const char *name, unsigned int size)
+{
+    SlabCachePtr cache;
+
+    if (size > SLAB_MAX_OBJECT)
+        return NULL;
+
+    xorg_list_for_each_entry(cache, &slabCaches, entry) {
+        if (cache->size == size && !strcmp(cache->name, name))
+            return cache;
+    }
+
+    cache = calloc(1, sizeof(SlabCacheRec));
+    if (!cache)
+        return NULL;
+    cache->name = name;
+    cache->size = size;
+    cache->stride = max(size, sizeof(void *));
+    if (cache->stride >= SLAB_ALIGN)
+        cache->stride = (cache->stride + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    else
+        cache->stride = (cache->stride + sizeof(void *) - 1) &
+            ~(sizeof(void *) - 1);
+    cache->offset = (sizeof(SlabRec) + SLAB_ALIGN - 1) & ~(SLAB_ALIGN - 1);
+    cache->perSlab = (SLAB_BYTES - cache->offset) / cache->stride;
+    xorg_list_init(&cache->partial);
+    xorg_list_init(&cache->full);
+    xorg_list_add(&cache->entry, &slabCaches);
+    return cache;
+}
+
+unsigned int
+SlabCacheSize(SlabCachePtr cache)
+{
+    return cache->size;
+}
+
+void *
+SlabAlloc(SlabCachePtr cache)
+{
+    SlabPtr slab;
+    void *object;
+
+    if (xorg_list_is_empty(&cache->partial)) {
+        slab = cache->empty;
+        cache->empty = NULL;
+        if (!slab && !(slab = SlabCreate(cache)))
+            return NULL;
+        xorg_list_add(&slab->entry, &cache->partial);
+    }
+    else
+        slab = xorg_list_first_entry(&cache->partial, SlabRec, entry);
+
+    object = slab->freeList;
+    slab->freeList = *(void **) object;
+    if (++slab->used == cache->perSlab) {
+        xorg_list_del(&slab->entry);
+        xorg_list_add(&slab->entry, &cache->full);
+    }
+    cache->live++;
+    cache->allocs++;
+    return object;
+}
+
+Bool
+SlabFree(void *object)
+{
+    SlabPtr slab;
+    SlabCachePtr cache;
+
+    slab = (SlabPtr) ((uintptr_t) object & ~(uintptr_t) (SLAB_BYTES - 1));
+    if (!object || !SlabRegistered(slab))
+        return FALSE;
+
+    cache = slab->cache;
+    *(void **) object = slab->freeList;
+    slab->freeList = object;
+    cache->live--;
+    if (slab->used-- == cache->perSlab) {
+        xorg_list_del(&slab->entry);
+        xorg_list_add(&slab->entry, &cache->partial);
+    }
+    if (!slab->used) {
+        xorg_list_del(&slab->entry);
+        if (cache->empty)
+            SlabDestroy(slab);
+        else
+            cache->empty = slab;
+    }
+    return TRUE;
+}
+
+void
+SlabShrink(void)
+{
+    SlabCachePtr cache;
+
+    xorg_list_for_each_entry(cache, &slabCaches, entry) {
+        if (cache->empty) {
+            SlabDestroy(cache->empty);
+            cache->empty = NULL;
+        }
+    }
+    if (!slabCount) {
+        free(slabTable);
+        slabTable = NULL;
+        slabTableBits = 0;
+    }
+}
+
+int
+GetSlabStats(SlabStatsPtr stats, int max)
+{
+    SlabCachePtr cache;
+    int n = 0;
+
+    xorg_list_for_each_entry(cache, &slabCaches, entry) {
+        if (n < max) {
+            stats[n].name = cache->name;
+            stats[n].size = cache->size;
+            stats[n].live = cache->live;
+            stats[n].capacity = cache->slabs * cache->perSlab;
+            stats[n].slabs = cache->slabs;
+            stats[n].allocs = cache->allocs;
+        }
+        n++;
+    }
+    return n;
+}
+
+void
+LogSlabStats(void)
+{
+    SlabCachePtr cache;
+
+    LogMessage(X_INFO, "Slab caches:\n");
+    xorg_list_for_each_entry(cache, &slabCaches, entry) {
+        LogMessage(X_NONE, "  %-12s %5u bytes: %lu of %lu objects in use "
+                   "(%lu%%) in %lu slabs, %lu allocated\n",
+                   cache->name, cache->size, cache->live,
+                   cache->slabs * cache->perSlab,
+                   cache->slabs ?
+                   cache->live * 100 / (cache->slabs * cache->perSlab) : 0,
+                   cache->slabs, cache->allocs);
+    }
+}
@@ -446,6 +446,9 @@ CreateRootWindow(ScreenPtr pScreen)
     BoxRec box;
     PixmapFormatRec *format;
 
+    if (!InitWindowIndex() || !InitPropertyIndex())
+        return FALSE;
+
     pWin = dixAllocateScreenObjectWithPrivates(pScreen, WindowRec, PRIVATE_WINDOW);
     if (!pWin)
         return FALSE;
@@ -793,6 +796,7 @@ CreateWindow(Window wid, WindowPtr pParent, int x, int y, unsigned w,
             pParent->lastChild = pWin;
         pParent->firstChild = pWin;
     }
+    WindowIndexInvalidate(pParent);
 
     SetWinSize(pWin);
     SetBorderSize(pWin);
@@ -902,6 +906,10 @@ FreeWindowResources(WindowPtr pWin)
         (*pScreen->DestroyPixmap) (pWin->background.pixmap);
 
     DeleteAllWindowProperties(pWin);
+    /* the PropertyNotify events above may have refilled the cache */
+    FreeEventRecipients(pWin);
+    WindowIndexFree(pWin);
+    WindowIndexInvalidate(pWin->parent);
     /* We SHOULD check for an error value here XXX */
     (*pScreen->DestroyWindow) (pWin);
     DisposeWindowOptional(pWin);
@@ -1522,6 +1530,8 @@ MoveWindowInStack(WindowPtr pWin, WindowPtr pNextSib)
     if (pWin->nextSib != pNextSib) {
         WindowPtr pOldNextSib = pWin->nextSib;
 
+        WindowIndexInvalidate(pParent);
+
         if (!pNextSib) {        /* move to bottom */
             if (pParent->firstChild == pWin)
                 pParent->firstChild = pWin->nextSib;
@@ -1735,6 +1745,10 @@ ResizeChildrenWinSize(WindowPtr pWin, int dx, int dy, int dw, int dh)
 
     pScreen = pWin->drawable.pScreen;
 
+    /* gravity may move the children */
+    if (resized)
+        WindowIndexInvalidate(pWin);
+
     for (pSib = pWin->firstChild; pSib; pSib = pSib->nextSib) {
         if (resized && (pSib->winGravity > NorthWestGravity)) {
             int cwsx, cwsy;
@@ -2291,6 +2305,10 @@ ConfigureWindow(WindowPtr pWin, Mask mask, XID *vlist, ClientPtr client)
         else
             pWin->borderWidth = bw;
     }
+    /* after the border width rewrite above, which turns a restack into
+     * a move */
+    if (action != RESTACK_WIN)
+        WindowIndexInvalidate(pParent);
     if (action == MOVE_WIN)
         (*pWin->drawable.pScreen->MoveWindow) (pWin, x, y, pSib,
                                                (mask & CWBorderWidth) ? VTOther
@@ -2461,6 +2479,8 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
     pWin->origin.y = y + bw;
     pWin->drawable.x = x + bw + pParent->drawable.x;
     pWin->drawable.y = y + bw + pParent->drawable.y;
+    WindowIndexInvalidate(pPriorParent);
+    WindowIndexInvalidate(pParent);
 
     /* clip to parent */
     SetWinSize(pWin);
@@ -3049,6 +3069,7 @@ dixSaveScreens(ClientPtr client, int on, int mode)
                  * for the root window, so miPaintWindow works
                  */
                 screenIsSaved = SCREEN_SAVER_OFF;
+                WindowIndexInvalidate(pWin->parent);
                 (*pWin->drawable.pScreen->MoveWindow) (pWin,
                                                        (short) (-
                                                                 (rand() %
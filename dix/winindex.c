@@ -0,0 +1,258 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Child window index.
+ *
+ * XYToWindow() looks for the topmost child containing the pointer at
+ * every level of the tree, which on a parent with many children means
+ * testing them one by one on every motion event.  Parents with at least
+ * WINDOW_INDEX_MIN_CHILDREN children get an index instead: a grid over
+ * the parent's area where each cell lists, in stacking order, the
+ * children whose border box reaches into it.  Only those children can
+ * contain a point in the cell, so XYToWindow() tests just them and
+ * finds the same window as before.
+ *
+ * Boxes are kept relative to the parent, so moving the parent or any
+ * of its ancestors leaves the index valid.  Anything that adds, removes,
+ * restacks, moves or resizes a child invalidates the index of its
+ * parent through WindowIndexInvalidate(); whether a child is mapped and
+ * its shape are checked by XYToWindow() itself and don't matter here.
+ *
+ * An invalid index is rebuilt lazily, and only after
+ * WINDOW_INDEX_REBUILD_DELAY lookups, so that an interactive move or
+ * resize, which invalidates the index of the parent on every step,
+ * doesn't pay for a rebuild on every motion event in between.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <string.h>
+
+#include "windowstr.h"
+#include "privates.h"
+#include "window.h"
+
+#define WINDOW_INDEX_MIN_CHILDREN       16
+#define WINDOW_INDEX_GRID               32      /* cells in each direction */
+#define WINDOW_INDEX_REBUILD_DELAY      8
+/* give up when children cover on average more cells than this */
+#define WINDOW_INDEX_MAX_CELLS_PER_CHILD        64
+
+typedef struct _WindowIndex {
+    Bool valid;
+    Bool useless;               /* too few children or cells too full */
+    int lookups;                /* lookups since the index went invalid */
+    int width, height;          /* parent size covered by the grid */
+    int cellWidth, cellHeight;
+    int cols, rows;
+    int *cellStart;             /* cols * rows + 1 offsets into children */
+    WindowPtr *children;
+    int size;                   /* allocated entries in children */
+} WindowIndexRec, *WindowIndexPtr;
+
+static DevPrivateKeyRec WindowIndexKeyRec;
+
+#define WindowIndexKey (&WindowIndexKeyRec)
+#define GetWindowIndex(pWin) ((WindowIndexPtr) \
+    dixLookupPrivate(&(pWin)->devPrivates, WindowIndexKey))
+
+/*
+ * Register the private holding the index; called before the root
+ * windows are created.
+ */
+Bool
+InitWindowIndex(void)
+{
+    return dixRegisterPrivateKey(&WindowIndexKeyRec, PRIVATE_WINDOW, 0);
+}
+
+void
+WindowIndexInvalidate(WindowPtr pParent)
+{
+    WindowIndexPtr index;
+
+    if (!pParent || !(index = GetWindowIndex(pParent)))
+        return;
+    if (index->valid || index->useless) {
+        index->valid = FALSE;
+        index->useless = FALSE;
+        index->lookups = 0;
+    }
+}
+
+void
+WindowIndexFree(WindowPtr pWin)
+{
+    WindowIndexPtr index = GetWindowIndex(pWin);
+
+    if (index) {
+        free(index->cellStart);
+        free(index->children);
+        free(index);
+        dixSetPrivate(&pWin->devPrivates, WindowIndexKey, NULL);
+    }
+}
+
+/* The range of cells the border box of pChild reaches into, FALSE if none */
+static Bool
+WindowIndexCells(WindowIndexPtr index, WindowPtr pParent, WindowPtr pChild,
+                 int *col1, int *row1, int *col2, int *row2)
+{
+    int bw = wBorderWidth(pChild);
+    int x1 = pChild->drawable.x - pParent->drawable.x - bw;
+    int y1 = pChild->drawable.y - pParent->drawable.y - bw;
+    int x2 = x1 + (int) pChild->drawable.width + 2 * bw;
+    int y2 = y1 + (int) pChild->drawable.height + 2 * bw;
+
+    if (x2 <= 0 || y2 <= 0 || x1 >= index->width || y1 >= index->height)
+        return FALSE;
+    *col1 = max(x1, 0) / index->cellWidth;
+    *row1 = max(y1, 0) / index->cellHeight;
+    *col2 = (min(x2, index->width) - 1) / index->cellWidth;
+    *row2 = (min(y2, index->height) - 1) / index->cellHeight;
+    return TRUE;
+}
+
+static Bool
+WindowIndexBuild(WindowIndexPtr index, WindowPtr pParent)
+{
+    WindowPtr pChild;
+    int nchildren, ncells, total, cell, i, col, row;
+    int col1, row1, col2, row2;
+    int *fill;
+
+    index->width = pParent->drawable.width;
+    index->height = pParent->drawable.height;
+    index->cols = min(WINDOW_INDEX_GRID, index->width);
+    index->rows = min(WINDOW_INDEX_GRID, index->height);
+    index->cellWidth = (index->width + index->cols - 1) / index->cols;
+    index->cellHeight = (index->height + index->rows - 1) / index->rows;
+    ncells = index->cols * index->rows;
+
+    if (!index->cellStart) {
+        index->cellStart = calloc(WINDOW_INDEX_GRID * WINDOW_INDEX_GRID + 1,
+                                  sizeof(int));
+        if (!index->cellStart)
+            return FALSE;
+    }
+    else
+        memset(index->cellStart, 0, (ncells + 1) * sizeof(int));
+
+    /* count the children of each cell, shifted by one */
+    nchildren = 0;
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        nchildren++;
+        if (!WindowIndexCells(index, pParent, pChild,
+                              &col1, &row1, &col2, &row2))
+            continue;
+        for (row = row1; row <= row2; row++)
+            for (col = col1; col <= col2; col++)
+                index->cellStart[row * index->cols + col + 1]++;
+    }
+    for (cell = 0; cell < ncells; cell++)
+        index->cellStart[cell + 1] += index->cellStart[cell];
+    total = index->cellStart[ncells];
+
+    if (nchildren < WINDOW_INDEX_MIN_CHILDREN ||
+        total > nchildren * WINDOW_INDEX_MAX_CELLS_PER_CHILD)
+        return FALSE;
+
+    if (total > index->size) {
+        WindowPtr *children = realloc(index->children,
+                                      total * sizeof(WindowPtr));
+
+        if (!children)
+            return FALSE;
+        index->children = children;
+        index->size = total;
+    }
+
+    /* then fill in, top to bottom, so each cell is in stacking order */
+    fill = malloc(ncells * sizeof(int));
+    if (!fill)
+        return FALSE;
+    memcpy(fill, index->cellStart, ncells * sizeof(int));
+    for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!WindowIndexCells(index, pParent, pChild,
+                              &col1, &row1, &col2, &row2))
+            continue;
+        for (row = row1; row <= row2; row++)
+            for (col = col1; col <= col2; col++) {
+                i = fill[row * index->cols + col]++;
+                index->children[i] = pChild;
+            }
+    }
+    free(fill);
+    return TRUE;
+}
+
+/*
+ * Returns the children of pParent that may contain the point x, y in
+ * screen coordinates, topmost first, and their number in *n.  Returns
+ * NULL when there is no usable index; all children must then be tried.
+ */
+WindowPtr *
+WindowIndexLookup(WindowPtr pParent, int x, int y, int *n)
+{
+    WindowIndexPtr index = GetWindowIndex(pParent);
+    WindowPtr pChild;
+    int count, cell;
+
+    if (!index) {
+        /* don't bother with parents with just a few children */
+        count = 0;
+        for (pChild = pParent->firstChild; pChild; pChild = pChild->nextSib)
+            if (++count == WINDOW_INDEX_MIN_CHILDREN)
+                break;
+        if (count < WINDOW_INDEX_MIN_CHILDREN)
+            return NULL;
+
+        index = calloc(1, sizeof(WindowIndexRec));
+        if (!index)
+            return NULL;
+        index->lookups = WINDOW_INDEX_REBUILD_DELAY;
+        dixSetPrivate(&pParent->devPrivates, WindowIndexKey, index);
+    }
+
+    if (!index->valid) {
+        if (index->useless || ++index->lookups < WINDOW_INDEX_REBUILD_DELAY)
+            return NULL;
+        index->lookups = 0;
+        index->valid = WindowIndexBuild(index, pParent);
+        index->useless = !index->valid;
+        if (!index->valid)
+            return NULL;
+    }
+
+    x -= pParent->drawable.x;
+    y -= pParent->drawable.y;
+    if (x < 0 || y < 0 || x >= index->width || y >= index->height)
+        return NULL;
+
+    cell = (y / index->cellHeight) * index->cols + x / index->cellWidth;
+    *n = index->cellStart[cell + 1] - index->cellStart[cell];
+    return index->children + index->cellStart[cell];
+}
@@ -1592,6 +1592,25 @@ fbStipple(FbBits * dst,
           FbBits fgand,
           FbBits fgxor, FbBits bgand, FbBits bgxor, int xRot, int yRot);
 
+/*
+ * fbthread.c
+ */
+
+/* operations smaller than this are never split across threads */
+#define FB_THREAD_MIN_AREA	(256 * 256)
+#define FB_THREAD_MIN_ROWS	32
+
+typedef void (*FbThreadBandProcPtr) (pointer /* closure */ ,
+                                     int /* band */ ,
+                                     int /* nbands */ );
+
+extern _X_EXPORT int
+ fbThreadBands(int width, int height);
+
+extern _X_EXPORT void
+
+fbThreadRun(int nbands, FbThreadBandProcPtr proc, pointer closure);
+
 /*
  * fbtile.c
  */
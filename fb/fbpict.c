@@ -34,6 +34,125 @@
 #include "picturestr.h"
 #include "mipict.h"
 #include "fbpict.h"
+#include "opaque.h"
+
+static pixman_image_t *image_from_pict_cached(PicturePtr pict, Bool has_clip,
+                                              int *xoff, int *yoff);
+
+#ifndef FB_ACCESS_WRAPPER
+
+typedef struct {
+    pixman_op_t op;
+    pixman_image_t *src, *mask, *dest;
+    int xSrc, ySrc, xMask, yMask, xDst, yDst;
+    int width, height;
+} FbCompositeBandRec, *FbCompositeBandPtr;
+
+static void
+fbCompositeBand(pointer closure, int band, int nbands)
+{
+    FbCompositeBandPtr c = closure;
+    int y1 = c->height * band / nbands;
+    int y2 = c->height * (band + 1) / nbands;
+
+    pixman_image_composite(c->op, c->src, c->mask, c->dest,
+                           c->xSrc, c->ySrc + y1,
+                           c->xMask, c->yMask + y1,
+                           c->xDst, c->yDst + y1, c->width, y2 - y1);
+}
+
+static Bool
+fbPictureReadsPixmap(PicturePtr pPicture, PixmapPtr pPixmap)
+{
+    PixmapPtr pRead;
+    int xoff, yoff;
+
+    if (!pPicture || !pPicture->pDrawable)
+        return FALSE;
+    fbGetDrawablePixmap(pPicture->pDrawable, pRead, xoff, yoff);
+    return pRead == pPixmap;
+}
+
+/*
+ * Draw a large composite in bands with the worker threads.  The
+ * coordinates are those passed to pixman, dst_yoff is the offset
+ * image_from_pict returned for pDst.  Each band covers whole rows of
+ * the destination clip extents; the source and mask coordinates move
+ * along, so transforms and repeats apply exactly as for a single call.
+ * Nothing is split when the destination pixmap is also read, as the
+ * bands would then race each other.  Returns FALSE when the composite
+ * should be drawn in one piece.
+ */
+static Bool
+fbCompositeThreaded(pixman_op_t op,
+                    pixman_image_t * src, pixman_image_t * mask,
+                    pixman_image_t * dest, PicturePtr pSrc,
+                    PicturePtr pMask, PicturePtr pDst,
+                    int xSrc, int ySrc, int xMask, int yMask,
+                    int xDst, int yDst, int width, int height, int dst_yoff)
+{
+    FbCompositeBandRec c;
+    PixmapPtr pPixmap;
+    BoxPtr clip;
+    int xoff, yoff, y1, y2, nbands;
+
+    if (renderThreads <= 1)
+        return FALSE;
+
+    /* pCompositeClip is in screen coordinates */
+    clip = RegionExtents(pDst->pCompositeClip);
+    yoff = dst_yoff - pDst->pDrawable->y;
+    y1 = max(yDst, clip->y1 + yoff);
+    y2 = min(yDst + height, clip->y2 + yoff);
+    if (y2 <= y1)
+        return FALSE;
+
+    nbands = fbThreadBands(min(width, clip->x2 - clip->x1), y2 - y1);
+    if (nbands <= 1)
+        return FALSE;
+
+    fbGetDrawablePixmap(pDst->pDrawable, pPixmap, xoff, yoff);
+    if (fbPictureReadsPixmap(pSrc, pPixmap) ||
+        fbPictureReadsPixmap(pSrc->alphaMap, pPixmap) ||
+        (pMask && (fbPictureReadsPixmap(pMask, pPixmap) ||
+                   fbPictureReadsPixmap(pMask->alphaMap, pPixmap))))
+        return FALSE;
+
+    /* pixman brings images up to date when they are first used; get that
+     * done here, so that the bands only ever read them */
+    pixman_image_composite(op, src, mask, dest, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    c.op = op;
+    c.src = src;
+    c.mask = mask;
+    c.dest = dest;
+    c.xSrc = xSrc;
+    c.ySrc = ySrc + (y1 - yDst);
+    c.xMask = xMask;
+    c.yMask = yMask + (y1 - yDst);
+    c.xDst = xDst;
+    c.yDst = y1;
+    c.width = width;
+    c.height = y2 - y1;
+    fbThreadRun(nbands, fbCompositeBand, &c);
+    return TRUE;
+}
+
+#else                           /* FB_ACCESS_WRAPPER */
+
+/* wfb wraps every pixmap access, which is not safe to do from threads */
+static Bool
+fbCompositeThreaded(pixman_op_t op,
+                    pixman_image_t * src, pixman_image_t * mask,
+                    pixman_image_t * dest, PicturePtr pSrc,
+                    PicturePtr pMask, PicturePtr pDst,
+                    int xSrc, int ySrc, int xMask, int yMask,
+                    int xDst, int yDst, int width, int height, int dst_yoff)
+{
+    return FALSE;
+}
+
+#endif                          /* FB_ACCESS_WRAPPER */
 
 void
 fbComposite(CARD8 op,
@@ -54,15 +173,21 @@ fbComposite(CARD8 op,
     if (pMask)
         miCompositeSourceValidate(pMask);
 
-    src = image_from_pict(pSrc, FALSE, &src_xoff, &src_yoff);
-    mask = image_from_pict(pMask, FALSE, &msk_xoff, &msk_yoff);
-    dest = image_from_pict(pDst, TRUE, &dst_xoff, &dst_yoff);
+    src = image_from_pict_cached(pSrc, FALSE, &src_xoff, &src_yoff);
+    mask = image_from_pict_cached(pMask, FALSE, &msk_xoff, &msk_yoff);
+    dest = image_from_pict_cached(pDst, TRUE, &dst_xoff, &dst_yoff);
 
     if (src && dest && !(pMask && !mask)) {
-        pixman_image_composite(op, src, mask, dest,
-                               xSrc + src_xoff, ySrc + src_yoff,
-                               xMask + msk_xoff, yMask + msk_yoff,
-                               xDst + dst_xoff, yDst + dst_yoff, width, height);
+        if (!fbCompositeThreaded(op, src, mask, dest, pSrc, pMask, pDst,
+                                 xSrc + src_xoff, ySrc + src_yoff,
+                                 xMask + msk_xoff, yMask + msk_yoff,
+                                 xDst + dst_xoff, yDst + dst_yoff,
+                                 width, height, dst_yoff))
+            pixman_image_composite(op, src, mask, dest,
+                                   xSrc + src_xoff, ySrc + src_yoff,
+                                   xMask + msk_xoff, yMask + msk_yoff,
+                                   xDst + dst_xoff, yDst + dst_yoff,
+                                   width, height);
     }
 
     free_pixman_pict(pSrc, src);
@@ -176,10 +301,10 @@ fbGlyphs(CARD8 op,
 	list++;
     }
 
-    if (!(srcImage = image_from_pict(pSrc, FALSE, &srcXoff, &srcYoff)))
+    if (!(srcImage = image_from_pict_cached(pSrc, FALSE, &srcXoff, &srcYoff)))
 	goto out;
 
-    if (!(dstImage = image_from_pict(pDst, TRUE, &dstXoff, &dstYoff)))
+    if (!(dstImage = image_from_pict_cached(pDst, TRUE, &dstXoff, &dstYoff)))
 	goto out_free_src;
 
     if (maskFormat) {
@@ -497,6 +622,233 @@ free_pixman_pict(PicturePtr pict, pixman_image_t * image)
         fbFinishAccess(pict->pDrawable);
 }
 
+/*
+ * The pixman images of drawable pictures are kept from one operation to
+ * the next.  An image is dropped when anything it was built from may
+ * have changed: changes to the picture's attributes, clip, transform and
+ * filter, and the revalidation that follows a change to the drawable,
+ * all pass through the screen hooks wrapped below, and the pixmap
+ * underneath is compared on every use.
+ *
+ * Source-only pictures don't call the screen hooks and pictures with an
+ * alpha map depend on a second picture, so images for those are still
+ * built for every operation, as are all images when access to the
+ * pixmaps has to be wrapped.
+ */
+#ifndef FB_ACCESS_WRAPPER
+
+typedef struct {
+    pixman_image_t *image;
+    PixmapPtr pixmap;           /* what image was built from */
+    pointer bits;
+    int devKind;
+    int width, height;
+    int x, y;                   /* drawable origin within pixmap */
+    int xoff, yoff;             /* offsets image_from_pict returned */
+} FbPictImageRec, *FbPictImagePtr;
+
+/* private field of a picture: as source or mask, and as destination */
+typedef struct {
+    FbPictImageRec image[2];
+} FbPictPrivRec, *FbPictPrivPtr;
+
+/* private field of a screen: the wrapped picture screen hooks */
+typedef struct {
+    DestroyPictureProcPtr DestroyPicture;
+    ChangePictureClipProcPtr ChangePictureClip;
+    DestroyPictureClipProcPtr DestroyPictureClip;
+    ChangePictureProcPtr ChangePicture;
+    ValidatePictureProcPtr ValidatePicture;
+    ChangePictureTransformProcPtr ChangePictureTransform;
+    ChangePictureFilterProcPtr ChangePictureFilter;
+} FbPictScreenPrivRec, *FbPictScreenPrivPtr;
+
+static DevPrivateKeyRec fbPictPrivateKeyRec;
+static DevPrivateKeyRec fbPictScreenPrivateKeyRec;
+
+#define fbGetPictPrivate(pPicture) ((FbPictPrivPtr) \
+    dixLookupPrivate(&(pPicture)->devPrivates, &fbPictPrivateKeyRec))
+#define fbGetPictScreenPrivate(pScreen) ((FbPictScreenPrivPtr) \
+    dixLookupPrivate(&(pScreen)->devPrivates, &fbPictScreenPrivateKeyRec))
+
+static void
+fbPictDropImages(PicturePtr pPicture)
+{
+    FbPictPrivPtr priv = fbGetPictPrivate(pPicture);
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        if (priv->image[i].image) {
+            pixman_image_unref(priv->image[i].image);
+            priv->image[i].image = NULL;
+        }
+    }
+}
+
+static pixman_image_t *
+image_from_pict_cached(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
+{
+    FbPictImagePtr cache;
+    PixmapPtr pixmap;
+    int x, y;
+
+    if (!pict || !pict->pDrawable || pict->alphaMap ||
+        !fbGetPictScreenPrivate(pict->pDrawable->pScreen)->DestroyPicture)
+        return image_from_pict(pict, has_clip, xoff, yoff);
+
+    fbGetDrawablePixmap(pict->pDrawable, pixmap, x, y);
+    x += pict->pDrawable->x;
+    y += pict->pDrawable->y;
+
+    cache = &fbGetPictPrivate(pict)->image[has_clip ? 1 : 0];
+    if (cache->image &&
+        (cache->pixmap != pixmap ||
+         cache->bits != pixmap->devPrivate.ptr ||
+         cache->devKind != pixmap->devKind ||
+         cache->width != pixmap->drawable.width ||
+         cache->height != pixmap->drawable.height ||
+         cache->x != x || cache->y != y)) {
+        pixman_image_unref(cache->image);
+        cache->image = NULL;
+    }
+
+    if (!cache->image) {
+        cache->image = image_from_pict(pict, has_clip,
+                                       &cache->xoff, &cache->yoff);
+        if (!cache->image)
+            return NULL;
+        cache->pixmap = pixmap;
+        cache->bits = pixmap->devPrivate.ptr;
+        cache->devKind = pixmap->devKind;
+        cache->width = pixmap->drawable.width;
+        cache->height = pixmap->drawable.height;
+        cache->x = x;
+        cache->y = y;
+    }
+
+    *xoff = cache->xoff;
+    *yoff = cache->yoff;
+    return pixman_image_ref(cache->image);
+}
+
+static void
+fbDestroyPicture(PicturePtr pPicture)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    (*priv->DestroyPicture) (pPicture);
+}
+
+static int
+fbChangePictureClip(PicturePtr pPicture, int type, pointer value, int n)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    return (*priv->ChangePictureClip) (pPicture, type, value, n);
+}
+
+static void
+fbDestroyPictureClip(PicturePtr pPicture)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    (*priv->DestroyPictureClip) (pPicture);
+}
+
+static void
+fbChangePicture(PicturePtr pPicture, Mask mask)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    (*priv->ChangePicture) (pPicture, mask);
+}
+
+static void
+fbValidatePicture(PicturePtr pPicture, Mask mask)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    (*priv->ValidatePicture) (pPicture, mask);
+}
+
+static int
+fbChangePictureTransform(PicturePtr pPicture, PictTransform * transform)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    return (*priv->ChangePictureTransform) (pPicture, transform);
+}
+
+static int
+fbChangePictureFilter(PicturePtr pPicture, int filter, xFixed * params,
+                      int nparams)
+{
+    FbPictScreenPrivPtr priv =
+        fbGetPictScreenPrivate(pPicture->pDrawable->pScreen);
+
+    fbPictDropImages(pPicture);
+    return (*priv->ChangePictureFilter) (pPicture, filter, params, nparams);
+}
+
+static Bool
+fbPictureCacheInit(ScreenPtr pScreen)
+{
+    PictureScreenPtr ps = GetPictureScreen(pScreen);
+    FbPictScreenPrivPtr priv;
+
+    if (!dixRegisterPrivateKey(&fbPictPrivateKeyRec, PRIVATE_PICTURE,
+                               sizeof(FbPictPrivRec)) ||
+        !dixRegisterPrivateKey(&fbPictScreenPrivateKeyRec, PRIVATE_SCREEN,
+                               sizeof(FbPictScreenPrivRec)))
+        return FALSE;
+
+    priv = fbGetPictScreenPrivate(pScreen);
+    priv->DestroyPicture = ps->DestroyPicture;
+    ps->DestroyPicture = fbDestroyPicture;
+    priv->ChangePictureClip = ps->ChangePictureClip;
+    ps->ChangePictureClip = fbChangePictureClip;
+    priv->DestroyPictureClip = ps->DestroyPictureClip;
+    ps->DestroyPictureClip = fbDestroyPictureClip;
+    priv->ChangePicture = ps->ChangePicture;
+    ps->ChangePicture = fbChangePicture;
+    priv->ValidatePicture = ps->ValidatePicture;
+    ps->ValidatePicture = fbValidatePicture;
+    priv->ChangePictureTransform = ps->ChangePictureTransform;
+    ps->ChangePictureTransform = fbChangePictureTransform;
+    priv->ChangePictureFilter = ps->ChangePictureFilter;
+    ps->ChangePictureFilter = fbChangePictureFilter;
+
+    return TRUE;
+}
+
+#else                           /* FB_ACCESS_WRAPPER */
+
+static pixman_image_t *
+image_from_pict_cached(PicturePtr pict, Bool has_clip, int *xoff, int *yoff)
+{
+    return image_from_pict(pict, has_clip, xoff, yoff);
+}
+
+static Bool
+fbPictureCacheInit(ScreenPtr pScreen)
+{
+    return TRUE;
+}
+
+#endif                          /* FB_ACCESS_WRAPPER */
+
 Bool
 fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 {
@@ -505,6 +857,8 @@ fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 
     if (!miPictureInit(pScreen, formats, nformats))
         return FALSE;
+    if (!fbPictureCacheInit(pScreen))
+        return FALSE;
     ps = GetPictureScreen(pScreen);
     ps->Composite = fbComposite;
     ps->Glyphs = fbGlyphs;
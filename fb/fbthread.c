@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Worker threads for large drawing operations.
+ *
+ * With -threads n, operations that cover at least FB_THREAD_MIN_AREA
+ * pixels are cut into up to n horizontal bands of the destination, and
+ * the bands are drawn at the same time by the server thread and n - 1
+ * workers.  fbThreadRun() returns once every band is done, so nothing
+ * outside of this file ever sees a thread; callers only have to make
+ * sure that drawing one band does not write to anything another band
+ * reads.
+ *
+ * The workers are started on first use and block all signals, leaving
+ * them to the server thread as before.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "fb.h"
+#include "opaque.h"
+
+#ifdef HAVE_PTHREAD_CREATE
+#include <pthread.h>
+#include <signal.h>
+
+#define FB_THREAD_MAX   64
+
+typedef struct {
+    FbThreadBandProcPtr proc;
+    pointer closure;
+    int nbands;
+    int next;                   /* next band to hand out */
+    int pending;                /* bands not yet drawn */
+} FbThreadJobRec, *FbThreadJobPtr;
+
+static pthread_mutex_t fbThreadMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fbThreadWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t fbThreadDone = PTHREAD_COND_INITIALIZER;
+static FbThreadJobPtr fbThreadJob;
+static int fbThreadWorkers = -1;        /* -1 until started */
+
+/*
+ * Hand out bands of the current job until none are left.  Called with
+ * fbThreadMutex held, which is dropped while a band is drawn.
+ */
+static void
+fbThreadDrawBands(FbThreadJobPtr job)
+{
+    int band;
+
+    while (job->next < job->nbands) {
+        band = job->next++;
+        pthread_mutex_unlock(&fbThreadMutex);
+        (*job->proc) (job->closure, band, job->nbands);
+        pthread_mutex_lock(&fbThreadMutex);
+        if (--job->pending == 0)
+            pthread_cond_signal(&fbThreadDone);
+    }
+}
+
+static void *
+fbThreadMain(void *arg)
+{
+    pthread_mutex_lock(&fbThreadMutex);
+    for (;;) {
+        while (!fbThreadJob || fbThreadJob->next >= fbThreadJob->nbands)
+            pthread_cond_wait(&fbThreadWork, &fbThreadMutex);
+        fbThreadDrawBands(fbThreadJob);
+    }
+    return NULL;
+}
+
+static void
+fbThreadStart(void)
+{
+    sigset_t all, saved;
+    pthread_t thread;
+    int want = min(renderThreads, FB_THREAD_MAX) - 1;
+
+    fbThreadWorkers = 0;
+
+    /* new threads inherit the signal mask */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &saved);
+    while (fbThreadWorkers < want) {
+        if (pthread_create(&thread, NULL, fbThreadMain, NULL) != 0)
+            break;
+        pthread_detach(thread);
+        fbThreadWorkers++;
+    }
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+
+    if (fbThreadWorkers < want)
+        LogMessage(X_WARNING, "fb: only %d of %d drawing threads started\n",
+                   fbThreadWorkers + 1, want + 1);
+}
+#endif                          /* HAVE_PTHREAD_CREATE */
+
+/*
+ * Returns how many bands an operation on a width x height area of the
+ * destination should be cut into; 1 means it should simply be drawn.
+ */
+int
+fbThreadBands(int width, int height)
+{
+#ifdef HAVE_PTHREAD_CREATE
+    int nbands;
+
+    if (renderThreads <= 1 || width * height < FB_THREAD_MIN_AREA)
+        return 1;
+    if (fbThreadWorkers < 0)
+        fbThreadStart();
+
+    nbands = min(fbThreadWorkers + 1, height / FB_THREAD_MIN_ROWS);
+    return max(nbands, 1);
+#else
+    return 1;
+#endif
+}
+
+/*
+ * Calls proc once for each band in 0 .. nbands - 1, spread over the
+ * server thread and the workers, and waits for all of them to finish.
+ */
+void
+fbThreadRun(int nbands, FbThreadBandProcPtr proc, pointer closure)
+{
+    int band;
+
+#ifdef HAVE_PTHREAD_CREATE
+    FbThreadJobRec job;
+
+    if (nbands > 1 && fbThreadWorkers > 0) {
+        job.proc = proc;
+        job.closure = closure;
+        job.nbands = nbands;
+        job.next = 0;
+        job.pending = nbands;
+
+        pthread_mutex_lock(&fbThreadMutex);
+        fbThreadJob = &job;
+        pthread_cond_broadcast(&fbThreadWork);
+        fbThreadDrawBands(&job);
+        while (job.pending)
+            pthread_cond_wait(&fbThreadDone, &fbThreadMutex);
+        fbThreadJob = NULL;
+        pthread_mutex_unlock(&fbThreadMutex);
+        return;
+    }
+#endif
+    for (band = 0; band < nbands; band++)
+        (*proc) (closure, band, nbands);
+}
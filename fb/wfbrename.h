@@ -154,6 +154,8 @@
 #define fbStipple4Bits wfbStipple4Bits
 #define fbStipple8Bits wfbStipple8Bits
 #define fbStippleTable wfbStippleTable
+#define fbThreadBands wfbThreadBands
+#define fbThreadRun wfbThreadRun
 #define fbTile wfbTile
 #define fbTransparentSpan wfbTransparentSpan
 #define fbTrapezoids wfbTrapezoids
@@ -525,6 +525,7 @@ ephyrRandRSetConfig(ScreenPtr pScreen,
         if (!KdShadowSet(screen->pScreen,
                          scrpriv->randr, ephyrShadowUpdate, ephyrWindowLinear))
             goto bail4;
+        shadowSetThreaded(screen->pScreen, TRUE);
     }
     else {
         /* Without shadow fb ( non rotated ) we need 
@@ -696,10 +697,13 @@ ephyrCreateResources(ScreenPtr pScreen)
     EPHYR_LOG("mark pScreen=%p mynum=%d shadow=%d",
               pScreen, pScreen->myNum, scrpriv->shadow);
 
-    if (scrpriv->shadow)
-        return KdShadowSet(pScreen,
-                           scrpriv->randr,
-                           ephyrShadowUpdate, ephyrWindowLinear);
+    if (scrpriv->shadow) {
+        if (!KdShadowSet(pScreen,
+                         scrpriv->randr, ephyrShadowUpdate, ephyrWindowLinear))
+            return FALSE;
+        shadowSetThreaded(pScreen, TRUE);
+        return TRUE;
+    }
     else
         return ephyrSetInternalDamage(pScreen);
 }
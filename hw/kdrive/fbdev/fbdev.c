@@ -419,7 +419,11 @@ fbdevSetShadow(ScreenPtr pScreen)
             update = shadowUpdateRotatePacked;
     else
         update = shadowUpdatePacked;
-    return KdShadowSet(pScreen, scrpriv->randr, update, window);
+    if (!KdShadowSet(pScreen, scrpriv->randr, update, window))
+        return FALSE;
+    /* the frame buffer is mapped linearly, any thread may write to it */
+    shadowSetThreaded(pScreen, TRUE);
+    return TRUE;
 }
 
 #ifdef RANDR
@@ -36,6 +36,11 @@ struct xwl_window {
     struct xorg_list		 link_damage;
 };
 
+/* window damage is posted as at most this many boxes, merging boxes
+ * less than XWL_DAMAGE_SLOP pixels apart */
+#define XWL_DAMAGE_BOXES	16
+#define XWL_DAMAGE_SLOP		32
+
 struct xwl_output;
 
 struct xwl_screen {
@@ -208,6 +208,10 @@ xwl_realize_window(WindowPtr window)
 		     FALSE, screen, xwl_window);
     DamageRegister(&window->drawable, xwl_window->damage);
     DamageSetReportAfterOp(xwl_window->damage, TRUE);
+    /* every damage box becomes a wl_surface_damage request; a few
+     * slightly larger ones are cheaper for both sides */
+    DamageSetAccumulate(xwl_window->damage, XWL_DAMAGE_BOXES,
+                        XWL_DAMAGE_SLOP);
 
     xorg_list_add(&xwl_window->link, &xwl_screen->window_list);
     xorg_list_init(&xwl_window->link_damage);
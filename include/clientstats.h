@@ -0,0 +1,68 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef CLIENTSTATS_H
+#define CLIENTSTATS_H
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <X11/Xfuncproto.h>
+#include <X11/Xmd.h>
+
+/* Request latency histogram: bucket 0 counts requests that took less
+ * than 1us, bucket n those that took [2^(n-1), 2^n) us, and the last
+ * bucket everything slower. */
+#define CLIENT_STATS_BUCKETS 24
+
+typedef struct _ClientOpStats {
+    unsigned long count;        /* requests handled */
+    CARD64 micros;              /* time spent handling them */
+} ClientOpStatsRec, *ClientOpStatsPtr;
+
+/* Dispatch statistics of one client. Kept for every client while it
+ * is connected, see ClientStatsRecordRequest. */
+typedef struct _ClientStats {
+    unsigned long requests;
+    CARD64 micros;
+    unsigned long histogram[CLIENT_STATS_BUCKETS];
+    ClientOpStatsRec ops[256];  /* indexed by major opcode */
+} ClientStatsRec, *ClientStatsPtr;
+
+struct _Client;
+
+/* Initialize and clean up. */
+extern void ReserveClientStats(struct _Client *client);
+extern void ReleaseClientStats(struct _Client *client);
+
+/* Account a request that just finished and took micros to handle. */
+extern void ClientStatsRecordRequest(struct _Client *client, CARD64 micros);
+
+/* Server-wide totals for one request, summed over all clients, or NULL
+ * if no such request has been seen. */
+extern _X_EXPORT ClientOpStatsPtr GetRequestStats(int major, int minor);
+
+/* Log the statistics of all clients, busiest first. */
+extern _X_EXPORT void LogClientStats(void);
+
+#endif                          /* CLIENTSTATS_H */
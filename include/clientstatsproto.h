@@ -0,0 +1,117 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * CLIENT-STATS, per-client dispatch statistics and scheduling weights.
+ *
+ * QueryClientStats returns the dispatch statistics kept in
+ * dix/clientstats.c and the scheduling weight of the client owning
+ * xid, or of the requesting client if xid is None.  The reply is
+ * followed by 64-bit values, each sent as low and high CARD32: time
+ * spent in requests (us), bytes read, reads, bytes written, writes and
+ * time blocked on output (us).  Then come num_buckets CARD32 latency
+ * histogram counts and num_ops xClientStatsOpStats, one for every major
+ * opcode the client used.
+ *
+ * SetClientWeight sets the share of server time the scheduler gives the
+ * client owning xid, or the requesting client if xid is None; see
+ * SmartScheduleClient.  A client may lower its own weight and raise it
+ * back up to the default.  Other clients' weights can only be set by
+ * local clients, and only when the server runs with -schedWeights.
+ */
+
+#ifndef CLIENTSTATSPROTO_H
+#define CLIENTSTATSPROTO_H
+
+#include <X11/Xmd.h>
+
+#define CLIENTSTATS_NAME                "CLIENT-STATS"
+
+#define X_ClientStatsQueryVersion       0
+#define X_ClientStatsQueryClientStats   1
+#define X_ClientStatsSetClientWeight    2
+
+typedef struct _ClientStatsQueryVersion {
+    CARD8 reqType;
+    CARD8 statsReqType;         /* always X_ClientStatsQueryVersion */
+    CARD16 length;
+} xClientStatsQueryVersionReq;
+#define sz_xClientStatsQueryVersionReq  4
+
+typedef struct _ClientStatsQueryVersionReply {
+    BYTE type;                  /* X_Reply */
+    CARD8 pad0;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD16 majorVersion;
+    CARD16 minorVersion;
+    CARD32 pad1;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xClientStatsQueryVersionReply;
+#define sz_xClientStatsQueryVersionReply 32
+
+typedef struct _ClientStatsQueryClientStats {
+    CARD8 reqType;
+    CARD8 statsReqType;         /* always X_ClientStatsQueryClientStats */
+    CARD16 length;
+    CARD32 xid;
+} xClientStatsQueryClientStatsReq;
+#define sz_xClientStatsQueryClientStatsReq 8
+
+typedef struct _ClientStatsQueryClientStatsReply {
+    BYTE type;                  /* X_Reply */
+    CARD8 pad1;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD32 requests;
+    CARD32 num_buckets;
+    CARD32 num_ops;
+    CARD32 weight;
+    CARD32 pad3;
+    CARD32 pad4;
+} xClientStatsQueryClientStatsReply;
+#define sz_xClientStatsQueryClientStatsReply 32
+
+typedef struct _ClientStatsOpStats {
+    CARD32 major;
+    CARD32 count;
+    CARD32 micros;
+    CARD32 micros_overflow;
+} xClientStatsOpStats;
+#define sz_xClientStatsOpStats 16
+
+#define CLIENTSTATS_TOTALS 6
+
+typedef struct _ClientStatsSetClientWeight {
+    CARD8 reqType;
+    CARD8 statsReqType;         /* always X_ClientStatsSetClientWeight */
+    CARD16 length;
+    CARD32 xid;
+    CARD32 weight;
+} xClientStatsSetClientWeightReq;
+#define sz_xClientStatsSetClientWeightReq 12
+
+#endif                          /* CLIENTSTATSPROTO_H */
@@ -164,6 +164,12 @@ extern _X_EXPORT void SendErrorToClient(ClientPtr /*client */ ,
 
 extern _X_EXPORT void MarkClientException(ClientPtr /*client */ );
 
+extern _X_EXPORT Bool requestCoalescing;
+
+extern _X_EXPORT int CoalesceRequests(ClientPtr /*client */ ,
+                                      int /*headerSize */ ,
+                                      int /*unitSize */ );
+
 extern _X_HIDDEN Bool CreateConnectionBlock(void);
 
 /* dixutils.c */
@@ -269,6 +275,11 @@ extern _X_EXPORT Atom MakeAtom(const char * /*string */ ,
                                unsigned /*len */ ,
                                Bool /*makeit */ );
 
+extern _X_EXPORT Bool MakeAtoms(const char ** /*names */ ,
+                                int /*count */ ,
+                                Bool /*makeit */ ,
+                                Atom * /*atoms */ );
+
 extern _X_EXPORT Bool ValidAtom(Atom /*atom */ );
 
 extern _X_EXPORT const char *NameForAtom(Atom /*atom */ );
@@ -429,6 +440,12 @@ FixKeyState(DeviceEvent * /* event */ ,
 extern void
 RecalculateDeliverableEvents(WindowPtr /* pWin */ );
 
+extern _X_EXPORT void
+InvalidateEventRecipients(void);
+
+extern void
+FreeEventRecipients(WindowPtr /* win */ );
+
 extern _X_EXPORT int
 OtherClientGone(pointer /* value */ ,
                 XID /* id */ );
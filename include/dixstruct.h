@@ -25,6 +25,7 @@ SOFTWARE.
 #define DIXSTRUCT_H
 
 #include "client.h"
+#include "clientstats.h"
 #include "dix.h"
 #include "resource.h"
 #include "cursor.h"
@@ -117,10 +118,12 @@ typedef struct _Client {
 
     int smart_start_tick;
     int smart_stop_tick;
-    int smart_check_tick;
+    unsigned int smart_weight;  /* share of server time, see SMART_*_WEIGHT */
+    CARD64 smart_vruntime;      /* weighted dispatch time, in us */
 
     DeviceIntPtr clientPtr;
     ClientIdPtr clientIds;
+    ClientStatsPtr clientStats;
 } ClientRec;
 
 /*
@@ -131,6 +134,7 @@ extern _X_EXPORT long SmartScheduleInterval;
 extern _X_EXPORT long SmartScheduleSlice;
 extern _X_EXPORT long SmartScheduleMaxSlice;
 extern _X_EXPORT Bool SmartScheduleDisable;
+extern _X_EXPORT Bool SmartScheduleOtherWeights;
 extern _X_EXPORT void
 SmartScheduleStartTimer(void);
 extern _X_EXPORT void
@@ -139,9 +143,20 @@ SmartScheduleStopTimer(void);
 #define SMART_MAX_PRIORITY  (20)
 #define SMART_MIN_PRIORITY  (-20)
 
+/* A client with twice the weight of another gets twice its time */
+#define SMART_DEFAULT_WEIGHT (100)
+#define SMART_MIN_WEIGHT    (1)
+#define SMART_MAX_WEIGHT    (10000)
+
 extern _X_EXPORT void
 SmartScheduleInit(void);
 
+extern _X_EXPORT int
+SmartScheduleClient(int * /* clientReady */ , int /* nready */ );
+
+extern _X_EXPORT void
+SmartScheduleAccount(ClientPtr /* client */ , CARD64 /* micros */ );
+
 /* This prototype is used pervasively in Xext, dix */
 #define DISPATCH_PROC(func) int func(ClientPtr /* client */)
 
@@ -75,5 +75,7 @@ extern _X_EXPORT Bool bgNoneRoot;
 
 extern _X_EXPORT Bool CoreDump;
 extern _X_EXPORT Bool NoListenAll;
+extern _X_EXPORT int renderThreads;
+extern _X_EXPORT int shadowRefreshRate;
 
 #endif                          /* OPAQUE_H */
@@ -98,6 +98,17 @@ extern _X_EXPORT int WaitForSomething(int *     /*pClientsReady */
 
 extern _X_EXPORT int ReadRequestFromClient(ClientPtr /*client */ );
 
+extern _X_EXPORT int ReadFdFromClient(ClientPtr /*client */ );
+
+extern _X_EXPORT int WriteFdToClient(ClientPtr /*client */ , int /*fd */ ,
+                                     Bool /*do_close */ );
+
+extern _X_EXPORT pointer PeekNextRequest(ClientPtr /*client */ ,
+                                        int * /*lenp */ );
+
+extern _X_EXPORT void AppendNextRequest(ClientPtr /*client */ ,
+                                        int /*skip */ );
+
 extern _X_EXPORT Bool InsertFakeRequest(ClientPtr /*client */ ,
                                         char * /*data */ ,
                                         int /*count */ );
@@ -113,6 +124,25 @@ extern _X_EXPORT void SetCriticalOutputPending(void);
 extern _X_EXPORT int WriteToClient(ClientPtr /*who */ , int /*count */ ,
                                    const void * /*buf */ );
 
+typedef void (*OsReleaseProcPtr) (pointer /* closure */ );
+
+extern _X_EXPORT int WriteToClientRef(ClientPtr /*who */ , int /*count */ ,
+                                      const void * /*buf */ ,
+                                      OsReleaseProcPtr /*release */ ,
+                                      pointer /*closure */ );
+
+typedef struct _ClientIOStats {
+    unsigned long inputBytes;   /* bytes read from the client */
+    unsigned long inputReads;   /* reads that returned data */
+    int inputBufferSize;        /* current input buffer size */
+    unsigned long outputBytes;  /* bytes written to the client */
+    unsigned long outputWrites; /* writes that sent data */
+    CARD64 outputBlockedMicros; /* time spent unable to write */
+} ClientIOStatsRec, *ClientIOStatsPtr;
+
+extern _X_EXPORT void GetClientIOStats(ClientPtr /*client */ ,
+                                       ClientIOStatsPtr /*stats */ );
+
 extern _X_EXPORT void ResetOsBuffers(void);
 
 extern _X_EXPORT void InitConnectionLimits(void);
@@ -133,6 +163,10 @@ extern _X_EXPORT const char *ClientAuthorized(ClientPtr /*client */ ,
                                               unsigned int /*string_n */ ,
                                               char * /*auth_string */ );
 
+/* ClientAuthorized() result while the answer waits for host name lookups;
+ * the client is attended again when they are done */
+extern _X_EXPORT const char ClientAuthorizationPending[];
+
 extern _X_EXPORT Bool EstablishNewConnections(ClientPtr /*clientUnused */ ,
                                               pointer /*closure */ );
 
@@ -162,10 +196,11 @@ extern _X_EXPORT void MakeClientGrabPervious(ClientPtr /*client */ );
 
 #if defined(XQUARTZ) || defined(XORG_WAYLAND)
 extern _X_EXPORT void ListenOnOpenFD(int /* fd */ , int /* noxauth */ );
-extern _X_EXPORT void AddClientOnOpenFD(int /* fd */ );
 #endif
+extern _X_EXPORT void AddClientOnOpenFD(int /* fd */ );
 
 extern _X_EXPORT CARD32 GetTimeInMillis(void);
+extern _X_EXPORT CARD64 GetTimeInMicros(void);
 
 extern _X_EXPORT void AdjustWaitForDelay(pointer /*waitTime */ ,
                                          unsigned long /*newdelay */ );
@@ -200,6 +235,10 @@ extern _X_EXPORT void AutoResetServer(int /*sig */ );
 
 extern _X_EXPORT void GiveUp(int /*sig */ );
 
+extern _X_EXPORT void DumpClientStats(int /*sig */ );
+
+extern _X_EXPORT volatile char clientStatsDumpPending;
+
 extern _X_EXPORT void UseMsg(void);
 
 extern _X_EXPORT void ProcessCommandLine(int /*argc */ , char * /*argv */ []);
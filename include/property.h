@@ -82,4 +82,6 @@ extern _X_EXPORT int DeleteProperty(ClientPtr /*client */ ,
 
 extern _X_EXPORT void DeleteAllWindowProperties(WindowPtr /*pWin */ );
 
+extern _X_EXPORT Bool InitPropertyIndex(void);
+
 #endif                          /* PROPERTY_H */
@@ -38,6 +38,10 @@
 #define SERVER_APPLEWM_MINOR_VERSION		3
 #define SERVER_APPLEWM_PATCH_VERSION		0
 
+/* CLIENT-STATS, see clientstatsproto.h */
+#define SERVER_CLIENT_STATS_MAJOR_VERSION	1
+#define SERVER_CLIENT_STATS_MINOR_VERSION	0
+
 /* Composite */
 #define SERVER_COMPOSITE_MAJOR_VERSION		0
 #define SERVER_COMPOSITE_MINOR_VERSION		4
@@ -93,7 +97,15 @@
 
 /* SHM */
 #define SERVER_SHM_MAJOR_VERSION		1
+#ifdef SHM_FD_PASSING
+#define SERVER_SHM_MINOR_VERSION		2
+#else
 #define SERVER_SHM_MINOR_VERSION		1
+#endif
+
+/* SHM-CAPTURE, see shmcaptureproto.h */
+#define SERVER_SHM_CAPTURE_MAJOR_VERSION	1
+#define SERVER_SHM_CAPTURE_MINOR_VERSION	0
 
 /* Sync */
 #define SERVER_SYNC_MAJOR_VERSION		3
@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * SHM-CAPTURE, damage-aware screen capture into MIT-SHM segments.
+ *
+ * GetImage is laid out like the MIT-SHM ShmGetImage request, with
+ * ZPixmap and all planes only, and names an MIT-SHM segment.  The first
+ * capture of a drawable area into a segment copies all of it; as long
+ * as the following requests name the same drawable, area, segment and
+ * offset, only what was drawn since the previous capture is copied
+ * again.  The reply lists the rectangles copied, relative to the
+ * captured area; the client must leave the rest of the image in the
+ * segment alone.  Errors on the segment are MIT-SHM BadShmSeg.
+ */
+
+#ifndef SHMCAPTUREPROTO_H
+#define SHMCAPTUREPROTO_H
+
+#include <X11/Xmd.h>
+
+#define SHMCAPTURE_NAME                 "SHM-CAPTURE"
+
+#define X_ShmCaptureQueryVersion        0
+#define X_ShmCaptureGetImage            1
+
+typedef struct _ShmCaptureQueryVersion {
+    CARD8 reqType;
+    CARD8 captureReqType;       /* always X_ShmCaptureQueryVersion */
+    CARD16 length;
+} xShmCaptureQueryVersionReq;
+#define sz_xShmCaptureQueryVersionReq   4
+
+typedef struct _ShmCaptureQueryVersionReply {
+    BYTE type;                  /* X_Reply */
+    CARD8 pad0;
+    CARD16 sequenceNumber;
+    CARD32 length;
+    CARD16 majorVersion;
+    CARD16 minorVersion;
+    CARD32 pad1;
+    CARD32 pad2;
+    CARD32 pad3;
+    CARD32 pad4;
+    CARD32 pad5;
+} xShmCaptureQueryVersionReply;
+#define sz_xShmCaptureQueryVersionReply 32
+
+typedef struct _ShmCaptureGetImage {
+    CARD8 reqType;
+    CARD8 captureReqType;       /* always X_ShmCaptureGetImage */
+    CARD16 length;
+    CARD32 drawable;
+    INT16 x;
+    INT16 y;
+    CARD16 width;
+    CARD16 height;
+    CARD32 planeMask;
+    CARD8 format;
+    CARD8 pad0;
+    CARD8 pad1;
+    CARD8 pad2;
+    CARD32 shmseg;
+    CARD32 offset;
+} xShmCaptureGetImageReq;
+#define sz_xShmCaptureGetImageReq       32
+
+typedef struct _ShmCaptureGetImageReply {
+    BYTE type;                  /* X_Reply */
+    CARD8 depth;
+    CARD16 sequenceNumber;
+    CARD32 length;              /* 2 * nRects */
+    CARD32 visual;
+    CARD32 size;
+    CARD32 nRects;              /* followed by nRects xRectangle */
+    CARD32 pad1;
+    CARD32 pad2;
+    CARD32 pad3;
+} xShmCaptureGetImageReply;
+#define sz_xShmCaptureGetImageReply     32
+
+#endif                          /* SHMCAPTUREPROTO_H */
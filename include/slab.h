@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <X11/Xfuncproto.h>
+#include "misc.h"
+
+/* Objects larger than this are not worth a slab cache */
+#define SLAB_MAX_OBJECT 2048
+
+typedef struct _SlabCache *SlabCachePtr;
+
+typedef struct _SlabStats {
+    const char *name;
+    unsigned int size;          /* object size */
+    unsigned long live;         /* objects in use */
+    unsigned long capacity;     /* objects the slabs can hold */
+    unsigned long slabs;
+    unsigned long allocs;       /* objects handed out since creation */
+} SlabStatsRec, *SlabStatsPtr;
+
+/* Find the cache for objects of the given name and size, creating it
+ * if necessary.  Returns NULL if size is too large or out of memory. */
+extern SlabCachePtr SlabGetCache(const char *name, unsigned int size);
+
+/* The object size of the cache. */
+extern unsigned int SlabCacheSize(SlabCachePtr cache);
+
+/* Return an object from the cache, or NULL.  The contents are
+ * undefined, as with malloc. */
+extern void *SlabAlloc(SlabCachePtr cache);
+
+/* Return an object to its cache.  Returns FALSE, doing nothing, if
+ * object did not come from a slab cache. */
+extern Bool SlabFree(void *object);
+
+/* Release the memory of empty slabs. */
+extern void SlabShrink(void);
+
+/* Fill in up to max entries of stats, one per cache; returns the
+ * number of caches. */
+extern _X_EXPORT int GetSlabStats(SlabStatsPtr stats, int max);
+
+/* Log the occupancy of all caches. */
+extern _X_EXPORT void LogSlabStats(void);
+
+#endif                          /* SLAB_H */
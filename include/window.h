@@ -225,4 +225,16 @@ extern _X_EXPORT void SetRootClip(ScreenPtr pScreen, Bool enable);
 extern _X_EXPORT void PrintWindowTree(void);
 
 extern _X_EXPORT VisualPtr WindowGetVisual(WindowPtr /*pWin*/);
+
+/* winindex.c */
+extern _X_EXPORT Bool InitWindowIndex(void);
+
+extern _X_EXPORT void WindowIndexInvalidate(WindowPtr /*pParent */ );
+
+extern _X_EXPORT void WindowIndexFree(WindowPtr /*pWin */ );
+
+extern _X_EXPORT WindowPtr *WindowIndexLookup(WindowPtr /*pParent */ ,
+                                              int /*x */ ,
+                                              int /*y */ ,
+                                              int * /*n */ );
 #endif                          /* WINDOW_H */
@@ -438,6 +438,10 @@ extern _X_EXPORT int miValidateTree(WindowPtr /*pParent */ ,
                                     VTKind      /*kind */
     );
 
+extern _X_HIDDEN void miValidateTreeCounts(int * /*validated */ ,
+                                           int *        /*skipped */
+    );
+
 extern _X_EXPORT void miWideLine(DrawablePtr /*pDrawable */ ,
                                  GCPtr /*pGC */ ,
                                  int /*mode */ ,
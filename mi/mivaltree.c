@@ -186,6 +186,51 @@ miRegisterRedirectBorderClipProc(SetRedirectBorderClipProcPtr setBorderClip,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+/*
+ * Number of windows whose clips were recomputed, and of marked windows
+ * found unchanged and skipped, by the last miValidateTree call.
+ */
+static int miValidatedWindows;
+static int miValidateSkippedWindows;
+
+/* for the mivaltree test */
+void
+miValidateTreeCounts(int *validated, int *skipped)
+{
+    *validated = miValidatedWindows;
+    *skipped = miValidateSkippedWindows;
+}
+
+/*
+ * pParent and its marked inferiors keep their clips: clear the
+ * exposures HandleExposures will look at.
+ */
+static void
+miTreeUnchanged(WindowPtr pParent)
+{
+    WindowPtr pChild;
+
+    pChild = pParent;
+    while (1) {
+        if (pChild->viewable && pChild->valdata) {
+            if (pChild->valdata->before.borderVisible)
+                RegionDestroy(pChild->valdata->before.borderVisible);
+            RegionNull(&pChild->valdata->after.borderExposed);
+            RegionNull(&pChild->valdata->after.exposed);
+            miValidateSkippedWindows++;
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pParent))
+            pChild = pChild->parent;
+        if (pChild == pParent)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -289,6 +334,27 @@ miComputeClips(WindowPtr pParent,
     dx = pParent->drawable.x - pParent->valdata->before.oldAbsCorner.x;
     dy = pParent->drawable.y - pParent->valdata->before.oldAbsCorner.y;
 
+    /*
+     * A window that was marked only because it overlaps the changed
+     * area, and whose borderClip comes out the same as before, keeps
+     * the clips of its whole subtree: those depend only on the
+     * borderClip and on the unclipped geometry of the subtree, and
+     * only windows that moved (dx, dy) or were resized or reshaped
+     * (resized, borderVisible) had their geometry changed.  This is
+     * the common case for restacking, where most of the marked
+     * windows are never uncovered.
+     */
+    if (kind != VTBroken && !dx && !dy && oldVis == newVis &&
+        oldVis != VisibilityNotViewable &&
+        !pParent->valdata->before.resized &&
+        !pParent->valdata->before.borderVisible &&
+        !RegionBroken(&pParent->borderClip) &&
+        RegionEqual(universe, &pParent->borderClip)) {
+        miTreeUnchanged(pParent);
+        return;
+    }
+    miValidatedWindows++;
+
     /*
      * avoid computations when dealing with simple operations
      */
@@ -571,6 +637,9 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
     if (pChild == NullWindow)
         pChild = pParent->firstChild;
 
+    miValidatedWindows = 0;
+    miValidateSkippedWindows = 0;
+
     RegionNull(&childClip);
     RegionNull(&exposed);
 
@@ -164,6 +164,137 @@ damageReportDamagePostRendering(DamagePtr pDamage, RegionPtr pOldDamage,
     RegionUninit(&newDamage);
 }
 
+/*
+ * Accumulating damage.  Boxes are appended to pDamage->boxes and merged
+ * into pDamage->damage with a single union when the region is needed,
+ * instead of one union per drawing operation.
+ */
+
+/* unsimplified box lists are folded into the region at this length */
+#define DAMAGE_BOXES_MAX	256
+
+static int
+damageBoxArea(int x1, int y1, int x2, int y2)
+{
+    return (x2 - x1) * (y2 - y1);
+}
+
+/*
+ * Add pBox to the n boxes, merging it into the bounding box of one of
+ * them when it is within slop pixels, or, when there already are max
+ * boxes, into the one that grows least.  Returns the new count.
+ */
+static int
+damageMergeBox(BoxPtr boxes, int n, int max, int slop, BoxPtr pBox)
+{
+    BoxPtr b, best = NULL;
+    int i, cost, bestCost = 0;
+    int x1, y1, x2, y2;
+
+    for (i = 0; i < n; i++) {
+        b = &boxes[i];
+        if (pBox->x1 < b->x2 + slop && b->x1 < pBox->x2 + slop &&
+            pBox->y1 < b->y2 + slop && b->y1 < pBox->y2 + slop) {
+            best = b;
+            break;
+        }
+        if (n < max)
+            continue;
+        x1 = min(b->x1, pBox->x1);
+        y1 = min(b->y1, pBox->y1);
+        x2 = max(b->x2, pBox->x2);
+        y2 = max(b->y2, pBox->y2);
+        cost = damageBoxArea(x1, y1, x2, y2) -
+            damageBoxArea(b->x1, b->y1, b->x2, b->y2);
+        if (!best || cost < bestCost) {
+            best = b;
+            bestCost = cost;
+        }
+    }
+    if (!best) {
+        boxes[n] = *pBox;
+        return n + 1;
+    }
+    best->x1 = min(best->x1, pBox->x1);
+    best->y1 = min(best->y1, pBox->y1);
+    best->x2 = max(best->x2, pBox->x2);
+    best->y2 = max(best->y2, pBox->y2);
+    return n;
+}
+
+/* Bring pDamage->damage down to at most maxBoxes rectangles. */
+static void
+damageSimplify(DamagePtr pDamage)
+{
+    int target = pDamage->maxBoxes;
+    int i, n, nrects;
+    BoxPtr rects;
+
+    while (RegionNumRects(&pDamage->damage) > pDamage->maxBoxes) {
+        nrects = RegionNumRects(&pDamage->damage);
+        rects = RegionRects(&pDamage->damage);
+        n = 0;
+        for (i = 0; i < nrects; i++)
+            n = damageMergeBox(pDamage->boxes, n, target, pDamage->slop,
+                               &rects[i]);
+        /* overlapping boxes may band into more rectangles: try fewer */
+        RegionUninit(&pDamage->damage);
+        RegionInitBoxes(&pDamage->damage, pDamage->boxes, n);
+        target = max(target / 2, 1);
+    }
+}
+
+/* Merge the accumulated boxes into pDamage->damage. */
+static void
+damageFlushBoxes(DamagePtr pDamage)
+{
+    RegionRec region;
+
+    if (!pDamage->nBoxes)
+        return;
+    RegionInitBoxes(&region, pDamage->boxes, pDamage->nBoxes);
+    RegionUnion(&pDamage->damage, &pDamage->damage, &region);
+    RegionUninit(&region);
+    pDamage->nBoxes = 0;
+    if (pDamage->maxBoxes)
+        damageSimplify(pDamage);
+}
+
+static Bool
+damageIsEmpty(DamagePtr pDamage)
+{
+    return !pDamage->nBoxes && !RegionNotEmpty(&pDamage->damage);
+}
+
+/* Add pRegion to the damage of pDamage. */
+static void
+damageAccumulate(DamagePtr pDamage, RegionPtr pRegion)
+{
+    int i, nrects = RegionNumRects(pRegion);
+    BoxPtr rects = RegionRects(pRegion), last;
+
+    if (!pDamage->accumulate) {
+        RegionUnion(&pDamage->damage, &pDamage->damage, pRegion);
+        return;
+    }
+    for (i = 0; i < nrects; i++) {
+        if (pDamage->maxBoxes) {
+            pDamage->nBoxes = damageMergeBox(pDamage->boxes, pDamage->nBoxes,
+                                             pDamage->maxBoxes, pDamage->slop,
+                                             &rects[i]);
+            continue;
+        }
+        /* repeated drawing to the same place is common */
+        last = pDamage->nBoxes ? &pDamage->boxes[pDamage->nBoxes - 1] : NULL;
+        if (last && last->x1 <= rects[i].x1 && last->y1 <= rects[i].y1 &&
+            last->x2 >= rects[i].x2 && last->y2 >= rects[i].y2)
+            continue;
+        if (pDamage->nBoxes == pDamage->sizeBoxes)
+            damageFlushBoxes(pDamage);
+        pDamage->boxes[pDamage->nBoxes++] = rects[i];
+    }
+}
+
 #if DAMAGE_DEBUG_ENABLE
 static void
 _damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
@@ -304,15 +435,17 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
                         &pDamage->pendingDamage, pDamageRegion);
 
         /* Duplicate current damage if needed. */
-        if (pDamage->damageMarker)
+        if (pDamage->damageMarker) {
+            damageFlushBoxes(pDamage);
             RegionCopy(&pDamage->backupDamage, &pDamage->damage);
+        }
 
         /* Report damage now, if desired. */
         if (!pDamage->reportAfter) {
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAccumulate(pDamage, pDamageRegion);
         }
 
         /*
@@ -346,8 +479,7 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage,
-                            &pDamage->pendingDamage);
+                damageAccumulate(pDamage, &pDamage->pendingDamage);
         }
 
         if (pDamage->reportAfter || pDamage->damageMarker)
@@ -1789,6 +1921,12 @@ DamageCreate(DamageReportFunc damageReport,
     pDamage->damageReportPostRendering = NULL;
     pDamage->damageDestroy = damageDestroy;
     pDamage->damageMarker = NULL;
+    pDamage->accumulate = FALSE;
+    pDamage->maxBoxes = 0;
+    pDamage->slop = 0;
+    pDamage->boxes = NULL;
+    pDamage->nBoxes = 0;
+    pDamage->sizeBoxes = 0;
     pDamage->pScreen = pScreen;
 
     (*pScrPriv->funcs.Create) (pDamage);
@@ -1893,6 +2031,7 @@ DamageDestroy(DamagePtr pDamage)
     (*pScrPriv->funcs.Destroy) (pDamage);
     RegionUninit(&pDamage->damage);
     RegionUninit(&pDamage->pendingDamage);
+    free(pDamage->boxes);
     dixFreeObjectWithPrivates(pDamage, PRIVATE_DAMAGE);
 }
 
@@ -1903,6 +2042,7 @@ DamageSubtract(DamagePtr pDamage, const RegionPtr pRegion)
     RegionRec pixmapClip;
     DrawablePtr pDrawable = pDamage->pDrawable;
 
+    damageFlushBoxes(pDamage);
     RegionSubtract(&pDamage->damage, &pDamage->damage, pRegion);
     if (pDrawable) {
         if (pDrawable->type == DRAWABLE_WINDOW)
@@ -1929,12 +2069,14 @@ DamageSubtract(DamagePtr pDamage, const RegionPtr pRegion)
 void
 DamageEmpty(DamagePtr pDamage)
 {
+    pDamage->nBoxes = 0;
     RegionEmpty(&pDamage->damage);
 }
 
 RegionPtr
 DamageRegion(DamagePtr pDamage)
 {
+    damageFlushBoxes(pDamage);
     return &pDamage->damage;
 }
 
@@ -1995,6 +2137,36 @@ DamageSetPostRenderingFunctions(DamagePtr pDamage,
     pDamage->damageMarker = damageMarker;
 }
 
+void
+DamageSetAccumulate(DamagePtr pDamage, int maxBoxes, int slop)
+{
+    int size = maxBoxes > 0 ? maxBoxes : DAMAGE_BOXES_MAX;
+    BoxPtr boxes;
+
+    if (pDamage->damageLevel != DamageReportNone &&
+        pDamage->damageLevel != DamageReportNonEmpty)
+        return;
+    damageFlushBoxes(pDamage);
+    boxes = realloc(pDamage->boxes, size * sizeof(BoxRec));
+    if (!boxes)
+        return;
+    pDamage->boxes = boxes;
+    pDamage->sizeBoxes = size;
+    pDamage->accumulate = TRUE;
+    pDamage->maxBoxes = max(maxBoxes, 0);
+    pDamage->slop = max(slop, 0);
+    if (pDamage->maxBoxes)
+        damageSimplify(pDamage);
+}
+
+Bool
+DamagePixmapHasDamage(PixmapPtr pPixmap)
+{
+    if (!dixPrivateKeyRegistered(damagePixPrivateKey))
+        return FALSE;
+    return *getPixmapDamageRef(pPixmap) != NULL;
+}
+
 DamageScreenFuncsPtr
 DamageGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -2032,15 +2204,16 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         }
         break;
     case DamageReportNonEmpty:
-        was_empty = !RegionNotEmpty(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
-        if (was_empty && RegionNotEmpty(&pDamage->damage)) {
+        was_empty = damageIsEmpty(pDamage);
+        damageAccumulate(pDamage, pDamageRegion);
+        if (was_empty && !damageIsEmpty(pDamage)) {
+            damageFlushBoxes(pDamage);
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, pDamageRegion);
         break;
     }
 }
@@ -128,6 +128,20 @@ DamageSetPostRenderingFunctions(DamagePtr pDamage,
                                 DamageReportFunc damageReportPostRendering,
                                 DamageMarkerFunc damageMarker);
 
+/* Collect damage in a list of boxes and build the region only when it is
+ * asked for.  With maxBoxes > 0 the damage is also simplified to at most
+ * maxBoxes rectangles, merging boxes less than slop pixels apart, at the
+ * price of reporting some undamaged pixels.  Only DamageReportNone and
+ * DamageReportNonEmpty can accumulate; other levels ignore this. */
+extern _X_EXPORT void
+
+DamageSetAccumulate(DamagePtr pDamage, int maxBoxes, int slop);
+
+/* Whether any damage is registered on pPixmap itself, as opposed to on
+ * windows drawn to it. */
+extern _X_EXPORT Bool
+DamagePixmapHasDamage(PixmapPtr pPixmap);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
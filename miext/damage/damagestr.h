@@ -51,6 +51,14 @@ typedef struct _damage {
     Bool reportAfter;
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
     RegionRec backupDamage;     /* for use with damageMarker */
+
+    Bool accumulate;            /* see DamageSetAccumulate */
+    int maxBoxes;
+    int slop;
+    BoxPtr boxes;               /* damage not yet merged into 'damage' */
+    int nBoxes;
+    int sizeBoxes;
+
     ScreenPtr pScreen;
     PrivateRec *devPrivates;
 } DamageRec;
@@ -35,6 +35,8 @@
 #include    "globals.h"
 #include    "gcstruct.h"
 #include    "shadow.h"
+#include    "fb.h"
+#include    "opaque.h"
 
 static DevPrivateKeyRec shadowScrPrivateKeyRec;
 
@@ -49,26 +51,106 @@ static DevPrivateKeyRec shadowScrPrivateKeyRec;
     real->mem = priv->mem; \
 }
 
+/* damage of at most this many pixels is copied without waiting */
+#define SHADOW_SMALL_DAMAGE	(64 * 64)
+
+#define SHADOW_STATS_INTERVAL	10000   /* ms */
+
+static unsigned long
+shadowDamageArea(RegionPtr pRegion)
+{
+    BoxPtr pbox = RegionRects(pRegion);
+    int nbox = RegionNumRects(pRegion);
+    unsigned long area = 0;
+
+    for (; nbox--; pbox++)
+        area += (unsigned long) (pbox->x2 - pbox->x1) * (pbox->y2 - pbox->y1);
+    return area;
+}
+
+static void
+shadowCountUpdate(ScreenPtr pScreen, shadowBufPtr pBuf, RegionPtr pRegion,
+                  CARD32 now)
+{
+    CARD32 elapsed = now - pBuf->statsStart;
+
+    pBuf->statsUpdates++;
+    pBuf->statsBytes += shadowDamageArea(pRegion) *
+        pBuf->pPixmap->drawable.bitsPerPixel / 8;
+    if (elapsed < SHADOW_STATS_INTERVAL)
+        return;
+
+    LogMessageVerb(X_INFO, 3, "shadow: screen %d: %lu updates/s, %lu kB/s\n",
+                   pScreen->myNum, pBuf->statsUpdates * 1000 / elapsed,
+                   pBuf->statsBytes / elapsed);
+    pBuf->statsStart = now;
+    pBuf->statsUpdates = 0;
+    pBuf->statsBytes = 0;
+}
+
 static void
 shadowRedisplay(ScreenPtr pScreen)
 {
     shadowBuf(pScreen);
     RegionPtr pRegion;
+    CARD32 now;
 
     if (!pBuf || !pBuf->pDamage || !pBuf->update)
         return;
     pRegion = DamageRegion(pBuf->pDamage);
     if (RegionNotEmpty(pRegion)) {
+        now = GetTimeInMillis();
+        shadowCountUpdate(pScreen, pBuf, pRegion, now);
         (*pBuf->update) (pScreen, pBuf);
         DamageEmpty(pBuf->pDamage);
+        pBuf->lastUpdate = now;
     }
+    if (pBuf->timer)
+        TimerCancel(pBuf->timer);
+}
+
+static CARD32
+shadowTimeout(OsTimerPtr pTimer, CARD32 now, pointer arg)
+{
+    shadowRedisplay((ScreenPtr) arg);
+    return 0;
 }
 
+/*
+ * Small damage, like text or a cursor, is copied right away.  Larger
+ * damage is copied at most shadowRefreshRate times a second; whatever
+ * is drawn until then is merged into the same copy by the timer.
+ */
 static void
 shadowBlockHandler(pointer data, OSTimePtr pTimeout, pointer pRead)
 {
     ScreenPtr pScreen = (ScreenPtr) data;
 
+    shadowBuf(pScreen);
+    RegionPtr pRegion;
+    CARD32 interval, since;
+
+    if (!pBuf || !pBuf->pDamage || !pBuf->update)
+        return;
+    pRegion = DamageRegion(pBuf->pDamage);
+    if (!RegionNotEmpty(pRegion))
+        return;
+
+    if (shadowRefreshRate > 0 &&
+        shadowDamageArea(pRegion) > SHADOW_SMALL_DAMAGE) {
+        interval = 1000 / shadowRefreshRate;
+        since = GetTimeInMillis() - pBuf->lastUpdate;
+        if (since < interval) {
+            /* the deadline stays put however often we get here */
+            pBuf->timer = TimerSet(pBuf->timer, 0, interval - since,
+                                   shadowTimeout, pScreen);
+            if (pBuf->timer) {
+                /* WaitForSomething has already looked at the timers */
+                AdjustWaitForDelay(pTimeout, interval - since);
+                return;
+            }
+        }
+    }
     shadowRedisplay(pScreen);
 }
 
@@ -103,6 +185,7 @@ shadowCloseScreen(ScreenPtr pScreen)
     unwrap(pBuf, pScreen, GetImage);
     unwrap(pBuf, pScreen, CloseScreen);
     shadowRemove(pScreen, pBuf->pPixmap);
+    TimerFree(pBuf->timer);
     DamageDestroy(pBuf->pDamage);
 #ifdef BACKWARDS_COMPATIBILITY
     RegionUninit(&pBuf->damage);        /* bc */
@@ -168,6 +251,11 @@ shadowSetup(ScreenPtr pScreen)
     pBuf->pPixmap = 0;
     pBuf->closure = 0;
     pBuf->randr = 0;
+    pBuf->threaded = FALSE;
+    pBuf->timer = NULL;
+    pBuf->lastUpdate = 0;
+    pBuf->statsUpdates = 0;
+    pBuf->statsBytes = 0;
 #ifdef BACKWARDS_COMPATIBILITY
     RegionNull(&pBuf->damage);  /* bc */
 #endif
@@ -209,6 +297,7 @@ shadowAdd(ScreenPtr pScreen, PixmapPtr pPixmap, ShadowUpdateProc update,
     pBuf->randr = randr;
     pBuf->closure = closure;
     pBuf->pPixmap = pPixmap;
+    pBuf->statsStart = GetTimeInMillis();
     DamageRegister(&pPixmap->drawable, pBuf->pDamage);
     return TRUE;
 }
@@ -225,12 +314,92 @@ shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap)
         pBuf->randr = 0;
         pBuf->closure = 0;
         pBuf->pPixmap = 0;
+        pBuf->threaded = FALSE;
     }
+    if (pBuf->timer)
+        TimerCancel(pBuf->timer);
 
     RemoveBlockAndWakeupHandlers(shadowBlockHandler, shadowWakeupHandler,
                                  (pointer) pScreen);
 }
 
+/*
+ * Drivers whose window proc only computes an address in a linearly
+ * mapped frame buffer set this after shadowAdd(); with -threads the
+ * update procs may then copy several bands of the damage at once.
+ */
+void
+shadowSetThreaded(ScreenPtr pScreen, Bool threaded)
+{
+    shadowBuf(pScreen);
+
+    pBuf->threaded = threaded;
+}
+
+typedef struct {
+    ScreenPtr pScreen;
+    shadowBufPtr pBuf;
+    ShadowBoxProc update;
+    BoxPtr pbox;
+    int nbox;
+    int y1, y2;                 /* damage extents */
+} ShadowBandRec, *ShadowBandPtr;
+
+static void
+shadowUpdateBand(pointer closure, int band, int nbands)
+{
+    ShadowBandPtr sb = closure;
+    int h = sb->y2 - sb->y1;
+    int y1 = sb->y1 + h * band / nbands;
+    int y2 = sb->y1 + h * (band + 1) / nbands;
+    BoxPtr pbox = sb->pbox;
+    int nbox = sb->nbox;
+    BoxRec box;
+
+    for (; nbox--; pbox++) {
+        /* boxes are y-x banded */
+        if (pbox->y1 >= y2)
+            break;
+        if (pbox->y2 <= y1)
+            continue;
+        box = *pbox;
+        if (box.y1 < y1)
+            box.y1 = y1;
+        if (box.y2 > y2)
+            box.y2 = y2;
+        if (!(*sb->update) (sb->pScreen, sb->pBuf, &box))
+            return;
+    }
+}
+
+/*
+ * Run update over every box of the damage.  When the window proc is
+ * thread safe the damage is cut into horizontal bands of the shadow,
+ * which never write to the same frame buffer pixels whatever the
+ * rotation, and the bands are copied by the fb worker threads.
+ */
+void
+shadowUpdateBoxes(ScreenPtr pScreen, shadowBufPtr pBuf, ShadowBoxProc update)
+{
+    RegionPtr damage = shadowDamage(pBuf);
+    BoxPtr extents = RegionExtents(damage);
+    ShadowBandRec sb;
+    int nbands = 1;
+
+    sb.pScreen = pScreen;
+    sb.pBuf = pBuf;
+    sb.update = update;
+    sb.pbox = RegionRects(damage);
+    sb.nbox = RegionNumRects(damage);
+    sb.y1 = extents->y1;
+    sb.y2 = extents->y2;
+
+    if (pBuf->threaded)
+        nbands = fbThreadBands(extents->x2 - extents->x1,
+                               extents->y2 - extents->y1);
+    fbThreadRun(nbands, shadowUpdateBand, &sb);
+}
+
 Bool
 shadowInit(ScreenPtr pScreen, ShadowUpdateProc update, ShadowWindowProc window)
 {
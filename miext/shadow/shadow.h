@@ -43,6 +43,10 @@ typedef void *(*ShadowWindowProc) (ScreenPtr pScreen,
                                    CARD32 offset,
                                    int mode, CARD32 *size, void *closure);
 
+/* Copies one damaged box, clipped to what the caller hands out */
+typedef Bool (*ShadowBoxProc) (ScreenPtr pScreen,
+                               shadowBufPtr pBuf, BoxPtr pBox);
+
 /* BC hack: do not move the damage member.  see shadow.c for explanation. */
 typedef struct _shadowBuf {
     DamagePtr pDamage;
@@ -56,6 +60,17 @@ typedef struct _shadowBuf {
     /* screen wrappers */
     GetImageProcPtr GetImage;
     CloseScreenProcPtr CloseScreen;
+
+    Bool threaded;              /* window may be called from any thread */
+
+    /* pacing to shadowRefreshRate */
+    OsTimerPtr timer;
+    CARD32 lastUpdate;
+
+    /* statistics, logged every SHADOW_STATS_INTERVAL */
+    CARD32 statsStart;
+    unsigned long statsUpdates;
+    unsigned long statsBytes;
 } shadowBufRec;
 
 /* Match defines from randr extension */
@@ -93,6 +108,12 @@ extern _X_EXPORT Bool
 
 shadowInit(ScreenPtr pScreen, ShadowUpdateProc update, ShadowWindowProc window);
 
+extern _X_EXPORT void
+ shadowSetThreaded(ScreenPtr pScreen, Bool threaded);
+
+extern _X_EXPORT void
+ shadowUpdateBoxes(ScreenPtr pScreen, shadowBufPtr pBuf, ShadowBoxProc update);
+
 extern _X_EXPORT void *shadowAlloc(int width, int height, int bpp);
 
 extern _X_EXPORT void
@@ -48,6 +48,59 @@
 #define TOP_TO_BOTTOM	2
 #define BOTTOM_TO_TOP	-2
 
+/*
+ * Pick the update proc for a plain rotation of a depth that has one of
+ * its own; those copy whole tiles and may run on several threads.
+ */
+static ShadowUpdateProc
+shadowRotateProc(shadowBufPtr pBuf)
+{
+    static const ShadowUpdateProc procs[3][4] = {
+        {shadowUpdateRotate8, shadowUpdateRotate8_90,
+         shadowUpdateRotate8_180, shadowUpdateRotate8_270},
+        {shadowUpdateRotate16, shadowUpdateRotate16_90,
+         shadowUpdateRotate16_180, shadowUpdateRotate16_270},
+        {shadowUpdateRotate32, shadowUpdateRotate32_90,
+         shadowUpdateRotate32_180, shadowUpdateRotate32_270},
+    };
+    int depth, rotation;
+
+    if (pBuf->randr & SHADOW_REFLECT_ALL)
+        return NULL;
+
+    switch (pBuf->pPixmap->drawable.bitsPerPixel) {
+    case 8:
+        depth = 0;
+        break;
+    case 16:
+        depth = 1;
+        break;
+    case 32:
+        depth = 2;
+        break;
+    default:
+        return NULL;
+    }
+
+    switch (pBuf->randr & SHADOW_ROTATE_ALL) {
+    case SHADOW_ROTATE_0:
+        rotation = 0;
+        break;
+    case SHADOW_ROTATE_90:
+        rotation = 1;
+        break;
+    case SHADOW_ROTATE_180:
+        rotation = 2;
+        break;
+    case SHADOW_ROTATE_270:
+        rotation = 3;
+        break;
+    default:
+        return NULL;
+    }
+    return procs[depth][rotation];
+}
+
 void
 shadowUpdateRotatePacked(ScreenPtr pScreen, shadowBufPtr pBuf)
 {
@@ -77,6 +130,12 @@ shadowUpdateRotatePacked(ScreenPtr pScreen, shadowBufPtr pBuf)
     int o_y_dir;
     int x_dir;
     int y_dir;
+    ShadowUpdateProc update = shadowRotateProc(pBuf);
+
+    if (update) {
+        (*update) (pScreen, pBuf);
+        return;
+    }
 
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
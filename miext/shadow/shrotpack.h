@@ -45,6 +45,10 @@
 #include    "shadow.h"
 #include    "fb.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define DANDEBUG         0
 
 #if ROTATE == 270
@@ -57,6 +61,8 @@
 #define NEXTY(x,y,w,h)	    ((x)++)
 #define SHASTEPX(stride)    -(stride)
 #define SHASTEPY(stride)    (1)
+#define TILELINE(sx)	    (sx)
+#define TILEROW(o)	    (pScreen->height - (o) - 1)
 
 #elif ROTATE == 90
 
@@ -68,6 +74,8 @@
 #define NEXTY(x,y,w,h)	    ((void)(x))
 #define SHASTEPX(stride)    (stride)
 #define SHASTEPY(stride)    (-1)
+#define TILELINE(sx)	    (pScreen->width - (sx) - 1)
+#define TILEROW(o)	    (o)
 
 #elif ROTATE == 180
 
@@ -93,13 +101,193 @@
 
 #endif
 
-void
-FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
+#ifdef TILELINE
+
+/*
+ * Every output line of a 90 or 270 degree rotation is a column of the
+ * shadow, and walking down a column touches a new cache line for each
+ * pixel.  Instead, blocks of TILE_LINES columns by TILE_PIXELS rows are
+ * read a row at a time, transposed into a tile on the stack and the
+ * lines of the tile are then copied out whole.  The 8KB tile and the
+ * shadow rows it came from stay in the L1 cache at every depth.
+ */
+#define TILE_LINES	32
+#define TILE_PIXELS	(256 / sizeof(Data))
+
+static void
+shadowRotateTranspose(Data tile[TILE_LINES][TILE_PIXELS], Data **rows,
+                      int nt, int nc)
+{
+    int t = 0, c;
+
+#ifdef __SSE2__
+    if (sizeof(Data) == 4) {
+        for (; t + 4 <= nt; t += 4) {
+            for (c = 0; c + 4 <= nc; c += 4) {
+                __m128i r0 = _mm_loadu_si128((__m128i *) (rows[c] + t));
+                __m128i r1 = _mm_loadu_si128((__m128i *) (rows[c + 1] + t));
+                __m128i r2 = _mm_loadu_si128((__m128i *) (rows[c + 2] + t));
+                __m128i r3 = _mm_loadu_si128((__m128i *) (rows[c + 3] + t));
+                __m128i a0 = _mm_unpacklo_epi32(r0, r1);
+                __m128i a1 = _mm_unpacklo_epi32(r2, r3);
+                __m128i a2 = _mm_unpackhi_epi32(r0, r1);
+                __m128i a3 = _mm_unpackhi_epi32(r2, r3);
+
+                _mm_storeu_si128((__m128i *) &tile[t][c],
+                                 _mm_unpacklo_epi64(a0, a1));
+                _mm_storeu_si128((__m128i *) &tile[t + 1][c],
+                                 _mm_unpackhi_epi64(a0, a1));
+                _mm_storeu_si128((__m128i *) &tile[t + 2][c],
+                                 _mm_unpacklo_epi64(a2, a3));
+                _mm_storeu_si128((__m128i *) &tile[t + 3][c],
+                                 _mm_unpackhi_epi64(a2, a3));
+            }
+            for (; c < nc; c++) {
+                tile[t][c] = rows[c][t];
+                tile[t + 1][c] = rows[c][t + 1];
+                tile[t + 2][c] = rows[c][t + 2];
+                tile[t + 3][c] = rows[c][t + 3];
+            }
+        }
+    }
+    else if (sizeof(Data) == 2) {
+        for (; t + 8 <= nt; t += 8) {
+            for (c = 0; c + 8 <= nc; c += 8) {
+                __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+                __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+                a0 = _mm_loadu_si128((__m128i *) (rows[c] + t));
+                a1 = _mm_loadu_si128((__m128i *) (rows[c + 1] + t));
+                a2 = _mm_loadu_si128((__m128i *) (rows[c + 2] + t));
+                a3 = _mm_loadu_si128((__m128i *) (rows[c + 3] + t));
+                a4 = _mm_loadu_si128((__m128i *) (rows[c + 4] + t));
+                a5 = _mm_loadu_si128((__m128i *) (rows[c + 5] + t));
+                a6 = _mm_loadu_si128((__m128i *) (rows[c + 6] + t));
+                a7 = _mm_loadu_si128((__m128i *) (rows[c + 7] + t));
+
+                b0 = _mm_unpacklo_epi16(a0, a1);
+                b1 = _mm_unpackhi_epi16(a0, a1);
+                b2 = _mm_unpacklo_epi16(a2, a3);
+                b3 = _mm_unpackhi_epi16(a2, a3);
+                b4 = _mm_unpacklo_epi16(a4, a5);
+                b5 = _mm_unpackhi_epi16(a4, a5);
+                b6 = _mm_unpacklo_epi16(a6, a7);
+                b7 = _mm_unpackhi_epi16(a6, a7);
+
+                a0 = _mm_unpacklo_epi32(b0, b2);
+                a1 = _mm_unpackhi_epi32(b0, b2);
+                a2 = _mm_unpacklo_epi32(b1, b3);
+                a3 = _mm_unpackhi_epi32(b1, b3);
+                a4 = _mm_unpacklo_epi32(b4, b6);
+                a5 = _mm_unpackhi_epi32(b4, b6);
+                a6 = _mm_unpacklo_epi32(b5, b7);
+                a7 = _mm_unpackhi_epi32(b5, b7);
+
+                _mm_storeu_si128((__m128i *) &tile[t][c],
+                                 _mm_unpacklo_epi64(a0, a4));
+                _mm_storeu_si128((__m128i *) &tile[t + 1][c],
+                                 _mm_unpackhi_epi64(a0, a4));
+                _mm_storeu_si128((__m128i *) &tile[t + 2][c],
+                                 _mm_unpacklo_epi64(a1, a5));
+                _mm_storeu_si128((__m128i *) &tile[t + 3][c],
+                                 _mm_unpackhi_epi64(a1, a5));
+                _mm_storeu_si128((__m128i *) &tile[t + 4][c],
+                                 _mm_unpacklo_epi64(a2, a6));
+                _mm_storeu_si128((__m128i *) &tile[t + 5][c],
+                                 _mm_unpackhi_epi64(a2, a6));
+                _mm_storeu_si128((__m128i *) &tile[t + 6][c],
+                                 _mm_unpacklo_epi64(a3, a7));
+                _mm_storeu_si128((__m128i *) &tile[t + 7][c],
+                                 _mm_unpackhi_epi64(a3, a7));
+            }
+            for (; c < nc; c++) {
+                int i;
+
+                for (i = 0; i < 8; i++)
+                    tile[t + i][c] = rows[c][t + i];
+            }
+        }
+    }
+#endif
+    for (c = 0; c < nc; c++) {
+        Data *sha = rows[c];
+        int i;
+
+        for (i = t; i < nt; i++)
+            tile[i][c] = sha[i];
+    }
+}
+
+static Bool
+shadowRotateWrite(ScreenPtr pScreen, shadowBufPtr pBuf, CARD32 row, int scr,
+                  Data *src, int width)
+{
+    Data *win;
+    CARD32 winSize;
+    int i;
+
+    while (width) {
+        win = (Data *) (*pBuf->window) (pScreen, row, scr * sizeof(Data),
+                                        SHADOW_WINDOW_WRITE, &winSize,
+                                        pBuf->closure);
+        if (!win)
+            return FALSE;
+        i = winSize / sizeof(Data);
+        if (i > width)
+            i = width;
+        memcpy(win, src, i * sizeof(Data));
+        src += i;
+        scr += i;
+        width -= i;
+    }
+    return TRUE;
+}
+
+static Bool
+shadowRotateBox(ScreenPtr pScreen, shadowBufPtr pBuf, BoxPtr pbox)
+{
+    PixmapPtr pShadow = pBuf->pPixmap;
+    FbBits *shaBits;
+    Data *shaBase;
+    FbStride shaStride;
+    int shaBpp;
+    _X_UNUSED int shaXoff, shaYoff;
+    Data tile[TILE_LINES][TILE_PIXELS];
+    Data *rows[TILE_PIXELS];
+    int x, o, o1, o2, nt, nc, t, c;
+
+    fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
+                  shaYoff);
+    shaBase = (Data *) shaBits;
+    shaStride = shaStride * sizeof(FbBits) / sizeof(Data);
+
+    /* output offsets covered by the box, one per shadow row */
+    o1 = SCRLEFT(pbox->x1, pbox->y1, pbox->x2 - pbox->x1,
+                 pbox->y2 - pbox->y1);
+    o2 = o1 + pbox->y2 - pbox->y1;
+
+    for (x = pbox->x1; x < pbox->x2; x += nt) {
+        nt = min(pbox->x2 - x, TILE_LINES);
+        for (o = o1; o < o2; o += nc) {
+            nc = min(o2 - o, TILE_PIXELS);
+            for (c = 0; c < nc; c++)
+                rows[c] = shaBase + TILEROW(o + c) * shaStride + x;
+            shadowRotateTranspose(tile, rows, nt, nc);
+            for (t = 0; t < nt; t++)
+                if (!shadowRotateWrite(pScreen, pBuf, TILELINE(x + t), o,
+                                       tile[t], nc))
+                    return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+#else
+
+static Bool
+shadowRotateBox(ScreenPtr pScreen, shadowBufPtr pBuf, BoxPtr pbox)
 {
-    RegionPtr damage = shadowDamage(pBuf);
     PixmapPtr pShadow = pBuf->pPixmap;
-    int nbox = RegionNumRects(damage);
-    BoxPtr pbox = RegionRects(damage);
     FbBits *shaBits;
     Data *shaBase, *shaLine, *sha;
     FbStride shaStride;
@@ -115,80 +303,65 @@ FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
                   shaYoff);
     shaBase = (Data *) shaBits;
     shaStride = shaStride * sizeof(FbBits) / sizeof(Data);
-#if (DANDEBUG > 1)
-    ErrorF
-        ("-> Entering Shadow Update:\r\n   |- Origins: pShadow=%x, pScreen=%x, damage=%x\r\n   |- Metrics: shaStride=%d, shaBase=%x, shaBpp=%d\r\n   |                                                     \n",
-         pShadow, pScreen, damage, shaStride, shaBase, shaBpp);
-#endif
-    while (nbox--) {
-        x = pbox->x1;
-        y = pbox->y1;
-        w = (pbox->x2 - pbox->x1);
-        h = pbox->y2 - pbox->y1;
+
+    x = pbox->x1;
+    y = pbox->y1;
+    w = (pbox->x2 - pbox->x1);
+    h = pbox->y2 - pbox->y1;
 
 #if (DANDEBUG > 2)
-        ErrorF
-            ("   |-> Redrawing box - Metrics: X=%d, Y=%d, Width=%d, Height=%d\n",
-             x, y, w, h);
-#endif
-        scrLine = SCRLEFT(x, y, w, h);
-        shaLine = shaBase + FIRSTSHA(x, y, w, h);
-
-        while (STEPDOWN(x, y, w, h)) {
-            winSize = 0;
-            scrBase = 0;
-            width = SCRWIDTH(x, y, w, h);
-            scr = scrLine;
-            sha = shaLine;
-#if (DANDEBUG > 3)
-            ErrorF("   |   |-> StepDown - Metrics: width=%d, scr=%x, sha=%x\n",
-                   width, scr, sha);
+    ErrorF("   |-> Redrawing box - Metrics: X=%d, Y=%d, Width=%d, Height=%d\n",
+           x, y, w, h);
 #endif
-            while (width) {
-                /*  how much remains in this window */
-                i = scrBase + winSize - scr;
-                if (i <= 0 || scr < scrBase) {
-                    winBase = (Data *) (*pBuf->window) (pScreen,
-                                                        SCRY(x, y, w, h),
-                                                        scr * sizeof(Data),
-                                                        SHADOW_WINDOW_WRITE,
-                                                        &winSize,
-                                                        pBuf->closure);
-                    if (!winBase)
-                        return;
-                    scrBase = scr;
-                    winSize /= sizeof(Data);
-                    i = winSize;
-#if(DANDEBUG > 4)
-                    ErrorF
-                        ("   |   |   |-> Starting New Line - Metrics: winBase=%x, scrBase=%x, winSize=%d\r\n   |   |   |   Xstride=%d, Ystride=%d, w=%d h=%d\n",
-                         winBase, scrBase, winSize, SHASTEPX(shaStride),
-                         SHASTEPY(shaStride), w, h);
-#endif
-                }
-                win = winBase + (scr - scrBase);
-                if (i > width)
-                    i = width;
-                width -= i;
-                scr += i;
-#if(DANDEBUG > 5)
-                ErrorF
-                    ("   |   |   |-> Writing Line - Metrics: win=%x, sha=%x\n",
-                     win, sha);
+    scrLine = SCRLEFT(x, y, w, h);
+    shaLine = shaBase + FIRSTSHA(x, y, w, h);
+
+    while (STEPDOWN(x, y, w, h)) {
+        winSize = 0;
+        scrBase = 0;
+        width = SCRWIDTH(x, y, w, h);
+        scr = scrLine;
+        sha = shaLine;
+        while (width) {
+            /*  how much remains in this window */
+            i = scrBase + winSize - scr;
+            if (i <= 0 || scr < scrBase) {
+                winBase = (Data *) (*pBuf->window) (pScreen,
+                                                    SCRY(x, y, w, h),
+                                                    scr * sizeof(Data),
+                                                    SHADOW_WINDOW_WRITE,
+                                                    &winSize, pBuf->closure);
+                if (!winBase)
+                    return FALSE;
+                scrBase = scr;
+                winSize /= sizeof(Data);
+                i = winSize;
+            }
+            win = winBase + (scr - scrBase);
+            if (i > width)
+                i = width;
+            width -= i;
+            scr += i;
+#ifndef ROTATE
+            memcpy(win, sha, i * sizeof(Data));
+            sha += i;
+#else
+            while (i--) {
+                *win++ = *sha;
+                sha += SHASTEPX(shaStride);
+            }                   /*  i */
 #endif
-                while (i--) {
-#if(DANDEBUG > 6)
-                    ErrorF
-                        ("   |   |   |-> Writing Pixel - Metrics: win=%x, sha=%d, remaining=%d\n",
-                         win, sha, i);
+        }                       /*  width */
+        shaLine += SHASTEPY(shaStride);
+        NEXTY(x, y, w, h);
+    }                           /*  STEPDOWN */
+    return TRUE;
+}
+
 #endif
-                    *win++ = *sha;
-                    sha += SHASTEPX(shaStride);
-                }               /*  i */
-            }                   /*  width */
-            shaLine += SHASTEPY(shaStride);
-            NEXTY(x, y, w, h);
-        }                       /*  STEPDOWN */
-        pbox++;
-    }                           /*  nbox */
+
+void
+FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
+{
+    shadowUpdateBoxes(pScreen, pBuf, shadowRotateBox);
 }
@@ -69,6 +69,7 @@ SOFTWARE.
 #include <X11/Xpoll.h>
 #include "dixstruct.h"
 #include "opaque.h"
+#include "busfault.h"
 #ifdef DPMSExtension
 #include "dpmsproc.h"
 #endif
@@ -137,6 +138,8 @@ static OsTimerPtr timers = NULL;
  *     greater than ScreenSaverTime, the display is turned off (or
  *     saved, depending on the hardware).  So, WaitForSomething()
  *     has to handle this also (that's why the select() has a timeout.
+ *     The actual wait is done by OsPoll(), which uses epoll where
+ *     available and falls back to select().
  *     For more info on ClientsWithInput, see ReadRequestFromClient().
  *     pClientsReady is an array to store ready client->index values into.
  *****************/
@@ -168,6 +171,9 @@ WaitForSomething(int *pClientsReady)
         /* deal with any blocked jobs */
         if (workQueue)
             ProcessWorkQueue();
+#ifdef BUSFAULT
+        busfault_check();
+#endif
         if (XFD_ANYSET(&ClientsWithInput)) {
             if (!SmartScheduleDisable) {
                 someReady = TRUE;
@@ -181,8 +187,10 @@ WaitForSomething(int *pClientsReady)
             }
         }
         if (someReady) {
+            /* Clients with buffered input stay in the mask: they are
+             * merged back in below anyway, and keeping the interest set
+             * stable spares OsPoll() re-registering them every pass. */
             XFD_COPYSET(&AllSockets, &LastSelectMask);
-            XFD_UNSET(&LastSelectMask, &ClientsWithInput);
         }
         else {
             wt = NULL;
@@ -211,19 +219,20 @@ WaitForSomething(int *pClientsReady)
         if (NewOutputPending)
             FlushAllOutput();
         /* keep this check close to select() call to minimize race */
-        if (dispatchException)
+        if (dispatchException || clientStatsDumpPending)
             i = -1;
         else if (AnyClientsWriteBlocked) {
             XFD_COPYSET(&ClientsWriteBlocked, &clientsWritable);
-            i = Select(MaxClients, &LastSelectMask, &clientsWritable, NULL, wt);
+            i = OsPoll(MaxClients, &LastSelectMask, &clientsWritable, wt);
         }
         else {
-            i = Select(MaxClients, &LastSelectMask, NULL, NULL, wt);
+            i = OsPoll(MaxClients, &LastSelectMask, NULL, wt);
         }
         selecterr = GetErrno();
         WakeupHandler(i, (pointer) &LastSelectMask);
         if (i <= 0) {           /* An error or timeout occurred */
-            if (dispatchException)
+            /* Dispatch() logs the statistics SIGUSR2 asked for */
+            if (dispatchException || clientStatsDumpPending)
                 return 0;
             if (i < 0) {
                 if (selecterr == EBADF) {       /* Some client disconnected */
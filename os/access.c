@@ -226,6 +226,7 @@ static Bool siAddrMatch(int family, pointer addr, int len, HOST * host,
                         ClientPtr client);
 static int siCheckAddr(const char *addrString, int length);
 static void siTypesInitialize(void);
+static Bool siLookupPending;    /* siAddrMatch() had to start a lookup */
 
 /*
  * called when authorization is not enabled to add the
@@ -1380,7 +1381,9 @@ CheckAddr(int family, const void *pAddr, unsigned length)
 }
 
 /* Check if a host is not in the access control list. 
- * Returns 1 if host is invalid, 0 if we've found it. */
+ * Returns 1 if host is invalid, 0 if we've found it, and -1 if that
+ * depends on host name lookups that are still running; HostLookupsDone()
+ * is called when they have finished. */
 
 int
 InvalidHost(register struct sockaddr *saddr, int len, ClientPtr client)
@@ -1411,6 +1414,7 @@ InvalidHost(register struct sockaddr *saddr, int len, ClientPtr client)
         else
             return 0;
     }
+    siLookupPending = FALSE;
     for (host = validhosts; host; host = host->next) {
         if (host->family == FamilyServerInterpreted) {
             if (siAddrMatch(family, addr, len, host, client)) {
@@ -1423,7 +1427,7 @@ InvalidHost(register struct sockaddr *saddr, int len, ClientPtr client)
         }
 
     }
-    return 1;
+    return siLookupPending ? -1 : 1;
 }
 
 static int
@@ -1658,6 +1662,126 @@ siCheckAddr(const char *addrString, int length)
 #endif
 #endif
 
+#if defined(IPv6) && defined(AF_INET6)
+/*
+ * Host name lookups are cached for SI_HOSTNAME_TTL ms, so that a burst
+ * of connections costs one lookup rather than one per client.  With
+ * getaddrinfo_a() the lookup runs in the background: the access check
+ * that needs it reports itself as pending, and the clients waiting for
+ * it are attended again through HostLookupsDone() once it has finished.
+ */
+#define SI_HOSTNAME_TTL 5000    /* ms */
+#define SI_LOOKUP_POLL 10       /* ms between checks on running lookups */
+
+typedef struct _siHostnameLookup {
+    struct _siHostnameLookup *next;
+    char *name;
+    struct addrinfo *addresses; /* result of the last lookup */
+    CARD32 time;                /* when it finished */
+    Bool valid;                 /* addresses may be used */
+#ifdef HAVE_GETADDRINFO_A
+    Bool running;
+    struct gaicb req;
+#endif
+} siHostnameLookupRec, *siHostnameLookupPtr;
+
+static siHostnameLookupPtr siLookups;
+
+#ifdef HAVE_GETADDRINFO_A
+static OsTimerPtr siLookupTimer;
+
+static CARD32
+siLookupCheck(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    siHostnameLookupPtr lookup;
+    Bool running = FALSE, done = FALSE;
+
+    for (lookup = siLookups; lookup; lookup = lookup->next) {
+        if (!lookup->running)
+            continue;
+        switch (gai_error(&lookup->req)) {
+        case EAI_INPROGRESS:
+            running = TRUE;
+            continue;
+        case 0:
+            lookup->addresses = lookup->req.ar_result;
+            break;
+        default:
+            lookup->addresses = NULL;
+            break;
+        }
+        lookup->running = FALSE;
+        lookup->valid = TRUE;
+        lookup->time = now;
+        done = TRUE;
+    }
+    if (done)
+        HostLookupsDone();
+    return running ? SI_LOOKUP_POLL : 0;
+}
+#endif
+
+/* Addresses of hostname, or NULL with siLookupPending set while they are
+ * being looked up. */
+static struct addrinfo *
+siHostnameAddresses(const char *hostname)
+{
+    siHostnameLookupPtr lookup;
+
+    for (lookup = siLookups; lookup; lookup = lookup->next)
+        if (strcmp(lookup->name, hostname) == 0)
+            break;
+    if (!lookup) {
+        lookup = calloc(1, sizeof(siHostnameLookupRec));
+        if (!lookup)
+            return NULL;
+        lookup->name = strdup(hostname);
+        if (!lookup->name) {
+            free(lookup);
+            return NULL;
+        }
+        lookup->next = siLookups;
+        siLookups = lookup;
+    }
+
+#ifdef HAVE_GETADDRINFO_A
+    if (lookup->running) {
+        siLookupPending = TRUE;
+        return NULL;
+    }
+#endif
+    if (lookup->valid && GetTimeInMillis() - lookup->time < SI_HOSTNAME_TTL)
+        return lookup->addresses;
+
+    if (lookup->addresses)
+        freeaddrinfo(lookup->addresses);
+    lookup->addresses = NULL;
+    lookup->valid = FALSE;
+
+#ifdef HAVE_GETADDRINFO_A
+    {
+        struct gaicb *list[1] = { &lookup->req };
+
+        memset(&lookup->req, 0, sizeof(lookup->req));
+        lookup->req.ar_name = lookup->name;
+        if (getaddrinfo_a(GAI_NOWAIT, list, 1, NULL) == 0) {
+            lookup->running = TRUE;
+            siLookupPending = TRUE;
+            siLookupTimer = TimerSet(siLookupTimer, 0, SI_LOOKUP_POLL,
+                                     siLookupCheck, NULL);
+            return NULL;
+        }
+    }
+#endif
+
+    if (getaddrinfo(lookup->name, NULL, NULL, &lookup->addresses) != 0)
+        lookup->addresses = NULL;
+    lookup->valid = TRUE;
+    lookup->time = GetTimeInMillis();
+    return lookup->addresses;
+}
+#endif
+
 static Bool
 siHostnameAddrMatch(int family, pointer addr, int len,
                     const char *siAddr, int siAddrLen, ClientPtr client,
@@ -1682,17 +1806,15 @@ siHostnameAddrMatch(int family, pointer addr, int len,
 
         strlcpy(hostname, siAddr, siAddrLen + 1);
 
-        if (getaddrinfo(hostname, NULL, NULL, &addresses) == 0) {
-            for (a = addresses; a != NULL; a = a->ai_next) {
-                hostaddrlen = a->ai_addrlen;
-                f = ConvertAddr(a->ai_addr, &hostaddrlen, &hostaddr);
-                if ((f == family) && (len == hostaddrlen) &&
-                    (memcmp(addr, hostaddr, len) == 0)) {
-                    res = TRUE;
-                    break;
-                }
+        addresses = siHostnameAddresses(hostname);
+        for (a = addresses; a != NULL; a = a->ai_next) {
+            hostaddrlen = a->ai_addrlen;
+            f = ConvertAddr(a->ai_addr, &hostaddrlen, &hostaddr);
+            if ((f == family) && (len == hostaddrlen) &&
+                (memcmp(addr, hostaddr, len) == 0)) {
+                res = TRUE;
+                break;
             }
-            freeaddrinfo(addresses);
         }
     }
 #else                           /* IPv6 not supported, use gethostbyname instead for IPv4 */
@@ -0,0 +1,167 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Bus faults on shared files
+ *
+ * A file mapped from a client, like an MIT-SHM segment passed as a file
+ * descriptor, can be truncated by that client at any time, after which
+ * touching the mapping raises SIGBUS.  The handler here looks for the
+ * faulting address among the registered mappings, maps anonymous memory
+ * over the whole mapping and lets the access continue.  The owner is
+ * told from busfault_check(), outside of the signal handler, so that
+ * it can drop the segment.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <X11/Xos.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include "misc.h"
+#include "list.h"
+#include "busfault.h"
+
+struct busfault {
+    struct xorg_list list;
+    void *addr;
+    size_t size;
+    Bool valid;
+    busfault_notify_ptr notify;
+    void *context;
+};
+
+static Bool busfaulted;
+static struct xorg_list busfaults;
+static struct sigaction previous_busfault_sigaction;
+
+struct busfault *
+busfault_register_mmap(void *addr, size_t size, busfault_notify_ptr notify,
+                       void *context)
+{
+    struct busfault *busfault;
+
+    busfault = calloc(1, sizeof(struct busfault));
+    if (!busfault)
+        return NULL;
+
+    busfault->addr = addr;
+    busfault->size = size;
+    busfault->valid = TRUE;
+    busfault->notify = notify;
+    busfault->context = context;
+
+    OsBlockSignals();
+    xorg_list_add(&busfault->list, &busfaults);
+    OsReleaseSignals();
+
+    return busfault;
+}
+
+void
+busfault_unregister(struct busfault *busfault)
+{
+    if (!busfault)
+        return;
+    OsBlockSignals();
+    xorg_list_del(&busfault->list);
+    OsReleaseSignals();
+    free(busfault);
+}
+
+/*
+ * Tell the owners of every mapping that faulted since the last call.
+ */
+void
+busfault_check(void)
+{
+    struct busfault *busfault, *tmp;
+
+    if (!busfaulted)
+        return;
+
+    busfaulted = FALSE;
+
+    xorg_list_for_each_entry_safe(busfault, tmp, &busfaults, list) {
+        if (!busfault->valid)
+            (*busfault->notify) (busfault->context);
+    }
+}
+
+static void
+busfault_sigaction(int sig, siginfo_t * info, void *param)
+{
+    void *fault = info->si_addr;
+    struct busfault *iter, *busfault = NULL;
+    void *new_addr;
+
+    xorg_list_for_each_entry(iter, &busfaults, list) {
+        if ((char *) iter->addr <= (char *) fault &&
+            (char *) fault < (char *) iter->addr + iter->size) {
+            busfault = iter;
+            break;
+        }
+    }
+
+    /* a fault of our own, or one more on a mapping already replaced */
+    if (!busfault || !busfault->valid)
+        goto panic;
+
+    busfault->valid = FALSE;
+    busfaulted = TRUE;
+
+    new_addr = mmap(busfault->addr, busfault->size, PROT_READ | PROT_WRITE,
+                    MAP_ANONYMOUS | MAP_PRIVATE | MAP_FIXED, -1, 0);
+    if (new_addr == MAP_FAILED)
+        goto panic;
+    return;
+
+ panic:
+    if (previous_busfault_sigaction.sa_flags & SA_SIGINFO)
+        (*previous_busfault_sigaction.sa_sigaction) (sig, info, param);
+    else if (previous_busfault_sigaction.sa_handler != SIG_DFL &&
+             previous_busfault_sigaction.sa_handler != SIG_IGN)
+        (*previous_busfault_sigaction.sa_handler) (sig);
+    else {
+        /* fault again with the default action */
+        signal(sig, SIG_DFL);
+    }
+}
+
+Bool
+busfault_init(void)
+{
+    struct sigaction act;
+
+    xorg_list_init(&busfaults);
+
+    memset(&act, 0, sizeof(act));
+    act.sa_sigaction = busfault_sigaction;
+    act.sa_flags = SA_SIGINFO;
+    sigemptyset(&act.sa_mask);
+    if (sigaction(SIGBUS, &act, &previous_busfault_sigaction) < 0)
+        return FALSE;
+    return TRUE;
+}
@@ -256,6 +256,7 @@ static int *ListenTransFds = NULL;
 static int ListenTransCount;
 
 static void ErrorConnMax(XtransConnInfo /* trans_conn */ );
+static void ResetRefusedConns(void);
 
 static XtransConnInfo
 lookup_trans_conn(int fd)
@@ -454,6 +455,7 @@ CreateWellKnownSockets(void)
 #if !defined(WIN32)
     OsSignal(SIGPIPE, SIG_IGN);
     OsSignal(SIGHUP, AutoResetServer);
+    OsSignal(SIGUSR2, DumpClientStats);
 #endif
     OsSignal(SIGINT, GiveUp);
     OsSignal(SIGTERM, GiveUp);
@@ -473,6 +475,7 @@ ResetWellKnownSockets(void)
     int i;
 
     ResetOsBuffers();
+    ResetRefusedConns();
 
     for (i = 0; i < ListenTransCount; i++) {
         int status = _XSERVTransResetListener(ListenTransConns[i]);
@@ -484,6 +487,7 @@ ResetWellKnownSockets(void)
                  * Remove it from out list.
                  */
 
+                OsPollForget(ListenTransFds[i]);
                 FD_CLR(ListenTransFds[i], &WellKnownConnections);
                 ListenTransFds[i] = ListenTransFds[ListenTransCount - 1];
                 ListenTransConns[i] = ListenTransConns[ListenTransCount - 1];
@@ -497,6 +501,7 @@ ResetWellKnownSockets(void)
 
                 int newfd = _XSERVTransGetConnectionNumber(ListenTransConns[i]);
 
+                OsPollForget(ListenTransFds[i]);
                 FD_CLR(ListenTransFds[i], &WellKnownConnections);
                 ListenTransFds[i] = newfd;
                 FD_SET(newfd, &WellKnownConnections);
@@ -519,8 +524,11 @@ CloseWellKnownConnections(void)
 {
     int i;
 
-    for (i = 0; i < ListenTransCount; i++)
+    for (i = 0; i < ListenTransCount; i++) {
+        if (ListenTransFds)
+            OsPollForget(ListenTransFds[i]);
         _XSERVTransClose(ListenTransConns[i]);
+    }
 }
 
 static void
@@ -659,6 +667,8 @@ AuthorizationIDOfClient(ClientPtr client)
  *
  *****************************************************************/
 
+const char ClientAuthorizationPending[] = "Host name lookup in progress";
+
 const char *
 ClientAuthorized(ClientPtr client,
                  unsigned int proto_n, char *auth_proto,
@@ -688,7 +698,17 @@ ClientAuthorized(ClientPtr client,
 
     if (auth_id == (XID) ~0L) {
         if (_XSERVTransGetPeerAddr(trans_conn, &family, &fromlen, &from) != -1) {
-            if (InvalidHost((struct sockaddr *) from, fromlen, client))
+            int invalid = InvalidHost((struct sockaddr *) from, fromlen,
+                                      client);
+
+            if (invalid < 0) {
+                /* host names in the access list are being looked up,
+                 * HostLookupsDone() has the client try again */
+                free(from);
+                priv->auth_pending = TRUE;
+                return ClientAuthorizationPending;
+            }
+            if (invalid)
                 AuthAudit(client, FALSE, (struct sockaddr *) from,
                           fromlen, proto_n, auth_proto, auth_id);
             else {
@@ -745,6 +765,30 @@ ClientAuthorized(ClientPtr client,
     return ((char *) NULL);
 }
 
+/*****************
+ * HostLookupsDone
+ *    Host name lookups for the access control list have finished.
+ *    Attend the clients whose connection setup was waiting for them, so
+ *    that ClientAuthorized() runs again.
+ *****************/
+
+void
+HostLookupsDone(void)
+{
+    OsCommPtr oc;
+    int i;
+
+    for (i = 1; i < currentMaxClients; i++) {
+        if (!clients[i])
+            continue;
+        oc = (OsCommPtr) clients[i]->osPrivate;
+        if (oc && oc->auth_pending) {
+            oc->auth_pending = FALSE;
+            AttendClient(clients[i]);
+        }
+    }
+}
+
 static ClientPtr
 AllocNewConnection(XtransConnInfo trans_conn, int fd, CARD32 conn_time)
 {
@@ -768,6 +812,13 @@ AllocNewConnection(XtransConnInfo trans_conn, int fd, CARD32 conn_time)
     oc->output = (ConnectionOutputPtr) NULL;
     oc->auth_id = None;
     oc->conn_time = conn_time;
+    oc->auth_pending = FALSE;
+    oc->input_bytes = 0;
+    oc->input_reads = 0;
+    oc->output_bytes = 0;
+    oc->output_writes = 0;
+    oc->output_blocked = 0;
+    oc->blocked_since = 0;
     if (!(client = NextAvailableClient((pointer) oc))) {
         free(oc);
         return NullClient;
@@ -875,10 +926,8 @@ EstablishNewConnections(ClientPtr clientUnused, pointer closure)
         if (trans_conn->flags & TRANS_NOXAUTH)
             new_trans_conn->flags = new_trans_conn->flags | TRANS_NOXAUTH;
 
-        if (!AllocNewConnection(new_trans_conn, newconn, connect_time)) {
+        if (!AllocNewConnection(new_trans_conn, newconn, connect_time))
             ErrorConnMax(new_trans_conn);
-            _XSERVTransClose(new_trans_conn);
-        }
     }
 #ifndef WIN32
 }
@@ -891,29 +940,67 @@ return TRUE;
 /************
  *   ErrorConnMax
  *     Fail a connection due to lack of client or file descriptor space
+ *
+ *     The refusal is sent in the client's byte order, so it has to wait
+ *     for the first byte from the client.  Rather than stall the server
+ *     for that, refused connections are parked on a list and finished
+ *     from a wakeup handler, giving each client BOTIMEOUT ms to talk.
  ************/
 
 #define BOTIMEOUT 200           /* in milliseconds */
+#define MAX_REFUSED_CONNS 16    /* more are closed without a word */
+
+typedef struct _RefusedConn {
+    struct _RefusedConn *next;
+    XtransConnInfo trans_conn;
+    int fd;
+    CARD32 time;                /* when it was refused */
+} RefusedConnRec, *RefusedConnPtr;
+
+static RefusedConnPtr refusedConns;     /* oldest first */
+static int numRefusedConns;
+
+static void RefusedConnsBlockHandler(pointer data, OSTimePtr pTimeout,
+                                     pointer pReadmask);
+static void RefusedConnsWakeupHandler(pointer data, int result,
+                                      pointer pReadmask);
 
 static void
 ErrorConnMax(XtransConnInfo trans_conn)
 {
     int fd = _XSERVTransGetConnectionNumber(trans_conn);
+    RefusedConnPtr rc, *prev;
+
+    if (numRefusedConns >= MAX_REFUSED_CONNS || fd < 0 || fd >= MAXSELECT ||
+        !(rc = malloc(sizeof(RefusedConnRec)))) {
+        _XSERVTransClose(trans_conn);
+        return;
+    }
+    rc->next = NULL;
+    rc->trans_conn = trans_conn;
+    rc->fd = fd;
+    rc->time = GetTimeInMillis();
+
+    if (!refusedConns)
+        RegisterBlockAndWakeupHandlers(RefusedConnsBlockHandler,
+                                       RefusedConnsWakeupHandler, NULL);
+    for (prev = &refusedConns; *prev; prev = &(*prev)->next);
+    *prev = rc;
+    numRefusedConns++;
+    AddGeneralSocket(fd);
+}
+
+/* Send the refusal if the client has told us its byte order. */
+static void
+SendConnMax(XtransConnInfo trans_conn)
+{
     xConnSetupPrefix csp;
     char pad[3] = { 0, 0, 0 };
     struct iovec iov[3];
     char order = 0;
     int whichbyte = 1;
-    struct timeval waittime;
-    fd_set mask;
 
     /* if these seems like a lot of trouble to go to, it probably is */
-    waittime.tv_sec = BOTIMEOUT / MILLI_PER_SECOND;
-    waittime.tv_usec = (BOTIMEOUT % MILLI_PER_SECOND) *
-        (1000000 / MILLI_PER_SECOND);
-    FD_ZERO(&mask);
-    FD_SET(fd, &mask);
-    (void) Select(fd + 1, &mask, NULL, NULL, &waittime);
     /* try to read the byte-order of the connection */
     (void) _XSERVTransRead(trans_conn, &order, 1);
     if (order == 'l' || order == 'B' || order == 'r' || order == 'R') {
@@ -938,6 +1025,61 @@ ErrorConnMax(XtransConnInfo trans_conn)
     }
 }
 
+static void
+CloseRefusedConn(RefusedConnPtr rc)
+{
+    RemoveGeneralSocket(rc->fd);
+    OsPollForget(rc->fd);
+    _XSERVTransClose(rc->trans_conn);
+    free(rc);
+    numRefusedConns--;
+}
+
+static void
+RefusedConnsBlockHandler(pointer data, OSTimePtr pTimeout, pointer pReadmask)
+{
+    CARD32 waited;
+
+    if (!refusedConns)
+        return;
+    waited = GetTimeInMillis() - refusedConns->time;
+    AdjustWaitForDelay(pTimeout, waited < BOTIMEOUT ? BOTIMEOUT - waited : 0);
+}
+
+static void
+RefusedConnsWakeupHandler(pointer data, int result, pointer pReadmask)
+{
+    fd_set *readmask = (fd_set *) pReadmask;
+    CARD32 now = GetTimeInMillis();
+    RefusedConnPtr rc, *prev;
+
+    for (prev = &refusedConns; (rc = *prev);) {
+        if (result > 0 && FD_ISSET(rc->fd, readmask))
+            SendConnMax(rc->trans_conn);
+        else if (now - rc->time < BOTIMEOUT) {
+            prev = &rc->next;
+            continue;
+        }
+        *prev = rc->next;
+        CloseRefusedConn(rc);
+    }
+    if (!refusedConns)
+        RemoveBlockAndWakeupHandlers(RefusedConnsBlockHandler,
+                                     RefusedConnsWakeupHandler, NULL);
+}
+
+/* The handlers are gone after a server reset, so are the connections. */
+static void
+ResetRefusedConns(void)
+{
+    RefusedConnPtr rc;
+
+    while ((rc = refusedConns)) {
+        refusedConns = rc->next;
+        CloseRefusedConn(rc);
+    }
+}
+
 /************
  *   CloseDownFileDescriptor:
  *     Remove this file descriptor and it's I/O buffers, etc.
@@ -948,6 +1090,7 @@ CloseDownFileDescriptor(OsCommPtr oc)
 {
     int connection = oc->fd;
 
+    OsPollForget(connection);
     if (oc->trans_conn) {
         _XSERVTransDisconnect(oc->trans_conn);
         _XSERVTransClose(oc->trans_conn);
@@ -1077,6 +1220,7 @@ AddEnabledDevice(int fd)
 void
 RemoveGeneralSocket(int fd)
 {
+    OsPollForget(fd);
     FD_CLR(fd, &AllSockets);
     if (GrabInProgress)
         FD_CLR(fd, &SavedAllSockets);
@@ -1316,6 +1460,7 @@ ListenOnOpenFD(int fd, int noxauth)
     XdmcpReset();
 #endif
 }
+#endif
 
 /* based on TRANS(SocketUNIXAccept) (XtransConnInfo ciptr, int *status) */
 void
@@ -1332,9 +1477,7 @@ AddClientOnOpenFD(int fd)
     connect_time = GetTimeInMillis();
 
     if (!AllocNewConnection(ciptr, fd, connect_time)) {
-        fprintf(stderr, "failed to create client for wayland server\n");
+        fprintf(stderr, "failed to create client for fd %d\n", fd);
         return;
     }
 }
-
-#endif
@@ -90,13 +90,33 @@ typedef struct _connectionInput {
     int lenLastReq;
     int size;
     unsigned int ignoreBytes;   /* bytes to ignore before the next request */
+    int shortReads;             /* consecutive reads using little of size */
 } ConnectionInput;
 
+/*
+ * Output handed to WriteToClientRef() is not copied into buf; instead a
+ * reference is queued that records how many bytes of buf precede it.
+ * FlushClient() interleaves buf and the referenced data into a single
+ * writev() and calls the release function once the data is written.
+ */
+typedef struct _connectionOutputRef {
+    struct _connectionOutputRef *next;
+    int offset;                 /* bytes of buf queued ahead of data */
+    const char *data;           /* caller-owned data not yet written */
+    int count;                  /* bytes of data not yet written */
+    int pad;                    /* padding not yet written */
+    OsReleaseProcPtr release;
+    pointer closure;
+} ConnectionOutputRef, *ConnectionOutputRefPtr;
+
 typedef struct _connectionOutput {
     struct _connectionOutput *next;
     unsigned char *buf;
     int size;
     int count;
+    ConnectionOutputRefPtr refs;        /* referenced output, in order */
+    ConnectionOutputRefPtr lastRef;
+    long refBytes;              /* bytes (with padding) queued in refs */
 } ConnectionOutput;
 
 static ConnectionInputPtr AllocateInputBuffer(void);
@@ -130,6 +150,18 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 #define BUFSIZE 4096
 #define BUFWATERMARK 8192
 
+/* largest input buffer grown for a client streaming requests */
+#define INPUT_BUFSIZE_MAX (BUFSIZE << 5)
+/* short reads in a row before a grown input buffer shrinks again */
+#define INPUT_SHORT_READS 8
+
+/* smaller writes are cheaper to copy than to reference */
+#define OUTPUT_REF_MIN (BUFSIZE / 4)
+/* iovecs handed to a single writev() */
+#define OUTPUT_IOV_MAX 64
+
+static char padBuffer[3];
+
 /*
  *   A lot of the code in this file manipulates a ConnectionInputPtr:
  *
@@ -206,6 +238,95 @@ YieldControlDeath(void)
     timesThisConnection = 0;
 }
 
+/*
+ *  Check to see if client has at least one whole request in the
+ *  buffer beyond the request we're returning to the caller.
+ *  If there is only a partial request, treat like buffer
+ *  is empty so that select() will be called again and other clients
+ *  can get into the queue.
+ */
+static void
+CheckBufferedRequest(ClientPtr client, OsCommPtr oc, char *next,
+                     unsigned int gotnow)
+{
+    xReq *request = (xReq *) next;
+    unsigned int needed;
+    Bool whole = FALSE;
+
+    if (gotnow >= sizeof(xReq)) {
+        needed = get_req_len(request, client) << 2;
+        if (needed)
+            whole = gotnow >= needed;
+        else if (client->big_requests)
+            whole = gotnow >= sizeof(xBigReq) &&
+                gotnow >= (get_big_req_len(request, client) << 2);
+    }
+    if (whole)
+        FD_SET(oc->fd, &ClientsWithInput);
+    else {
+        if (!gotnow)
+            AvailableInput = oc;
+        if (!SmartScheduleDisable)
+            FD_CLR(oc->fd, &ClientsWithInput);
+        else
+            YieldControlNoInput(oc->fd);
+    }
+}
+
+/*
+ * Read everything the client has sent so far.  A read that fills the
+ * buffer means more is waiting in the socket, so the unread data is
+ * moved to the front or, once it is there already, the buffer is
+ * doubled up to INPUT_BUFSIZE_MAX and read again.  This way a client
+ * streaming small requests costs one read per wakeup instead of one per
+ * BUFSIZE bytes.  Returns what _XSERVTransRead would for a single read.
+ */
+static int
+ReadClientInput(OsCommPtr oc, ConnectionInputPtr oci)
+{
+    int total = 0, room, result, gotnow;
+    char *ibuf;
+
+    for (;;) {
+        room = oci->size - oci->bufcnt;
+        result = _XSERVTransRead(oc->trans_conn, oci->buffer + oci->bufcnt,
+                                 room);
+        if (result <= 0)
+            break;
+        oc->input_bytes += result;
+        oc->input_reads++;
+        oci->bufcnt += result;
+        total += result;
+        if (result < room)
+            break;
+
+        gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
+        if (oci->bufptr != oci->buffer) {
+            memmove(oci->buffer, oci->bufptr, gotnow);
+            oci->bufptr = oci->buffer;
+            oci->bufcnt = gotnow;
+        }
+        else if (oci->size < INPUT_BUFSIZE_MAX &&
+                 (ibuf = realloc(oci->buffer, oci->size << 1))) {
+            oci->bufptr = ibuf;
+            oci->buffer = ibuf;
+            oci->size <<= 1;
+        }
+        else
+            break;
+    }
+
+    if (total > 0) {
+        if (total < oci->size >> 3)
+            oci->shortReads++;
+        else
+            oci->shortReads = 0;
+        /* errors and EOF will be seen by the next read */
+        return total;
+    }
+    return result;
+}
+
 int
 ReadRequestFromClient(ClientPtr client)
 {
@@ -346,8 +467,7 @@ ReadRequestFromClient(ClientPtr client)
             YieldControlDeath();
             return -1;
         }
-        result = _XSERVTransRead(oc->trans_conn, oci->buffer + oci->bufcnt,
-                                 oci->size - oci->bufcnt);
+        result = ReadClientInput(oc, oci);
         if (result <= 0) {
             if ((result < 0) && ETEST(errno)) {
 #if defined(SVR4) && defined(__i386__) && !defined(sun)
@@ -361,10 +481,12 @@ ReadRequestFromClient(ClientPtr client)
             YieldControlDeath();
             return -1;
         }
-        oci->bufcnt += result;
-        gotnow += result;
-        /* free up some space after huge requests */
+        gotnow = oci->bufcnt + oci->buffer - oci->bufptr;
+        /* free up some space after huge requests, or once a client
+         * that was streaming has calmed down */
         if ((oci->size > BUFWATERMARK) &&
+            (oci->size > INPUT_BUFSIZE_MAX ||
+             oci->shortReads >= INPUT_SHORT_READS) &&
             (oci->bufcnt < BUFSIZE) && (needed < BUFSIZE)) {
             char *ibuf;
 
@@ -373,6 +495,7 @@ ReadRequestFromClient(ClientPtr client)
                 oci->size = BUFSIZE;
                 oci->buffer = ibuf;
                 oci->bufptr = ibuf + oci->bufcnt - gotnow;
+                oci->shortReads = 0;
             }
         }
         if (need_header && gotnow >= needed) {
@@ -425,39 +548,7 @@ ReadRequestFromClient(ClientPtr client)
 
     oci->lenLastReq = needed;
 
-    /*
-     *  Check to see if client has at least one whole request in the
-     *  buffer beyond the request we're returning to the caller.
-     *  If there is only a partial request, treat like buffer
-     *  is empty so that select() will be called again and other clients
-     *  can get into the queue.   
-     */
-
-    gotnow -= needed;
-    if (gotnow >= sizeof(xReq)) {
-        request = (xReq *) (oci->bufptr + needed);
-        if (gotnow >= (result = (get_req_len(request, client) << 2))
-            && (result ||
-                (client->big_requests &&
-                 (gotnow >= sizeof(xBigReq) &&
-                  gotnow >= (get_big_req_len(request, client) << 2))))
-            )
-            FD_SET(fd, &ClientsWithInput);
-        else {
-            if (!SmartScheduleDisable)
-                FD_CLR(fd, &ClientsWithInput);
-            else
-                YieldControlNoInput(fd);
-        }
-    }
-    else {
-        if (!gotnow)
-            AvailableInput = oc;
-        if (!SmartScheduleDisable)
-            FD_CLR(fd, &ClientsWithInput);
-        else
-            YieldControlNoInput(fd);
-    }
+    CheckBufferedRequest(client, oc, oci->bufptr + needed, gotnow - needed);
     if (SmartScheduleDisable)
         if (++timesThisConnection >= MAX_TIMES_PER)
             YieldControl();
@@ -480,6 +571,62 @@ ReadRequestFromClient(ClientPtr client)
     return needed;
 }
 
+/*****************************************************************
+ * PeekNextRequest
+ *    Return the request following the current one if it is completely
+ *    in the input buffer already and is not a Big Request, else NULL.
+ *    Its length in bytes is stored in *lenp.
+ *
+ **********************/
+
+pointer
+PeekNextRequest(ClientPtr client, int *lenp)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ConnectionInputPtr oci = oc->input;
+    xReq *request;
+    unsigned int gotnow, needed;
+
+    if (!oci || oci->ignoreBytes > 0)
+        return NULL;
+    gotnow = oci->bufcnt + oci->buffer - oci->bufptr - oci->lenLastReq;
+    if (gotnow < sizeof(xReq))
+        return NULL;
+    request = (xReq *) (oci->bufptr + oci->lenLastReq);
+    needed = get_req_len(request, client) << 2;
+    if (!needed || gotnow < needed)
+        return NULL;
+    *lenp = needed;
+    return request;
+}
+
+/*****************************************************************
+ * AppendNextRequest
+ *    Make the request returned by PeekNextRequest part of the current
+ *    one.  Its bytes past the first skip are moved to follow the data
+ *    of the current request, client->req_len grows to cover them and
+ *    the request is consumed along with the current one.
+ *
+ **********************/
+
+void
+AppendNextRequest(ClientPtr client, int skip)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ConnectionInputPtr oci = oc->input;
+    char *end = (char *) client->requestBuffer + (client->req_len << 2);
+    char *next = oci->bufptr + oci->lenLastReq;
+    int len = get_req_len((xReq *) next, client) << 2;
+
+    memmove(end, next + skip, len - skip);
+    client->req_len += bytes_to_int32(len - skip);
+    oci->lenLastReq += len;
+
+    CheckBufferedRequest(client, oc, oci->bufptr + oci->lenLastReq,
+                         oci->bufcnt + oci->buffer - oci->bufptr -
+                         oci->lenLastReq);
+}
+
 /*****************************************************************
  * InsertFakeRequest
  *    Splice a consed up (possibly partial) request in as the next request.
@@ -689,6 +836,44 @@ SetCriticalOutputPending(void)
     CriticalOutputPending = TRUE;
 }
 
+/*****************
+ * ReadFdFromClient
+ *    Returns the oldest file descriptor the client passed along with
+ *    its requests and not yet taken, or -1 if there is none.  The
+ *    caller owns the descriptor.
+ *****************/
+
+int
+ReadFdFromClient(ClientPtr client)
+{
+#if XTRANS_SEND_FDS
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+    if (oc && oc->trans_conn)
+        return _XSERVTransRecvFd(oc->trans_conn);
+#endif
+    return -1;
+}
+
+/*****************
+ * WriteFdToClient
+ *    Passes fd to the client along with the next data written to it,
+ *    closing it once sent if do_close is set.  Returns -1 if this
+ *    connection cannot carry file descriptors.
+ *****************/
+
+int
+WriteFdToClient(ClientPtr client, int fd, Bool do_close)
+{
+#if XTRANS_SEND_FDS
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+    if (oc && oc->trans_conn)
+        return _XSERVTransSendFd(oc->trans_conn, fd, do_close);
+#endif
+    return -1;
+}
+
 /*****************
  * WriteToClient
  *    Copies buf into ClientPtr.buf if it fits (with padding), else
@@ -702,17 +887,38 @@ SetCriticalOutputPending(void)
 
 int
 WriteToClient(ClientPtr who, int count, const void *__buf)
+{
+    return WriteToClientRef(who, count, __buf, NULL, NULL);
+}
+
+/*****************
+ * WriteToClientRef
+ *    Like WriteToClient, but large writes are queued by reference
+ *    instead of being copied into ClientPtr.buf.  buf must stay valid
+ *    and unmodified until release(closure) is called, which happens
+ *    exactly once: as soon as the data has been written, copied, or
+ *    discarded because the client went away.  release may be NULL, in
+ *    which case the data is always copied before returning.
+ *****************/
+
+int
+WriteToClientRef(ClientPtr who, int count, const void *__buf,
+                 OsReleaseProcPtr release, pointer closure)
 {
     OsCommPtr oc;
     ConnectionOutputPtr oco;
-    int padBytes;
+    ConnectionOutputRefPtr ref;
+    int padBytes, ret;
     const char *buf = __buf;
 
 #ifdef DEBUG_COMMUNICATION
     Bool multicount = FALSE;
 #endif
-    if (!count || !who || who == serverClient || who->clientGone)
+    if (!count || !who || who == serverClient || who->clientGone) {
+        if (release)
+            (*release) (closure);
         return 0;
+    }
     oc = who->osPrivate;
     oco = oc->output;
 #ifdef DEBUG_COMMUNICATION
@@ -767,6 +973,8 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
                 oc->trans_conn = NULL;
             }
             MarkClientException(who);
+            if (release)
+                (*release) (closure);
             return -1;
         }
         oc->output = oco;
@@ -814,6 +1022,45 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         }
     }
 #endif
+
+    ref = NULL;
+    if (release && count >= OUTPUT_REF_MIN)
+        ref = malloc(sizeof(ConnectionOutputRef));
+    if (ref) {
+        ref->next = NULL;
+        ref->offset = oco->count;
+        ref->data = buf;
+        ref->count = count;
+        ref->pad = padBytes;
+        ref->release = release;
+        ref->closure = closure;
+        if (oco->lastRef)
+            oco->lastRef->next = ref;
+        else
+            oco->refs = ref;
+        oco->lastRef = ref;
+        oco->refBytes += count + padBytes;
+
+        if (oco->count + oco->refBytes > oco->size) {
+            FD_CLR(oc->fd, &OutputPending);
+            if (!XFD_ANYSET(&OutputPending)) {
+                CriticalOutputPending = FALSE;
+                NewOutputPending = FALSE;
+            }
+
+            if (FlushCallback)
+                CallCallbacks(&FlushCallback, NULL);
+
+            if (FlushClient(who, oc, NULL, 0) < 0)
+                return -1;
+            return count;
+        }
+
+        NewOutputPending = TRUE;
+        FD_SET(oc->fd, &OutputPending);
+        return count;
+    }
+
     if (oco->count + count + padBytes > oco->size) {
         FD_CLR(oc->fd, &OutputPending);
         if (!XFD_ANYSET(&OutputPending)) {
@@ -824,7 +1071,10 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         if (FlushCallback)
             CallCallbacks(&FlushCallback, NULL);
 
-        return FlushClient(who, oc, buf, count);
+        ret = FlushClient(who, oc, buf, count);
+        if (release)
+            (*release) (closure);
+        return ret;
     }
 
     NewOutputPending = TRUE;
@@ -835,9 +1085,120 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         memset(oco->buf + oco->count, '\0', padBytes);
         oco->count += padBytes;
     }
+    if (release)
+        (*release) (closure);
     return count;
 }
 
+static void
+ReleaseOutputRefs(ConnectionOutputPtr oco)
+{
+    ConnectionOutputRefPtr ref;
+
+    while ((ref = oco->refs)) {
+        oco->refs = ref->next;
+        (*ref->release) (ref->closure);
+        free(ref);
+    }
+    oco->lastRef = NULL;
+    oco->refBytes = 0;
+}
+
+/*
+ * Append [base, base + len) to iov, clamped to *remain bytes.
+ * Returns FALSE once no more data fits.
+ */
+static Bool
+AddIOV(struct iovec *iov, int *n, int max, long *remain,
+       const char *base, long len)
+{
+    if (len <= 0)
+        return TRUE;
+    if (*n == max || *remain == 0)
+        return FALSE;
+    if (len > *remain)
+        len = *remain;
+    iov[*n].iov_base = (char *) base;
+    iov[*n].iov_len = len;
+    (*n)++;
+    *remain -= len;
+    return *remain > 0 && *n < max;
+}
+
+/*
+ * Describe the queued output of oco, in order, with at most max iovecs
+ * and *remain bytes.
+ */
+static int
+QueuedOutputIOV(ConnectionOutputPtr oco, struct iovec *iov, int max,
+                long *remain)
+{
+    ConnectionOutputRefPtr ref;
+    int n = 0, pos = 0;
+
+    for (ref = oco->refs; ref; ref = ref->next) {
+        if (!AddIOV(iov, &n, max, remain, (char *) oco->buf + pos,
+                    ref->offset - pos) ||
+            !AddIOV(iov, &n, max, remain, ref->data, ref->count) ||
+            !AddIOV(iov, &n, max, remain, padBuffer, ref->pad))
+            return n;
+        pos = ref->offset;
+    }
+    AddIOV(iov, &n, max, remain, (char *) oco->buf + pos, oco->count - pos);
+    return n;
+}
+
+/*
+ * Drop len written bytes from the head of the queued output, releasing
+ * references that are complete.  Returns the part of len that went
+ * beyond the queued output.
+ */
+static long
+ConsumeOutput(ConnectionOutputPtr oco, long len)
+{
+    ConnectionOutputRefPtr ref;
+    long done = 0;              /* bytes of buf written */
+    long n;
+
+    while (len > 0) {
+        ref = oco->refs;
+        n = (ref ? ref->offset : oco->count) - done;
+        if (n > 0) {
+            n = min(n, len);
+            done += n;
+            len -= n;
+            continue;
+        }
+        if (!ref)
+            break;
+        n = min(ref->count, len);
+        ref->data += n;
+        ref->count -= n;
+        len -= n;
+        oco->refBytes -= n;
+        n = min(ref->pad, len);
+        ref->pad -= n;
+        len -= n;
+        oco->refBytes -= n;
+        if (!ref->count && !ref->pad) {
+            oco->refs = ref->next;
+            if (!oco->refs)
+                oco->lastRef = NULL;
+            (*ref->release) (ref->closure);
+            free(ref);
+        }
+    }
+
+    if (done) {
+        oco->count -= done;
+        if (oco->count)
+            memmove((char *) oco->buf, (char *) oco->buf + done, oco->count);
+        for (ref = oco->refs; ref; ref = ref->next)
+            ref->offset -= done;
+    }
+    return len;
+}
+
  /********************
  * FlushClient()
  *    If the client isn't keeping up with us, then we try to continue
@@ -846,6 +1207,11 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
  *    a permanent error, or we can't allocate any more space, we then
  *    close the connection.
  *
+ *    Queued output, referenced output and extraBuf all go out through
+ *    one writev().  Only the unwritten part of extraBuf is ever copied,
+ *    since it belongs to the caller; referenced output stays where it
+ *    is until it has been written.
+ *
  **********************/
 
 int
@@ -854,64 +1220,46 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
     ConnectionOutputPtr oco = oc->output;
     int connection = oc->fd;
     XtransConnInfo trans_conn = oc->trans_conn;
-    struct iovec iov[3];
-    static char padBuffer[3];
+    struct iovec iov[OUTPUT_IOV_MAX];
     const char *extraBuf = __extraBuf;
-    long written;
+    long extraDone;             /* bytes of extraBuf and padding written */
     long padsize;
     long notWritten;
     long todo;
+    long remain;
+    long queued;
+    long len;
+    int i;
 
     if (!oco)
 	return 0;
-    written = 0;
+    extraDone = 0;
     padsize = padding_for_int32(extraCount);
-    notWritten = oco->count + extraCount + padsize;
+    notWritten = oco->count + oco->refBytes + extraCount + padsize;
     if (!notWritten)
         return 0;
 
     todo = notWritten;
     while (notWritten) {
-        long before = written;  /* amount of whole thing written */
-        long remain = todo;     /* amount to try this time, <= notWritten */
-        int i = 0;
-        long len;
-
-        /* You could be very general here and have "in" and "out" iovecs
-         * and write a loop without using a macro, but what the heck.  This
-         * translates to:
-         *
-         *     how much of this piece is new?
-         *     if more new then we are trying this time, clamp
-         *     if nothing new
-         *         then bump down amount already written, for next piece
-         *         else put new stuff in iovec, will need all of next piece
-         *
-         * Note that todo had better be at least 1 or else we'll end up
-         * writing 0 iovecs.
-         */
-#define InsertIOV(pointer, length) \
-	len = (length) - before; \
-	if (len > remain) \
-	    len = remain; \
-	if (len <= 0) { \
-	    before = (-len); \
-	} else { \
-	    iov[i].iov_len = len; \
-	    iov[i].iov_base = (pointer) + before;	\
-	    i++; \
-	    remain -= len; \
-	    before = 0; \
-	}
-
-        InsertIOV((char *) oco->buf, oco->count)
-            InsertIOV((char *) extraBuf, extraCount)
-            InsertIOV(padBuffer, padsize)
-
-            errno = 0;
+        /* Note that todo had better be at least 1 or else we'll end up
+         * writing 0 iovecs. */
+        remain = todo;
+        queued = oco->count + oco->refBytes;
+        i = QueuedOutputIOV(oco, iov, OUTPUT_IOV_MAX, &remain);
+        if (todo - remain == queued) {
+            if (AddIOV(iov, &i, OUTPUT_IOV_MAX, &remain,
+                       extraBuf + extraDone, extraCount - extraDone))
+                AddIOV(iov, &i, OUTPUT_IOV_MAX, &remain, padBuffer,
+                       padsize - max(extraDone - extraCount, 0));
+        }
+
+        errno = 0;
         if (trans_conn && (len = _XSERVTransWritev(trans_conn, iov, i)) >= 0) {
-            written += len;
-            notWritten -= len;
+            extraDone += ConsumeOutput(oco, len);
+            oc->output_bytes += len;
+            oc->output_writes++;
+            notWritten = oco->count + oco->refBytes +
+                extraCount + padsize - extraDone;
             todo = notWritten;
         }
         else if (ETEST(errno)
@@ -925,46 +1273,41 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             /* If we've arrived here, then the client is stuffed to the gills
                and not ready to accept more.  Make a note of it and buffer
                the rest. */
+            if (!oc->blocked_since)
+                oc->blocked_since = GetTimeInMicros();
             FD_SET(connection, &ClientsWriteBlocked);
             AnyClientsWriteBlocked = TRUE;
 
-            if (written < oco->count) {
-                if (written > 0) {
-                    oco->count -= written;
-                    memmove((char *) oco->buf,
-                            (char *) oco->buf + written, oco->count);
-                    written = 0;
-                }
-            }
-            else {
-                written -= oco->count;
-                oco->count = 0;
-            }
-
-            if (notWritten > oco->size) {
+            len = extraCount + padsize - extraDone;
+            if (oco->count + len > oco->size) {
                 unsigned char *obuf;
 
                 obuf = (unsigned char *) realloc(oco->buf,
-                                                 notWritten + BUFSIZE);
+                                                 oco->count + len + BUFSIZE);
                 if (!obuf) {
                     _XSERVTransDisconnect(oc->trans_conn);
                     _XSERVTransClose(oc->trans_conn);
                     oc->trans_conn = NULL;
                     MarkClientException(who);
                     oco->count = 0;
+                    ReleaseOutputRefs(oco);
                     return -1;
                 }
-                oco->size = notWritten + BUFSIZE;
+                oco->size = oco->count + len + BUFSIZE;
                 oco->buf = obuf;
             }
 
             /* If the amount written extended into the padBuffer, then the
-               difference "extraCount - written" may be less than 0 */
-            if ((len = extraCount - written) > 0)
+               difference "extraCount - extraDone" may be less than 0 */
+            if ((len = extraCount - extraDone) > 0) {
                 memmove((char *) oco->buf + oco->count,
-                        extraBuf + written, len);
-
-            oco->count = notWritten;    /* this will include the pad */
+                        extraBuf + extraDone, len);
+                oco->count += len;
+                extraDone += len;
+            }
+            len = extraCount + padsize - extraDone;
+            memset(oco->buf + oco->count, '\0', len);
+            oco->count += len;
             /* return only the amount explicitly requested */
             return extraCount;
         }
@@ -981,12 +1324,17 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             }
             MarkClientException(who);
             oco->count = 0;
+            ReleaseOutputRefs(oco);
             return -1;
         }
     }
 
     /* everything was flushed out */
     oco->count = 0;
+    if (oc->blocked_since) {
+        oc->output_blocked += GetTimeInMicros() - oc->blocked_since;
+        oc->blocked_since = 0;
+    }
     /* check to see if this client was write blocked */
     if (AnyClientsWriteBlocked) {
         FD_CLR(oc->fd, &ClientsWriteBlocked);
@@ -1023,6 +1371,7 @@ AllocateInputBuffer(void)
     oci->bufcnt = 0;
     oci->lenLastReq = 0;
     oci->ignoreBytes = 0;
+    oci->shortReads = 0;
     return oci;
 }
 
@@ -1041,6 +1390,9 @@ AllocateOutputBuffer(void)
     }
     oco->size = BUFSIZE;
     oco->count = 0;
+    oco->refs = NULL;
+    oco->lastRef = NULL;
+    oco->refBytes = 0;
     return oco;
 }
 
@@ -1064,9 +1416,11 @@ FreeOsBuffers(OsCommPtr oc)
             oci->bufcnt = 0;
             oci->lenLastReq = 0;
             oci->ignoreBytes = 0;
+            oci->shortReads = 0;
         }
     }
     if ((oco = oc->output)) {
+        ReleaseOutputRefs(oco);
         if (FreeOutputs) {
             free(oco->buf);
             free(oco);
@@ -1079,6 +1433,31 @@ FreeOsBuffers(OsCommPtr oc)
     }
 }
 
+/*****************
+ * GetClientIOStats
+ *    Report how much a client has sent and received, how many reads
+ *    and writes it took and how long the client kept output blocked.
+ *****************/
+
+void
+GetClientIOStats(ClientPtr client, ClientIOStatsPtr stats)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+
+    memset(stats, 0, sizeof(*stats));
+    if (!oc)
+        return;
+    stats->inputBytes = oc->input_bytes;
+    stats->inputReads = oc->input_reads;
+    if (oc->input)
+        stats->inputBufferSize = oc->input->size;
+    stats->outputBytes = oc->output_bytes;
+    stats->outputWrites = oc->output_writes;
+    stats->outputBlockedMicros = oc->output_blocked;
+    if (oc->blocked_since)
+        stats->outputBlockedMicros += GetTimeInMicros() - oc->blocked_since;
+}
+
 void
 ResetOsBuffers(void)
 {
@@ -147,7 +147,14 @@ typedef struct _osComm {
     ConnectionOutputPtr output;
     XID auth_id;                /* authorization id */
     CARD32 conn_time;           /* timestamp if not established, else 0  */
+    Bool auth_pending;          /* ignored until host lookups are done */
     struct _XtransConnInfo *trans_conn; /* transport connection object */
+    unsigned long input_bytes;  /* bytes read from the client */
+    unsigned long input_reads;  /* reads that returned data */
+    unsigned long output_bytes; /* bytes written to the client */
+    unsigned long output_writes;        /* writes that sent data */
+    CARD64 output_blocked;      /* us spent write blocked, see blocked_since */
+    CARD64 blocked_since;       /* when the client became write blocked, or 0 */
 } OsCommRec, *OsCommPtr;
 
 extern int FlushClient(ClientPtr /*who */ ,
@@ -156,6 +163,8 @@ extern int FlushClient(ClientPtr /*who */ ,
                        int      /*extraCount */
     );
 
+extern void HostLookupsDone(void);
+
 extern void FreeOsBuffers(OsCommPtr     /*oc */
     );
 
@@ -191,6 +200,11 @@ typedef long int fd_mask;
 #define ffs mffs
 extern int mffs(fd_mask);
 
+/* in ospoll.c */
+extern int OsPoll(int maxfds, fd_set *readfds, fd_set *writefds,
+                  struct timeval *wt);
+extern void OsPollForget(int fd);
+
 /* in access.c */
 extern Bool ComputeLocalClient(ClientPtr client);
 
@@ -65,6 +65,7 @@ SOFTWARE.
 #include "misc.h"
 
 #include "dixstruct.h"
+#include "busfault.h"
 
 #if !defined(SYSV) && !defined(WIN32)
 #include <sys/resource.h>
@@ -185,6 +186,10 @@ OsInit(void)
             }
         }
 #endif /* !WIN32 || __CYGWIN__ */
+#ifdef BUSFAULT
+        /* after the handlers above, which faults it cannot fix chain to */
+        busfault_init();
+#endif
 
 #ifdef HAVE_BACKTRACE
         /*
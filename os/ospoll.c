@@ -0,0 +1,351 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*****************************************************************
+ * OS Dependent fd multiplexing:
+ *
+ *  OsPoll, OsPollForget
+ *
+ * OsPoll() is a drop-in replacement for select() as used by
+ * WaitForSomething().  Where epoll is available, the interest sets
+ * passed in are mirrored into a persistent epoll instance: only fds
+ * whose bit changed since the previous call cost a system call, and
+ * the kernel hands back just the fds that are ready instead of
+ * scanning every descriptor up to MaxClients.  The returned masks
+ * contain only the ready fds, exactly as select() would leave them,
+ * so block and wakeup handlers keep working on LastSelectMask.
+ *
+ * Fds in AllSockets stay registered until OsPollForget().  Block
+ * handlers may add fds of their own to the masks, and nothing tells us
+ * when they close them; those are only registered for a single wait,
+ * so that a reused fd number is never left with a stale registration.
+ *
+ * epoll refuses fds that do not support polling, such as regular
+ * files, which select() always reports ready.  Those fds are kept out
+ * of the epoll set and checked with a non-blocking select() instead.
+ *
+ * Without epoll (or if creating the epoll instance fails) OsPoll()
+ * simply calls select().
+ *****************************************************************/
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <X11/Xos.h>
+#include <errno.h>
+#include <X11/X.h>
+#include "misc.h"
+#include "osdep.h"
+#include <X11/Xpoll.h>
+
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+
+static Bool pollInitialized;
+static int pollFd = -1;                 /* epoll instance, -1 for select */
+static fd_set pollReadMask;             /* fds registered for EPOLLIN */
+static fd_set pollWriteMask;            /* fds registered for EPOLLOUT */
+static fd_set pollSelectMask;           /* fds epoll refused, use select */
+static int pollSelectCount;
+static Bool pollSelectLogged;
+static struct epoll_event pollEvents[MAXSELECT];
+
+static void
+OsPollInit(void)
+{
+    pollInitialized = TRUE;
+    FD_ZERO(&pollReadMask);
+    FD_ZERO(&pollWriteMask);
+    FD_ZERO(&pollSelectMask);
+    pollSelectCount = 0;
+    pollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (pollFd < 0)
+        LogMessage(X_WARNING, "epoll_create1 failed (%s), using select\n",
+                   strerror(errno));
+}
+
+/*
+ * Bring the epoll registration of fd in line with the requested
+ * interest.  An fd epoll will not take is moved to pollSelectMask
+ * rather than failing every pass.  Returns EBADF for a closed fd so
+ * the caller can weed out dead connections, 0 otherwise.
+ */
+static int
+OsPollUpdate(int fd, Bool wantRead, Bool wantWrite)
+{
+    struct epoll_event ev;
+    Bool registered = FD_ISSET(fd, &pollReadMask) ||
+        FD_ISSET(fd, &pollWriteMask);
+    int op, ret;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = fd;
+    if (wantRead)
+        ev.events |= EPOLLIN;
+    if (wantWrite)
+        ev.events |= EPOLLOUT;
+
+    if (!ev.events)
+        op = EPOLL_CTL_DEL;
+    else if (registered)
+        op = EPOLL_CTL_MOD;
+    else
+        op = EPOLL_CTL_ADD;
+
+    if (FD_ISSET(fd, &pollSelectMask)) {
+        if (op == EPOLL_CTL_DEL) {
+            FD_CLR(fd, &pollSelectMask);
+            pollSelectCount--;
+        }
+        ret = 0;
+    }
+    else
+        ret = epoll_ctl(pollFd, op, fd, &ev);
+    /* The kernel drops registrations on close(), and a registration
+     * may linger when the fd was dup'ed; recover from both. */
+    if (ret < 0 && op == EPOLL_CTL_MOD && errno == ENOENT)
+        ret = epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &ev);
+    else if (ret < 0 && op == EPOLL_CTL_ADD && errno == EEXIST)
+        ret = epoll_ctl(pollFd, EPOLL_CTL_MOD, fd, &ev);
+    else if (ret < 0 && op == EPOLL_CTL_DEL)
+        ret = 0;
+    if (ret < 0 && errno == EBADF)
+        return errno;
+    if (ret < 0) {
+        /* EPERM and friends will not go away by retrying */
+        if (!pollSelectLogged) {
+            LogMessage(X_WARNING, "epoll_ctl failed for fd %d (%s), "
+                       "using select for it\n", fd, strerror(errno));
+            pollSelectLogged = TRUE;
+        }
+        if (registered)
+            (void) epoll_ctl(pollFd, EPOLL_CTL_DEL, fd, &ev);
+        FD_SET(fd, &pollSelectMask);
+        pollSelectCount++;
+    }
+
+    if (wantRead)
+        FD_SET(fd, &pollReadMask);
+    else
+        FD_CLR(fd, &pollReadMask);
+    if (wantWrite)
+        FD_SET(fd, &pollWriteMask);
+    else
+        FD_CLR(fd, &pollWriteMask);
+    return 0;
+}
+
+/*
+ * Walk the words of the requested masks and update the registration
+ * of every fd whose bit differs from what the kernel already knows.
+ */
+static int
+OsPollSync(int maxfds, fd_set *readfds, fd_set *writefds)
+{
+    int i, bit, fd, err;
+    int words = howmany(maxfds, NFDBITS);
+    fd_mask changed, wantRead, wantWrite, limit;
+
+    for (i = 0; i < words; i++) {
+        wantRead = readfds ? readfds->fds_bits[i] : 0;
+        wantWrite = writefds ? writefds->fds_bits[i] : 0;
+        if (i == words - 1 && (maxfds % NFDBITS)) {
+            limit = ((fd_mask) 1 << (maxfds % NFDBITS)) - 1;
+            wantRead &= limit;
+            wantWrite &= limit;
+        }
+        changed = (wantRead ^ pollReadMask.fds_bits[i]) |
+            (wantWrite ^ pollWriteMask.fds_bits[i]);
+        while (changed) {
+            bit = mffs(changed) - 1;
+            changed &= ~((fd_mask) 1 << bit);
+            fd = bit + i * NFDBITS;
+            err = OsPollUpdate(fd, (wantRead >> bit) & 1,
+                               (wantWrite >> bit) & 1);
+            if (err)
+                return err;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Drop the registration of every fd that is not in AllSockets.
+ */
+static void
+OsPollDropTransient(int maxfds)
+{
+    int i, bit;
+    int words = howmany(maxfds, NFDBITS);
+    fd_mask transient;
+
+    for (i = 0; i < words; i++) {
+        transient = (pollReadMask.fds_bits[i] | pollWriteMask.fds_bits[i]) &
+            ~AllSockets.fds_bits[i];
+        while (transient) {
+            bit = mffs(transient) - 1;
+            transient &= ~((fd_mask) 1 << bit);
+            OsPollForget(bit + i * NFDBITS);
+        }
+    }
+}
+#endif                          /* HAVE_EPOLL_CREATE1 */
+
+/*****************
+ * OsPoll:
+ *    Wait for any fd in readfds to become readable or any fd in
+ *    writefds to become writable, with select() semantics: on return
+ *    the masks hold only the ready fds and the number of ready bits is
+ *    returned, 0 on timeout and -1 with errno set on error.
+ *****************/
+
+int
+OsPoll(int maxfds, fd_set *readfds, fd_set *writefds, struct timeval *wt)
+{
+#ifdef HAVE_EPOLL_CREATE1
+    int timeout, nevents, nready, nselect, i, fd, err;
+    fd_set selectRead, selectWrite;
+
+    if (!pollInitialized)
+        OsPollInit();
+    if (pollFd < 0)
+        return Select(maxfds, readfds, writefds, NULL, wt);
+
+    err = OsPollSync(maxfds, readfds, writefds);
+    if (err) {
+        OsPollDropTransient(maxfds);
+        errno = err;
+        return -1;
+    }
+
+    if (wt)
+        /* round up so timers never fire early and spin the loop */
+        timeout = wt->tv_sec * MILLI_PER_SECOND +
+            (wt->tv_usec + 999) / (1000000 / MILLI_PER_SECOND);
+    else
+        timeout = -1;
+
+    /* fds epoll refused get a non-blocking select(); if any of them
+     * is ready, epoll must not block either */
+    nselect = 0;
+    if (pollSelectCount) {
+        struct timeval zero = { 0, 0 };
+
+        FD_ZERO(&selectRead);
+        FD_ZERO(&selectWrite);
+        for (i = 0; i < howmany(maxfds, NFDBITS); i++) {
+            if (readfds)
+                selectRead.fds_bits[i] =
+                    pollReadMask.fds_bits[i] & pollSelectMask.fds_bits[i];
+            if (writefds)
+                selectWrite.fds_bits[i] =
+                    pollWriteMask.fds_bits[i] & pollSelectMask.fds_bits[i];
+        }
+        nselect = Select(maxfds, &selectRead, &selectWrite, NULL, &zero);
+        if (nselect < 0) {
+            err = errno;
+            OsPollDropTransient(maxfds);
+            errno = err;
+            return -1;
+        }
+        if (nselect)
+            timeout = 0;
+    }
+
+    nevents = epoll_wait(pollFd, pollEvents, MAXSELECT, timeout);
+    if (nevents < 0) {
+        err = errno;
+        OsPollDropTransient(maxfds);
+        errno = err;
+        return -1;
+    }
+
+    if (readfds)
+        FD_ZERO(readfds);
+    if (writefds)
+        FD_ZERO(writefds);
+
+    nready = 0;
+    for (i = 0; i < nevents; i++) {
+        uint32_t events = pollEvents[i].events;
+
+        fd = pollEvents[i].data.fd;
+        /* errors and hangups are reported like select() does: the fd
+         * shows up as ready and the following read or write fails */
+        if (readfds && FD_ISSET(fd, &pollReadMask) &&
+            (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+            FD_SET(fd, readfds);
+            nready++;
+        }
+        if (writefds && FD_ISSET(fd, &pollWriteMask) &&
+            (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+            FD_SET(fd, writefds);
+            nready++;
+        }
+    }
+    if (nselect) {
+        for (i = 0; i < howmany(maxfds, NFDBITS); i++) {
+            if (readfds)
+                readfds->fds_bits[i] |= selectRead.fds_bits[i];
+            if (writefds)
+                writefds->fds_bits[i] |= selectWrite.fds_bits[i];
+        }
+        nready += nselect;
+    }
+    OsPollDropTransient(maxfds);
+    return nready;
+#else
+    return Select(maxfds, readfds, writefds, NULL, wt);
+#endif
+}
+
+/*****************
+ * OsPollForget:
+ *    Drop any registration for fd.  Must be called before a polled fd
+ *    is closed, so that a new connection reusing the same fd number is
+ *    registered afresh instead of being mistaken for the old one.
+ *****************/
+
+void
+OsPollForget(int fd)
+{
+#ifdef HAVE_EPOLL_CREATE1
+    struct epoll_event ev;
+
+    if (pollFd < 0 || fd < 0 || fd >= MAXSELECT)
+        return;
+    if (FD_ISSET(fd, &pollSelectMask)) {
+        FD_CLR(fd, &pollSelectMask);
+        pollSelectCount--;
+        FD_CLR(fd, &pollReadMask);
+        FD_CLR(fd, &pollWriteMask);
+    }
+    else if (FD_ISSET(fd, &pollReadMask) || FD_ISSET(fd, &pollWriteMask)) {
+        memset(&ev, 0, sizeof(ev));
+        (void) epoll_ctl(pollFd, EPOLL_CTL_DEL, fd, &ev);
+        FD_CLR(fd, &pollReadMask);
+        FD_CLR(fd, &pollWriteMask);
+    }
+#endif
+}
@@ -426,12 +426,32 @@ GiveUp(int sig)
     errno = olderrno;
 }
 
+/* Have the dispatch loop log client statistics on SIGUSR2 */
+
+volatile char clientStatsDumpPending;
+
+void
+DumpClientStats(int sig)
+{
+    int olderrno = errno;
+
+    clientStatsDumpPending = TRUE;
+    isItTimeToYield = TRUE;
+    errno = olderrno;
+}
+
 #if (defined WIN32 && defined __MINGW32__) || defined(__CYGWIN__)
 CARD32
 GetTimeInMillis(void)
 {
     return GetTickCount();
 }
+
+CARD64
+GetTimeInMicros(void)
+{
+    return (CARD64) GetTickCount() * 1000;
+}
 #else
 CARD32
 GetTimeInMillis(void)
@@ -462,6 +482,22 @@ GetTimeInMillis(void)
     X_GETTIMEOFDAY(&tv);
     return (tv.tv_sec * 1000) + (tv.tv_usec / 1000);
 }
+
+CARD64
+GetTimeInMicros(void)
+{
+    struct timeval tv;
+
+#ifdef MONOTONIC_CLOCK
+    struct timespec tp;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+        return (CARD64) tp.tv_sec * 1000000 + tp.tv_nsec / 1000;
+#endif
+
+    X_GETTIMEOFDAY(&tv);
+    return (CARD64) tv.tv_sec * 1000000 + tv.tv_usec;
+}
 #endif
 
 void
@@ -499,6 +535,7 @@ UseMsg(void)
     ErrorF("-c                     turns off key-click\n");
     ErrorF("c #                    key-click volume (0-100)\n");
     ErrorF("-cc int                default color visual class\n");
+    ErrorF("-coalesce              merge runs of similar drawing requests\n");
     ErrorF("-nocursor              disable the cursor\n");
     ErrorF("-core                  generate core dump on fatal error\n");
     ErrorF("-dpi int               screen resolution in dots per inch\n");
@@ -538,8 +575,10 @@ UseMsg(void)
     ErrorF("-retro                 start with classic stipple and cursor\n");
     ErrorF("-s #                   screen-saver timeout (minutes)\n");
     ErrorF("-seat string           seat to run on\n");
+    ErrorF("-shadowrate #          shadow framebuffer updates per second\n");
     ErrorF("-t #                   default pointer threshold (pixels/t)\n");
     ErrorF("-terminate             terminate at server reset\n");
+    ErrorF("-threads #             threads for large composites\n");
     ErrorF("-to #                  connection time out\n");
     ErrorF("-tst                   disable testing extensions\n");
     ErrorF("ttyxx                  server started from init on /dev/ttyxx\n");
@@ -555,6 +594,7 @@ UseMsg(void)
     ErrorF
         ("-dumbSched             Disable smart scheduling, enable old behavior\n");
     ErrorF("-schedInterval int     Set scheduler interval in msec\n");
+    ErrorF("-schedWeights          Let local clients set others' weights\n");
     ErrorF("-sigstop               Enable SIGSTOP based startup\n");
     ErrorF("+extension name        Enable extension\n");
     ErrorF("-extension name        Disable extension\n");
@@ -662,6 +702,9 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-coalesce") == 0) {
+            requestCoalescing = TRUE;
+        }
         else if (strcmp(argv[i], "-core") == 0) {
 #if !defined(WIN32) || !defined(__MINGW32__)
             struct rlimit core_limit;
@@ -830,6 +873,12 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-shadowrate") == 0) {
+            if (++i < argc)
+                shadowRefreshRate = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-t") == 0) {
             if (++i < argc)
                 defaultPointerControl.threshold = atoi(argv[i]);
@@ -839,6 +888,12 @@ ProcessCommandLine(int argc, char *argv[])
         else if (strcmp(argv[i], "-terminate") == 0) {
             dispatchExceptionAtReset = DE_TERMINATE;
         }
+        else if (strcmp(argv[i], "-threads") == 0) {
+            if (++i < argc)
+                renderThreads = atoi(argv[i]);
+            else
+                UseMsg();
+        }
         else if (strcmp(argv[i], "-to") == 0) {
             if (++i < argc)
                 TimeOutValue = ((CARD32) atoi(argv[i])) * MILLI_PER_SECOND;
@@ -915,6 +970,9 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+        else if (strcmp(argv[i], "-schedWeights") == 0) {
+            SmartScheduleOtherWeights = TRUE;
+        }
         else if (strcmp(argv[i], "-schedMax") == 0) {
             if (++i < argc) {
                 SmartScheduleMaxSlice = atoi(argv[i]);
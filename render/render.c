@@ -1422,6 +1422,8 @@ ProcRenderFillRectangles(ClientPtr client)
     things = (client->req_len << 2) - sizeof(xRenderFillRectanglesReq);
     if (things & 4)
         return BadLength;
+    things += CoalesceRequests(client, sizeof(xRenderFillRectanglesReq),
+                               sizeof(xRectangle));
     things >>= 3;
 
     CompositeRects(stuff->op,
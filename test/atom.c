@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Atom table test and benchmark: makes 100000 atoms the way a stream of
+ * InternAtom requests would, checks that they are numbered in order, that
+ * names and atoms map back and forth, that MakeAtoms() agrees with
+ * MakeAtom(), and times interning new names, looking up existing ones and
+ * GetAtomName.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/X.h>
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "os.h"
+#include "resource.h"
+#include "dix.h"
+
+#define NATOMS          100000
+
+static char *
+atom_name(int i)
+{
+    char *name;
+    int len;
+
+    /* long common prefixes, like toolkit atoms */
+    len = asprintf(&name, "_NET_WM_TEST_PROPERTY_%d", i);
+    assert(len > 0);
+    return name;
+}
+
+static void
+atom_basic(void)
+{
+    Atom a;
+
+    assert(MakeAtom("PRIMARY", 7, FALSE) == XA_PRIMARY);
+    assert(MakeAtom("WM_TRANSIENT_FOR", 16, FALSE) == XA_WM_TRANSIENT_FOR);
+    assert(strcmp(NameForAtom(XA_STRING), "STRING") == 0);
+    assert(NameForAtom(None) == NULL);
+    assert(NameForAtom(XA_LAST_PREDEFINED + 1) == NULL);
+
+    assert(MakeAtom("NOT_AN_ATOM", 11, FALSE) == None);
+    a = MakeAtom("NOT_AN_ATOM", 11, TRUE);
+    assert(a == XA_LAST_PREDEFINED + 1 && ValidAtom(a));
+    assert(MakeAtom("NOT_AN_ATOM", 11, FALSE) == a);
+    /* only len bytes count, up to the first NUL */
+    assert(MakeAtom("NOT_AN_ATOM_EITHER", 11, FALSE) == a);
+    assert(MakeAtom("NOT_AN_ATOM\0X", 13, FALSE) == a);
+    assert(MakeAtom("NOT_AN_ATO", 10, FALSE) == None);
+    assert(strcmp(NameForAtom(a), "NOT_AN_ATOM") == 0);
+    assert(MakeAtom("", 0, TRUE) == a + 1);
+    assert(strcmp(NameForAtom(a + 1), "") == 0);
+}
+
+int
+main(int argc, char **argv)
+{
+    char **names = malloc(NATOMS * sizeof(char *));
+    Atom *atoms = malloc(NATOMS * sizeof(Atom));
+    Atom first, a;
+    CARD64 start, interned, found, named;
+    int i, len;
+
+    assert(names && atoms);
+    InitAtoms();
+    atom_basic();
+
+    for (i = 0; i < NATOMS; i++)
+        names[i] = atom_name(i);
+
+    first = MakeAtom(names[0], strlen(names[0]), TRUE);
+    start = GetTimeInMicros();
+    for (i = 1; i < NATOMS; i++)
+        assert(MakeAtom(names[i], strlen(names[i]), TRUE) == first + i);
+    interned = GetTimeInMicros() - start;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < NATOMS; i++)
+        assert(MakeAtom(names[i], strlen(names[i]), FALSE) == first + i);
+    found = GetTimeInMicros() - start;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < NATOMS; i++)
+        assert(strcmp(NameForAtom(first + i), names[i]) == 0);
+    named = GetTimeInMicros() - start;
+
+    printf("%d atoms: %.1f ns per new atom, %.1f ns per existing atom, "
+           "%.1f ns per name\n", NATOMS, interned * 1000.0 / NATOMS,
+           found * 1000.0 / NATOMS, named * 1000.0 / NATOMS);
+
+    /* a batch of existing and new names */
+    for (i = 0; i < NATOMS; i += 2) {
+        free(names[i]);
+        len = asprintf(&names[i], "_NET_WM_BATCH_%d", i);
+        assert(len > 0);
+    }
+    assert(MakeAtoms((const char **) names, NATOMS, FALSE, atoms));
+    for (i = 0; i < NATOMS; i++)
+        assert(atoms[i] == (i % 2 ? first + i : None));
+    assert(MakeAtoms((const char **) names, NATOMS, TRUE, atoms));
+    for (i = 0; i < NATOMS; i++) {
+        a = MakeAtom(names[i], strlen(names[i]), FALSE);
+        assert(atoms[i] == a);
+        assert(i % 2 ? a == first + i : a >= first + NATOMS);
+        assert(strcmp(NameForAtom(a), names[i]) == 0);
+    }
+
+    /* a server reset starts over with the predefined atoms */
+    FreeAllAtoms();
+    InitAtoms();
+    assert(MakeAtom(names[1], strlen(names[1]), FALSE) == None);
+    atom_basic();
+
+    for (i = 0; i < NATOMS; i++)
+        free(names[i]);
+    free(names);
+    free(atoms);
+    return 0;
+}
@@ -28,6 +28,9 @@
 #include <stdint.h>
 #include "misc.h"
 #include "scrnintstr.h"
+#include "dixstruct.h"
+#include "clientstats.h"
+#include "slab.h"
 
 ScreenInfo screenInfo;
 
@@ -155,11 +158,112 @@ dix_update_desktop_dimensions(void)
     assert_dimensions(-w2, -h2, w2, h2);
 }
 
+static void
+dix_client_stats(void)
+{
+    ClientRec client;
+    ClientStatsPtr stats;
+    ClientOpStatsPtr op;
+
+    memset(&client, 0, sizeof(client));
+    ReserveClientStats(&client);
+    stats = client.clientStats;
+    assert(stats);
+
+    client.majorOp = X_NoOperation;
+    ClientStatsRecordRequest(&client, 0);
+    ClientStatsRecordRequest(&client, 1);
+    ClientStatsRecordRequest(&client, 3);
+    client.majorOp = 200;
+    client.minorOp = 7;
+    ClientStatsRecordRequest(&client, 1000);
+    ClientStatsRecordRequest(&client, (CARD64) 1 << 40);
+
+    assert(stats->requests == 5);
+    assert(stats->micros == 1004 + ((CARD64) 1 << 40));
+    assert(stats->histogram[0] == 1);   /* < 1us */
+    assert(stats->histogram[1] == 1);   /* [1, 2) */
+    assert(stats->histogram[2] == 1);   /* [2, 4) */
+    assert(stats->histogram[10] == 1);  /* [512, 1024) */
+    assert(stats->histogram[CLIENT_STATS_BUCKETS - 1] == 1);
+    assert(stats->ops[X_NoOperation].count == 3);
+    assert(stats->ops[X_NoOperation].micros == 4);
+    assert(stats->ops[200].count == 2);
+
+    op = GetRequestStats(X_NoOperation, 0);
+    assert(op && op->count == 3);
+    op = GetRequestStats(200, 7);
+    assert(op && op->count == 2);
+    assert(!GetRequestStats(200, 8));
+    assert(!GetRequestStats(201, 7));
+    assert(!GetRequestStats(X_NoOperation, 1));
+
+    ReleaseClientStats(&client);
+    assert(!client.clientStats);
+    /* untracked clients are ignored */
+    ClientStatsRecordRequest(&client, 1);
+}
+
+static void
+dix_slab(void)
+{
+    SlabCachePtr cache;
+    SlabStatsRec stats[16];
+    void *objects[1000];
+    void *heap;
+    int i, n;
+
+    assert(!SlabGetCache("TEST", SLAB_MAX_OBJECT + 1));
+    cache = SlabGetCache("TEST", 200);
+    assert(cache);
+    assert(SlabGetCache("TEST", 200) == cache);
+    assert(SlabGetCache("TEST", 100) != cache);
+    assert(SlabCacheSize(cache) == 200);
+
+    for (i = 0; i < ARRAY_SIZE(objects); i++) {
+        objects[i] = SlabAlloc(cache);
+        assert(objects[i]);
+        /* cache line aligned, and not overlapping the previous one */
+        assert(((uintptr_t) objects[i] & 63) == 0);
+        memset(objects[i], i, 200);
+    }
+    for (i = 0; i < ARRAY_SIZE(objects); i++)
+        assert(((unsigned char *) objects[i])[199] == (i & 0xff));
+
+    n = GetSlabStats(stats, ARRAY_SIZE(stats));
+    for (i = 0; i < n; i++)
+        if (stats[i].size == 200 && !strcmp(stats[i].name, "TEST"))
+            break;
+    assert(i < n);
+    assert(stats[i].live == ARRAY_SIZE(objects));
+    assert(stats[i].allocs == ARRAY_SIZE(objects));
+    assert(stats[i].capacity >= stats[i].live);
+
+    /* objects not from a slab are left alone */
+    heap = malloc(200);
+    assert(!SlabFree(heap));
+    free(heap);
+    assert(!SlabFree(NULL));
+
+    for (i = 0; i < ARRAY_SIZE(objects); i++)
+        assert(SlabFree(objects[i]));
+    SlabShrink();
+
+    GetSlabStats(stats, ARRAY_SIZE(stats));
+    for (i = 0; i < n; i++)
+        if (stats[i].size == 200 && !strcmp(stats[i].name, "TEST"))
+            break;
+    assert(stats[i].live == 0);
+    assert(stats[i].slabs == 0);
+}
+
 int
 main(int argc, char **argv)
 {
     dix_version_compare();
     dix_update_desktop_dimensions();
+    dix_client_stats();
+    dix_slab();
 
     return 0;
 }
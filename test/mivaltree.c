@@ -0,0 +1,274 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * miValidateTree test: builds a screen of overlapping toplevels with
+ * many children, restacks and moves them the way a window manager does
+ * and checks every clip list against one computed from scratch.  Built
+ * with -DBENCHMARK (mivaltree-bench) it also times the operations and
+ * reports how many windows each of them revalidated and how many it
+ * could skip.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc.h"
+#include "os.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "window.h"
+#include "regionstr.h"
+#include "mi.h"
+#include "mivalidate.h"
+#include "tests.h"
+
+#define SCREEN_WIDTH    3840
+#define SCREEN_HEIGHT   2160
+#define NTOPLEVELS      60
+#define NCHILDREN       100     /* per toplevel */
+#define NOPERATIONS     1000
+
+static ScreenRec screen;
+
+static Bool
+clip_position_window(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+static void
+clip_copy_window(WindowPtr pWin, DDXPointRec oldOrigin, RegionPtr oldRegion)
+{
+}
+
+/* what miHandleValidateExposures does, minus the painting */
+static void
+clip_handle_exposures(WindowPtr pWin)
+{
+    WindowPtr pChild = pWin;
+    ValidatePtr val;
+
+    while (1) {
+        if ((val = pChild->valdata)) {
+            RegionUninit(&val->after.borderExposed);
+            RegionUninit(&val->after.exposed);
+            free(val);
+            pChild->valdata = NULL;
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pWin))
+            pChild = pChild->parent;
+        if (pChild == pWin)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
+static WindowPtr
+clip_window(WindowPtr pParent, int x, int y, int w, int h, int bw)
+{
+    WindowPtr pWin = dixAllocateScreenObjectWithPrivates(NULL, WindowRec,
+                                                         PRIVATE_WINDOW);
+
+    assert(pWin);
+    pWin->drawable.type = DRAWABLE_WINDOW;
+    pWin->drawable.pScreen = &screen;
+    pWin->parent = pParent;
+    pWin->drawable.x = (pParent ? pParent->drawable.x : 0) + x + bw;
+    pWin->drawable.y = (pParent ? pParent->drawable.y : 0) + y + bw;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->borderWidth = bw;
+    pWin->borderIsPixel = TRUE;
+    pWin->mapped = TRUE;
+    pWin->viewable = TRUE;
+    pWin->visibility = VisibilityNotViewable;
+    RegionNull(&pWin->clipList);
+    RegionNull(&pWin->borderClip);
+    RegionNull(&pWin->winSize);
+    RegionNull(&pWin->borderSize);
+    if (pParent) {
+        /* on top */
+        pWin->nextSib = pParent->firstChild;
+        if (pParent->firstChild)
+            pParent->firstChild->prevSib = pWin;
+        else
+            pParent->lastChild = pWin;
+        pParent->firstChild = pWin;
+        SetWinSize(pWin);
+        SetBorderSize(pWin);
+    }
+    return pWin;
+}
+
+/* the clips of pWin and its inferiors, computed from scratch */
+static void
+clip_verify(WindowPtr pWin, RegionPtr universe)
+{
+    RegionRec inside, childUniverse;
+    WindowPtr pChild;
+
+    assert(RegionEqual(universe, &pWin->borderClip));
+    RegionNull(&inside);
+    RegionNull(&childUniverse);
+    RegionIntersect(&inside, universe, &pWin->winSize);
+    for (pChild = pWin->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->viewable)
+            continue;
+        RegionIntersect(&childUniverse, &inside, &pChild->borderSize);
+        clip_verify(pChild, &childUniverse);
+        RegionSubtract(&inside, &inside, &pChild->borderSize);
+    }
+    assert(RegionEqual(&inside, &pWin->clipList));
+    RegionUninit(&childUniverse);
+    RegionUninit(&inside);
+}
+
+/* ReflectStackChange */
+static void
+clip_restack(WindowPtr pWin, WindowPtr pSib)
+{
+    WindowPtr pFirstChange, pLayerWin;
+
+    pFirstChange = MoveWindowInStack(pWin, pSib);
+    if ((*screen.MarkOverlappedWindows) (pWin, pFirstChange, &pLayerWin)) {
+        (*screen.ValidateTree) (pLayerWin->parent, pFirstChange, VTOther);
+        (*screen.HandleExposures) (pLayerWin->parent);
+    }
+}
+
+static void
+clip_validate_all(WindowPtr pRoot)
+{
+    WindowPtr pChild = pRoot;
+
+    while (1) {
+        miMarkWindow(pChild);
+        if (pChild->firstChild) {
+            pChild = pChild->firstChild;
+            continue;
+        }
+        while (!pChild->nextSib && (pChild != pRoot))
+            pChild = pChild->parent;
+        if (pChild == pRoot)
+            break;
+        pChild = pChild->nextSib;
+    }
+    miValidateTree(pRoot, NullWindow, VTMap);
+    clip_handle_exposures(pRoot);
+}
+
+int
+main(int argc, char **argv)
+{
+    WindowPtr pRoot, pTop, toplevels[NTOPLEVELS];
+    BoxRec box = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    int i, j, op, x, y;
+#ifdef BENCHMARK
+    CARD64 start, time[2] = { 0, 0 };
+    long validated[2] = { 0, 0 }, skipped[2] = { 0, 0 };
+    int nvalidated, nskipped;
+#endif
+
+    assert(InitWindowIndex());
+
+    screen.MarkWindow = miMarkWindow;
+    screen.MarkOverlappedWindows = miMarkOverlappedWindows;
+    screen.ValidateTree = miValidateTree;
+    screen.HandleExposures = clip_handle_exposures;
+    screen.PositionWindow = clip_position_window;
+    screen.CopyWindow = clip_copy_window;
+
+    pRoot = clip_window(NULL, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+    RegionReset(&pRoot->winSize, &box);
+    RegionReset(&pRoot->borderSize, &box);
+    RegionReset(&pRoot->borderClip, &box);
+    RegionReset(&pRoot->clipList, &box);
+    pRoot->visibility = VisibilityUnobscured;
+
+    for (i = 0; i < NTOPLEVELS; i++) {
+        pTop = clip_window(pRoot, test_random(SCREEN_WIDTH - 400),
+                           test_random(SCREEN_HEIGHT - 300),
+                           300 + test_random(1200), 200 + test_random(800),
+                           test_random(3));
+        toplevels[i] = pTop;
+        for (j = 0; j < NCHILDREN; j++)
+            clip_window(pTop, test_random(pTop->drawable.width),
+                        test_random(pTop->drawable.height),
+                        8 + test_random(64), 8 + test_random(32),
+                        test_random(2));
+    }
+    clip_validate_all(pRoot);
+    clip_verify(pRoot, &pRoot->borderClip);
+
+    /* raise and lower toplevels (op 0), and drag them around (op 1) */
+    for (i = 0; i < NOPERATIONS; i++) {
+        pTop = toplevels[test_random(NTOPLEVELS)];
+        op = i & 1;
+#ifdef BENCHMARK
+        start = GetTimeInMicros();
+#endif
+        if (op == 0) {
+            if (test_random(4))
+                clip_restack(pTop, pRoot->firstChild);
+            else
+                clip_restack(pTop, NullWindow);
+        }
+        else {
+            x = pTop->origin.x - wBorderWidth(pTop) + test_random(9) - 4;
+            y = pTop->origin.y - wBorderWidth(pTop) + test_random(9) - 4;
+            miMoveWindow(pTop, x, y, pTop->nextSib, VTMove);
+        }
+#ifdef BENCHMARK
+        time[op] += GetTimeInMicros() - start;
+        miValidateTreeCounts(&nvalidated, &nskipped);
+        validated[op] += nvalidated;
+        skipped[op] += nskipped;
+#endif
+        if (i < 100 || i % 50 == 0)
+            clip_verify(pRoot, &pRoot->borderClip);
+    }
+    clip_verify(pRoot, &pRoot->borderClip);
+
+#ifdef BENCHMARK
+    for (op = 0; op < 2; op++)
+        printf("%s: %.1f us, %.1f windows revalidated, %.1f skipped "
+               "per operation\n", op ? "move" : "restack",
+               time[op] * 2.0 / NOPERATIONS,
+               validated[op] * 2.0 / NOPERATIONS,
+               skipped[op] * 2.0 / NOPERATIONS);
+#endif
+    return 0;
+}
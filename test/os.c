@@ -26,7 +26,12 @@
 #endif
 
 #include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
 #include "os.h"
+#include "osdep.h"
 
 static int last_signal = 0;
 static int expect_signal = 0;
@@ -157,10 +162,131 @@ static void block_sigio_test_nested(void)
 #endif
 }
 
+static void
+poll_test(void)
+{
+    int pairs[MAXSELECT / 2][2];
+    int npairs = (MAXSELECT - 64) / 2;
+    struct timeval notime = { 0, 0 };
+    struct rlimit lim;
+    fd_set readable, writable;
+    int maxfd = 0;
+    int i, n, file;
+    char c = 0;
+
+    /* as many connections as a select() mask can describe */
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < MAXSELECT) {
+        lim.rlim_cur = lim.rlim_max < MAXSELECT ? lim.rlim_max : MAXSELECT;
+        setrlimit(RLIMIT_NOFILE, &lim);
+        getrlimit(RLIMIT_NOFILE, &lim);
+        if (lim.rlim_cur < MAXSELECT)
+            npairs = (lim.rlim_cur - 64) / 2;
+    }
+
+    /* like client connections, these stay registered */
+    for (i = 0; i < npairs; i++) {
+        assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i]) == 0);
+        assert(pairs[i][0] < MAXSELECT && pairs[i][1] < MAXSELECT);
+        FD_SET(pairs[i][0], &AllSockets);
+        if (pairs[i][0] >= maxfd)
+            maxfd = pairs[i][0] + 1;
+    }
+
+    /* nothing readable yet */
+    FD_ZERO(&readable);
+    for (i = 0; i < npairs; i++)
+        FD_SET(pairs[i][0], &readable);
+    assert(OsPoll(maxfd, &readable, NULL, &notime) == 0);
+
+    /* only the connections written to are reported */
+    for (i = 0; i < npairs; i += 7)
+        assert(write(pairs[i][1], &c, 1) == 1);
+    FD_ZERO(&readable);
+    for (i = 0; i < npairs; i++)
+        FD_SET(pairs[i][0], &readable);
+    n = OsPoll(maxfd, &readable, NULL, &notime);
+    assert(n == (npairs + 6) / 7);
+    for (i = 0; i < npairs; i++)
+        assert(! !FD_ISSET(pairs[i][0], &readable) == (i % 7 == 0));
+
+    /* fds dropped from the interest set are not reported */
+    FD_ZERO(&readable);
+    for (i = 1; i < npairs; i++)
+        FD_SET(pairs[i][0], &readable);
+    n = OsPoll(maxfd, &readable, NULL, &notime);
+    assert(n == (npairs + 6) / 7 - 1);
+    assert(!FD_ISSET(pairs[0][0], &readable));
+
+    /* write interest */
+    FD_ZERO(&readable);
+    FD_ZERO(&writable);
+    FD_SET(pairs[1][0], &writable);
+    assert(OsPoll(maxfd, &readable, &writable, &notime) == 1);
+    assert(FD_ISSET(pairs[1][0], &writable));
+
+    /* a forgotten fd whose number is reused is registered again */
+    for (i = 0; i < npairs; i += 7)
+        assert(read(pairs[i][0], &c, 1) == 1);
+    OsPollForget(pairs[2][0]);
+    close(pairs[2][0]);
+    close(pairs[2][1]);
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[2]) == 0);
+    FD_SET(pairs[2][0], &AllSockets);
+    assert(write(pairs[2][1], &c, 1) == 1);
+    FD_ZERO(&readable);
+    for (i = 0; i < npairs; i++)
+        FD_SET(pairs[i][0], &readable);
+    assert(OsPoll(maxfd, &readable, NULL, &notime) == 1);
+    assert(FD_ISSET(pairs[2][0], &readable));
+
+    /* fds epoll refuses are always ready, like with select(), and
+     * don't turn every later pass into an error */
+    assert(read(pairs[2][0], &c, 1) == 1);
+    file = open("/dev/null", O_RDONLY);
+    assert(file >= 0 && file < MAXSELECT);
+    for (n = 0; n < 2; n++) {
+        FD_ZERO(&readable);
+        FD_SET(file, &readable);
+        FD_SET(pairs[3][0], &readable);
+        assert(OsPoll(maxfd > file ? maxfd : file + 1,
+                      &readable, NULL, &notime) == 1);
+        assert(FD_ISSET(file, &readable));
+        assert(!FD_ISSET(pairs[3][0], &readable));
+    }
+    OsPollForget(file);
+    close(file);
+
+    /* an fd a block handler adds on its own may be closed and its
+     * number reused without OsPollForget */
+    FD_CLR(pairs[4][0], &AllSockets);
+    OsPollForget(pairs[4][0]);
+    FD_ZERO(&readable);
+    FD_SET(pairs[4][0], &readable);
+    assert(OsPoll(maxfd, &readable, NULL, &notime) == 0);
+    file = pairs[4][0];
+    close(pairs[4][0]);
+    close(pairs[4][1]);
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[4]) == 0);
+    assert(pairs[4][0] == file);
+    assert(write(pairs[4][1], &c, 1) == 1);
+    FD_ZERO(&readable);
+    FD_SET(pairs[4][0], &readable);
+    assert(OsPoll(maxfd, &readable, NULL, &notime) == 1);
+    assert(FD_ISSET(pairs[4][0], &readable));
+
+    for (i = 0; i < npairs; i++) {
+        FD_CLR(pairs[i][0], &AllSockets);
+        OsPollForget(pairs[i][0]);
+        close(pairs[i][0]);
+        close(pairs[i][1]);
+    }
+}
+
 int
 main(int argc, char **argv)
 {
     block_sigio_test();
     block_sigio_test_nested();
+    poll_test();
     return 0;
 }
@@ -0,0 +1,286 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Property lookup test: puts 1000 properties on a window and checks
+ * that lookups, replacements and deletions behave as they do on the
+ * plain property list and that the list keeps the order ListProperties
+ * reports.  Also builds a large property in small appends, as INCR
+ * selection transfers do.  Built with -DBENCHMARK (property-bench) it
+ * times the lookup GetProperty does against a list walk, and the
+ * appends on a bigger property.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "os.h"
+#include "privates.h"
+#include "windowstr.h"
+#include "propertyst.h"
+#include "dixstruct.h"
+#include "tests.h"
+
+#define NPROPS          1000
+#define NLOOKUPS        1000000
+#define FIRST_ATOM      1000
+#define APPEND_CHUNK    4096
+#ifdef BENCHMARK
+#define APPEND_TOTAL    (16 << 20)
+#else
+#define APPEND_TOTAL    (1 << 20)
+#endif
+
+/* the list walk dixLookupProperty did before it had an index */
+static PropertyPtr
+prop_reference(WindowPtr pWin, Atom name)
+{
+    PropertyPtr pProp;
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+        if (pProp->propertyName == name)
+            break;
+    return pProp;
+}
+
+static void
+prop_set(ClientPtr client, WindowPtr pWin, Atom name, CARD32 value)
+{
+    assert(dixChangeWindowProperty(client, pWin, name, XA_INTEGER, 32,
+                                   PropModeReplace, 1, &value,
+                                   FALSE) == Success);
+}
+
+/*
+ * Check every atom against the expected values, 0 meaning unset, and
+ * that the list holds the set properties newest first.
+ */
+static void
+prop_check(ClientPtr client, WindowPtr pWin, CARD32 *values, int *order,
+           int norder)
+{
+    PropertyPtr pProp;
+    int i, rc;
+
+    for (i = 0; i < NPROPS; i++) {
+        rc = dixLookupProperty(&pProp, pWin, FIRST_ATOM + i, client,
+                               DixReadAccess);
+        assert(pProp == prop_reference(pWin, FIRST_ATOM + i));
+        if (values[i]) {
+            assert(rc == Success);
+            assert(pProp->propertyName == FIRST_ATOM + i);
+            assert(*(CARD32 *) pProp->data == values[i]);
+        }
+        else
+            assert(rc == BadMatch && !pProp);
+    }
+
+    pProp = wUserProps(pWin);
+    for (i = norder - 1; i >= 0; i--) {
+        assert(pProp && pProp->propertyName == FIRST_ATOM + order[i]);
+        pProp = pProp->next;
+    }
+    assert(!pProp);
+}
+
+/* Forget atom i in the creation order, if it is there */
+static int
+prop_forget(int *order, int norder, int i)
+{
+    int j;
+
+    for (j = 0; j < norder; j++)
+        if (order[j] == i) {
+            memmove(&order[j], &order[j + 1],
+                    (norder - j - 1) * sizeof(int));
+            return norder - 1;
+        }
+    return norder;
+}
+
+#ifdef BENCHMARK
+static void
+prop_benchmark(ClientPtr client, WindowPtr pWin)
+{
+    CARD64 start, indexed, walked;
+    PropertyPtr pProp = NULL;
+    int i;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < NLOOKUPS; i++)
+        dixLookupProperty(&pProp, pWin, FIRST_ATOM + test_random(NPROPS),
+                          client, DixReadAccess);
+    indexed = GetTimeInMicros() - start;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < NLOOKUPS; i++)
+        pProp = prop_reference(pWin, FIRST_ATOM + test_random(NPROPS));
+    walked = GetTimeInMicros() - start;
+    assert(pProp);
+
+    printf("%d properties: %.1f ns per lookup, %.1f ns per list walk\n",
+           NPROPS, indexed * 1000.0 / NLOOKUPS, walked * 1000.0 / NLOOKUPS);
+}
+#endif
+
+static void
+prop_append(ClientPtr client, WindowPtr pWin, Atom name)
+{
+    unsigned char chunk[APPEND_CHUNK];
+    unsigned char *data;
+    PropertyPtr pProp;
+    int i, j;
+#ifdef BENCHMARK
+    CARD64 start = GetTimeInMicros(), elapsed;
+#endif
+
+    for (i = 0; i < APPEND_TOTAL / APPEND_CHUNK; i++) {
+        memset(chunk, i & 0xff, sizeof(chunk));
+        assert(dixChangeWindowProperty(client, pWin, name, XA_STRING, 8,
+                                       i ? PropModeAppend : PropModeReplace,
+                                       sizeof(chunk), chunk,
+                                       FALSE) == Success);
+    }
+#ifdef BENCHMARK
+    elapsed = GetTimeInMicros() - start;
+#endif
+
+    assert(dixLookupProperty(&pProp, pWin, name, client,
+                             DixReadAccess) == Success);
+    assert(pProp->size == APPEND_TOTAL && pProp->format == 8);
+    data = pProp->data;
+    for (i = 0; i < APPEND_TOTAL / APPEND_CHUNK; i++)
+        for (j = 0; j < APPEND_CHUNK; j++)
+            assert(data[i * APPEND_CHUNK + j] == (i & 0xff));
+
+    /* prepending and replacing still work on a grown property */
+    chunk[0] = 0xaa;
+    assert(dixChangeWindowProperty(client, pWin, name, XA_STRING, 8,
+                                   PropModePrepend, 1, chunk,
+                                   FALSE) == Success);
+    assert(dixLookupProperty(&pProp, pWin, name, client,
+                             DixReadAccess) == Success);
+    data = pProp->data;
+    assert(pProp->size == APPEND_TOTAL + 1 && data[0] == 0xaa &&
+           data[1] == 0 && data[APPEND_TOTAL] == ((i - 1) & 0xff));
+    prop_set(client, pWin, name, 42);
+    assert(dixLookupProperty(&pProp, pWin, name, client,
+                             DixReadAccess) == Success);
+    assert(pProp->size == 1 && *(CARD32 *) pProp->data == 42);
+
+#ifdef BENCHMARK
+    printf("%d bytes appended in %d byte chunks: %.1f ms\n", APPEND_TOTAL,
+           APPEND_CHUNK, elapsed / 1000.0);
+#endif
+}
+
+int
+main(int argc, char **argv)
+{
+    ClientRec client = { 0 };
+    WindowOptRec rootOptional = { 0 };
+    WindowPtr pRoot, pWin;
+    CARD32 values[NPROPS] = { 0 };
+    int order[NPROPS];
+    int i, j, norder = 0;
+
+    assert(InitPropertyIndex());
+
+    pRoot = dixAllocateScreenObjectWithPrivates(NULL, WindowRec,
+                                                PRIVATE_WINDOW);
+    pWin = dixAllocateScreenObjectWithPrivates(NULL, WindowRec,
+                                               PRIVATE_WINDOW);
+    assert(pRoot && pWin);
+    pRoot->optional = &rootOptional;
+    pRoot->cursorIsNone = TRUE;
+    pWin->parent = pRoot;
+    pWin->cursorIsNone = TRUE;
+    client.index = 1;
+
+    /* a window with a handful of properties, then with many */
+    for (i = 0; i < NPROPS; i++) {
+        j = (i * 7) % NPROPS;
+        values[j] = i + 1;
+        order[norder++] = j;
+        prop_set(&client, pWin, FIRST_ATOM + j, values[j]);
+        if (i < 40 || i % 100 == 0)
+            prop_check(&client, pWin, values, order, norder);
+    }
+    prop_check(&client, pWin, values, order, norder);
+#ifdef BENCHMARK
+    prop_benchmark(&client, pWin);
+#endif
+
+    /* replacing a value keeps the property where it is */
+    for (i = 0; i < 200; i++) {
+        j = test_random(NPROPS);
+        values[j] = 5000 + i;
+        prop_set(&client, pWin, FIRST_ATOM + j, values[j]);
+    }
+    prop_check(&client, pWin, values, order, norder);
+
+    /* delete and add back at random, including the head and the tail */
+    for (i = 0; i < 5000; i++) {
+        if (i % 3 == 0)
+            j = order[norder - 1];
+        else if (i % 5 == 0)
+            j = order[0];
+        else
+            j = test_random(NPROPS);
+        if (values[j]) {
+            assert(DeleteProperty(&client, pWin, FIRST_ATOM + j) == Success);
+            values[j] = 0;
+            norder = prop_forget(order, norder, j);
+        }
+        else {
+            values[j] = 10000 + i;
+            order[norder++] = j;
+            prop_set(&client, pWin, FIRST_ATOM + j, values[j]);
+        }
+        if (i % 250 == 0)
+            prop_check(&client, pWin, values, order, norder);
+    }
+    prop_check(&client, pWin, values, order, norder);
+
+    prop_append(&client, pWin, FIRST_ATOM + NPROPS);
+    assert(DeleteProperty(&client, pWin, FIRST_ATOM + NPROPS) == Success);
+
+    /* delete everything; the window no longer needs its optional part */
+    for (i = 0; i < NPROPS; i++) {
+        assert(DeleteProperty(&client, pWin, FIRST_ATOM + i) == Success);
+        values[i] = 0;
+        norder = prop_forget(order, norder, i);
+    }
+    prop_check(&client, pWin, values, order, norder);
+    assert(!pWin->optional);
+
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Region test: builds regions from unsorted rectangle lists shaped like
+ * window stacks, damage and shaped windows, and checks that
+ * RegionFromRects gives exactly the region pixman computes by adding
+ * the rectangles one at a time.  Built with -DBENCHMARK (region-bench)
+ * it also times RegionFromRects on each of them.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include "misc.h"
+#include "os.h"
+#include "dix.h"
+#include "gc.h"
+#include "regionstr.h"
+#include "tests.h"
+
+#define MAX_RECTS       8192
+#define BENCH_MICROS    200000
+
+/* a stack of overlapping windows on a 1920x1080 screen */
+static int
+workload_windows(xRectangle *rects)
+{
+    int i;
+
+    for (i = 0; i < 64; i++) {
+        rects[i].x = test_random(1920) - 100;
+        rects[i].y = test_random(1080) - 100;
+        rects[i].width = 200 + test_random(600);
+        rects[i].height = 150 + test_random(450);
+    }
+    return i;
+}
+
+/* damage from text drawing: glyph cells on lines, some of them touching */
+static int
+workload_damage(xRectangle *rects)
+{
+    int i;
+
+    for (i = 0; i < 4000; i++) {
+        rects[i].x = (test_random(160) * 7) + test_random(2);
+        rects[i].y = test_random(80) * 13;
+        rects[i].width = 7 + test_random(4);
+        rects[i].height = 13;
+    }
+    return i;
+}
+
+/* a shaped window: a round mask as one rectangle per scanline */
+static int
+workload_shape(xRectangle *rects)
+{
+    int i, r = 400, dx;
+
+    for (i = 0; i < 2 * r; i++) {
+        for (dx = r; (dx - 1) * (dx - 1) + (i - r) * (i - r) > r * r; dx--);
+        rects[i].x = 500 + r - dx;
+        rects[i].y = 100 + i;
+        rects[i].width = 2 * dx;
+        rects[i].height = 1;
+    }
+    /* the same rows again as columns of stripes, to give every band
+     * several boxes to coalesce */
+    for (; i < 4 * r; i++) {
+        rects[i].x = 50 + ((i - 2 * r) % 16) * 24;
+        rects[i].y = 100 + (i - 2 * r) / 16;
+        rects[i].width = 16;
+        rects[i].height = 1;
+    }
+    return i;
+}
+
+static void
+region_check(xRectangle *rects, int nrects)
+{
+    RegionRec ref, box;
+    RegionPtr reg, banded;
+    BoxRec b;
+    BoxPtr boxes;
+    xRectangle *out;
+    int i, n;
+
+    RegionNull(&ref);
+    for (i = 0; i < nrects; i++) {
+        b.x1 = rects[i].x;
+        b.y1 = rects[i].y;
+        b.x2 = rects[i].x + rects[i].width;
+        b.y2 = rects[i].y + rects[i].height;
+        RegionInit(&box, &b, 1);
+        assert(RegionUnion(&ref, &ref, &box));
+        RegionUninit(&box);
+    }
+
+    reg = RegionFromRects(nrects, rects, CT_UNSORTED);
+    assert(RegionEqual(reg, &ref));
+
+    /* the banded result read back in goes through RegionSetExtents */
+    n = RegionNumRects(&ref);
+    boxes = RegionRects(&ref);
+    out = calloc(n, sizeof(xRectangle));
+    assert(out);
+    for (i = 0; i < n; i++) {
+        out[i].x = boxes[i].x1;
+        out[i].y = boxes[i].y1;
+        out[i].width = boxes[i].x2 - boxes[i].x1;
+        out[i].height = boxes[i].y2 - boxes[i].y1;
+    }
+    banded = RegionFromRects(n, out, CT_YXBANDED);
+    assert(RegionEqual(banded, &ref));
+    assert(banded->extents.x1 == ref.extents.x1 &&
+           banded->extents.y1 == ref.extents.y1 &&
+           banded->extents.x2 == ref.extents.x2 &&
+           banded->extents.y2 == ref.extents.y2);
+
+    free(out);
+    RegionDestroy(banded);
+    RegionDestroy(reg);
+    RegionUninit(&ref);
+}
+
+#ifdef BENCHMARK
+static void
+region_benchmark(const char *name, xRectangle *rects, int nrects)
+{
+    CARD64 start, micros;
+    RegionPtr reg;
+    int n = 0, nboxes;
+
+    reg = RegionFromRects(nrects, rects, CT_UNSORTED);
+    nboxes = RegionNumRects(reg);
+    RegionDestroy(reg);
+
+    start = GetTimeInMicros();
+    do {
+        reg = RegionFromRects(nrects, rects, CT_UNSORTED);
+        RegionDestroy(reg);
+        n++;
+    } while ((micros = GetTimeInMicros() - start) < BENCH_MICROS);
+
+    printf("%-8s %5d rects -> %5d boxes: %.1f us per region\n",
+           name, nrects, nboxes, (double) micros / n);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        int (*fill) (xRectangle *rects);
+    } workloads[] = {
+        {"windows", workload_windows},
+        {"damage", workload_damage},
+        {"shape", workload_shape},
+    };
+    xRectangle *rects = calloc(MAX_RECTS, sizeof(xRectangle));
+    int i, round;
+
+    assert(rects);
+    InitRegions();
+
+    for (i = 0; i < ARRAY_SIZE(workloads); i++) {
+        /* a few different layouts for the checks */
+        for (round = 0; round < 16; round++)
+            region_check(rects, workloads[i].fill(rects));
+#ifdef BENCHMARK
+        region_benchmark(workloads[i].name, rects, workloads[i].fill(rects));
+#endif
+    }
+
+    free(rects);
+    return 0;
+}
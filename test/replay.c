@@ -0,0 +1,1158 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Protocol replay benchmark.
+ *
+ * This is a complete server built from the same libraries as Xvfb, with
+ * a single framebuffer screen in plain memory and no input devices.
+ * It does not listen for connections.  Instead it connects one client
+ * to itself over a socketpair and writes a request stream into it from
+ * its block and wakeup handlers.  The requests go through the normal
+ * ReadRequestFromClient and Dispatch path.  Replies, events and errors
+ * are read back and thrown away.  At the end of the stream one
+ * GetInputFocus round trip waits for the server to catch up.
+ *
+ * The stream is either generated (a small mix of core drawing, property
+ * and round trip requests) or read from the file given with -replay.
+ * Such a file holds the client data of the XRecordFromClient intercepts
+ * of a single client, concatenated, in the byte order of this machine.
+ * Resource IDs are moved from the recorded client's ID range to ours:
+ * the range is taken from the first request that creates a resource,
+ * and every other word of each request that falls into it is rewritten.
+ * Extension major opcodes are replayed unchanged, so the stream should
+ * be recorded from a server with the same set of extensions.
+ *
+ * With -shm the generated stream instead pushes full-screen frames
+ * through MIT-SHM on a 3840x2160 screen: ShmPutImage from a segment
+ * passed as a file descriptor (a SysV segment where the server cannot
+ * take fds), then CopyArea from a pixmap created on the same segment.
+ * Frames and megabytes per second are reported in addition.  Last, the
+ * screen is captured back into the segment while a small rectangle moves
+ * across it, once with ShmGetImage and once with the damage-aware
+ * SHM-CAPTURE GetImage; compare the two in the per-request table.
+ *
+ * When all passes are done, requests per second and the dispatch time
+ * spent on each request type (from GetRequestStats) are printed, and
+ * the server terminates.  Useful options:
+ *
+ *   replay -nolisten all [-replay file | -shm] [-loops n] [-coalesce]
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <unistd.h>
+
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include <X11/Xatom.h>
+#include <X11/extensions/renderproto.h>
+#include <X11/extensions/shm.h>
+#include <X11/extensions/shmproto.h>
+#include "shmcaptureproto.h"
+#include "scrnintstr.h"
+#include "servermd.h"
+#include "mi.h"
+#include "micmap.h"
+#include "mipointer.h"
+#include "fb.h"
+#include "picturestr.h"
+#include "extnsionst.h"
+#include "dix.h"
+#include "os.h"
+#include "opaque.h"
+#include "registry.h"
+#include "clientstats.h"
+
+#define REPLAY_WIDTH            1280
+#define REPLAY_HEIGHT           1024
+#define REPLAY_SHM_WIDTH        3840
+#define REPLAY_SHM_HEIGHT       2160
+#define REPLAY_SHM_FRAMES       120
+#define REPLAY_DEPTH            24
+#define REPLAY_BPP              32
+
+#define REPLAY_SYNTHETIC_ROUNDS 5000
+#define REPLAY_INPUT_SIZE       65536
+
+enum ReplayPhase {
+    REPLAY_SETUP,               /* waiting for the connection setup reply */
+    REPLAY_STREAM,              /* writing the request stream */
+    REPLAY_SYNC                 /* waiting for the final GetInputFocus */
+};
+
+static struct {
+    const char *file;           /* NULL for the synthetic stream */
+    int loops;
+    Bool shm;                   /* generate MIT-SHM frames instead */
+    int width, height;          /* screen size */
+
+    CARD8 *data;                /* the request stream */
+    size_t size, alloc;
+    unsigned long requests;     /* number of requests in data */
+    long idBase;                /* ID range used in data, -1 if unknown */
+
+    int fd;                     /* our end of the connection, or -1 */
+    int pass;                   /* passes completed */
+    enum ReplayPhase phase;
+    const CARD8 *out;           /* bytes still to be written */
+    size_t outLen;
+    CARD8 in[REPLAY_INPUT_SIZE];        /* bytes read, not yet parsed */
+    size_t inLen;
+    size_t skip;                /* bytes of a long reply still to skip */
+    CARD32 lastSeq;             /* sequence of the last reply or event */
+    CARD32 syncSeq;             /* sequence of the final GetInputFocus */
+
+    int shmFd;                  /* segment to pass along, or -1 */
+    Bool shmFdSent;             /* shmFd went out in this pass */
+    unsigned long frames;       /* full-screen frames in data */
+    size_t frameSize;
+
+    CARD64 started;
+    CARD64 micros;
+    unsigned long replies, events, errors;
+} replay = {
+    .loops = 1,
+    .width = REPLAY_WIDTH,
+    .height = REPLAY_HEIGHT,
+    .idBase = -1,
+    .fd = -1,
+    .shmFd = -1,
+};
+
+/* GetRequestStats() counts since server start; only the requests of
+ * the stream are summed up here, minus the connection setup. */
+static ClientOpStatsRec opStart[256][256];
+static ClientOpStatsRec opTotal[256][256];
+
+static char *framebuffer;
+
+Bool
+LegalModifier(unsigned int key, DeviceIntPtr pDev)
+{
+    return TRUE;
+}
+
+void
+ProcessInputEvents(void)
+{
+    mieqProcessInputEvents();
+}
+
+void
+DDXRingBell(int volume, int pitch, int duration)
+{
+}
+
+void
+ddxGiveUp(enum ExitCode error)
+{
+    free(framebuffer);
+    framebuffer = NULL;
+}
+
+void
+AbortDDX(enum ExitCode error)
+{
+    ddxGiveUp(error);
+}
+
+void
+OsVendorInit(void)
+{
+    /* nobody but the replay client ever connects */
+    NoListenAll = TRUE;
+}
+
+void
+OsVendorFatalError(const char *f, va_list args)
+{
+}
+
+#if defined(DDXBEFORERESET)
+void
+ddxBeforeReset(void)
+{
+}
+#endif
+
+void
+ddxUseMsg(void)
+{
+    ErrorF("-replay file           replay the requests recorded in file\n");
+    ErrorF("-loops n               replay the stream n times\n");
+    ErrorF("-shm                   replay 4K frames through MIT-SHM\n");
+}
+
+int
+ddxProcessArgument(int argc, char *argv[], int i)
+{
+    if (strcmp(argv[i], "-replay") == 0) {
+        if (i + 1 >= argc)
+            UseMsg();
+        replay.file = argv[i + 1];
+        return 2;
+    }
+    if (strcmp(argv[i], "-loops") == 0) {
+        if (i + 1 >= argc)
+            UseMsg();
+        replay.loops = atoi(argv[i + 1]);
+        if (replay.loops < 1)
+            UseMsg();
+        return 2;
+    }
+    if (strcmp(argv[i], "-shm") == 0) {
+        replay.shm = TRUE;
+        replay.width = REPLAY_SHM_WIDTH;
+        replay.height = REPLAY_SHM_HEIGHT;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Request stream.
+ */
+
+/* Size in bytes of the request at off, 0 if it does not fit. */
+static size_t
+ReplayRequestSize(size_t off, int *header)
+{
+    xReq *req = (xReq *) (replay.data + off);
+    size_t left = replay.size - off;
+    size_t size;
+
+    if (left < sz_xReq)
+        return 0;
+    size = req->length;
+    *header = 1;
+    if (!size) {
+        /* BIG-REQUESTS: the real length follows the header */
+        if (left < sz_xReq + 4)
+            return 0;
+        size = ((CARD32 *) req)[1];
+        *header = 2;
+    }
+    size <<= 2;
+    if (size < (size_t) *header * 4 || size > left)
+        return 0;
+    return size;
+}
+
+static void
+ReplayLoadFile(void)
+{
+    FILE *f;
+    long len;
+    size_t off, size;
+    int header;
+
+    f = fopen(replay.file, "rb");
+    if (!f)
+        FatalError("replay: cannot open %s: %s\n", replay.file,
+                   strerror(errno));
+    if (fseek(f, 0, SEEK_END) < 0 || (len = ftell(f)) < 0)
+        FatalError("replay: cannot read %s\n", replay.file);
+    rewind(f);
+    replay.size = len;
+    replay.data = malloc(replay.size + 4);
+    if (!replay.data)
+        FatalError("replay: out of memory\n");
+    if (fread(replay.data, 1, replay.size, f) != replay.size)
+        FatalError("replay: cannot read %s\n", replay.file);
+    fclose(f);
+
+    for (off = 0; off < replay.size; off += size) {
+        size = ReplayRequestSize(off, &header);
+        if (!size)
+            FatalError("replay: %s: bad request at offset %lu\n",
+                       replay.file, (unsigned long) off);
+        replay.requests++;
+    }
+}
+
+/*
+ * Move the resource IDs of the stream into the range of the client the
+ * server just gave us.  Request headers are left alone, everything else
+ * is a candidate, which may now and then hit a coordinate or a pixel
+ * value that happens to look like an ID.
+ */
+static void
+ReplayRebase(CARD32 base, CARD32 mask)
+{
+    size_t off, size, i;
+    int header;
+    CARD32 *words;
+
+    for (off = 0; replay.idBase < 0 && off < replay.size; off += size) {
+        xReq *req = (xReq *) (replay.data + off);
+
+        size = ReplayRequestSize(off, &header);
+        if (header != 1 || size < 8)
+            continue;
+        switch (req->reqType) {
+        case X_CreateWindow:
+        case X_CreatePixmap:
+        case X_CreateGC:
+        case X_OpenFont:
+        case X_CreateColormap:
+        case X_CreateCursor:
+        case X_CreateGlyphCursor:
+            replay.idBase = ((CARD32 *) req)[1] & ~mask;
+            break;
+        }
+    }
+    if (replay.idBase < 0 || replay.idBase == base)
+        return;
+
+    for (off = 0; off < replay.size; off += size) {
+        size = ReplayRequestSize(off, &header);
+        words = (CARD32 *) (replay.data + off);
+        for (i = header; i < size / 4; i++)
+            if ((words[i] & ~mask) == replay.idBase)
+                words[i] = base | (words[i] & mask);
+    }
+    replay.idBase = base;
+}
+
+static pointer
+ReplayAddRequest(CARD8 reqType, CARD8 data, size_t size)
+{
+    xReq *req;
+
+    if (replay.size + size > replay.alloc) {
+        while (replay.size + size > replay.alloc)
+            replay.alloc = replay.alloc ? replay.alloc * 2 : 65536;
+        replay.data = realloc(replay.data, replay.alloc);
+        if (!replay.data)
+            FatalError("replay: out of memory\n");
+    }
+    req = (xReq *) (replay.data + replay.size);
+    memset(req, 0, size);
+    req->reqType = reqType;
+    req->data = data;
+    req->length = size >> 2;
+    replay.size += size;
+    replay.requests++;
+    return req;
+}
+
+static void
+ReplayAddCreatePicture(CARD8 render, Picture pid, Drawable drawable,
+                       PictFormatPtr format, Bool repeat)
+{
+    xRenderCreatePictureReq *cp;
+
+    cp = ReplayAddRequest(render, X_RenderCreatePicture,
+                          sizeof(xRenderCreatePictureReq) + (repeat ? 4 : 0));
+    cp->pid = pid;
+    cp->drawable = drawable;
+    cp->format = format->id;
+    if (repeat) {
+        cp->mask = CPRepeat;
+        ((CARD32 *) &cp[1])[0] = RepeatNormal;
+    }
+}
+
+/*
+ * A window with a GC and a pixmap, drawn into over and over.  With
+ * RENDER, an ARGB pixmap is composited onto the window as well, in
+ * small pieces and every now and then tiled over the whole window.
+ */
+static void
+ReplayGenerate(CARD32 base, xWindowRoot *root)
+{
+    Window wid = base | 1;
+    GContext gc = base | 2;
+    Pixmap pid = base | 3;
+    Pixmap argb = base | 4;
+    Picture srcPict = base | 5;
+    Picture dstPict = base | 6;
+    Picture tilePict = base | 7;
+    ExtensionEntry *render = CheckExtension(RENDER_NAME);
+    PictFormatPtr argbFormat = NULL, winFormat = NULL;
+    xRenderCompositeReq *comp;
+    xRenderFreePictureReq *fp;
+    xCreateWindowReq *cw;
+    xCreatePixmapReq *cp;
+    xCreateGCReq *cg;
+    xChangeGCReq *chg;
+    xPolyFillRectangleReq *fill;
+    xPolySegmentReq *seg;
+    xCopyAreaReq *copy;
+    xChangePropertyReq *prop;
+    xRectangle *rects;
+    xSegment *segs;
+    int i, j;
+
+    cw = ReplayAddRequest(X_CreateWindow, CopyFromParent,
+                          sizeof(xCreateWindowReq));
+    cw->wid = wid;
+    cw->parent = root->windowId;
+    cw->width = cw->height = 512;
+    cw->class = InputOutput;
+    cw->visual = CopyFromParent;
+    ((xResourceReq *) ReplayAddRequest(X_MapWindow, 0,
+                                       sizeof(xResourceReq)))->id = wid;
+    cp = ReplayAddRequest(X_CreatePixmap, root->rootDepth,
+                          sizeof(xCreatePixmapReq));
+    cp->pid = pid;
+    cp->drawable = wid;
+    cp->width = cp->height = 64;
+    cg = ReplayAddRequest(X_CreateGC, 0, sizeof(xCreateGCReq));
+    cg->gc = gc;
+    cg->drawable = wid;
+
+    if (render) {
+        argbFormat = PictureMatchFormat(screenInfo.screens[0], 32,
+                                        PICT_a8r8g8b8);
+        winFormat = PictureMatchFormat(screenInfo.screens[0],
+                                       root->rootDepth, PICT_x8r8g8b8);
+    }
+    if (argbFormat && winFormat) {
+        cp = ReplayAddRequest(X_CreatePixmap, 32, sizeof(xCreatePixmapReq));
+        cp->pid = argb;
+        cp->drawable = wid;
+        cp->width = cp->height = 64;
+        ReplayAddCreatePicture(render->base, srcPict, argb, argbFormat,
+                               FALSE);
+        ReplayAddCreatePicture(render->base, dstPict, wid, winFormat, FALSE);
+        ReplayAddCreatePicture(render->base, tilePict, argb, argbFormat,
+                               TRUE);
+    }
+    else
+        render = NULL;
+
+    for (i = 0; i < REPLAY_SYNTHETIC_ROUNDS; i++) {
+        chg = ReplayAddRequest(X_ChangeGC, 0, sizeof(xChangeGCReq) + 4);
+        chg->gc = gc;
+        chg->mask = GCForeground;
+        ((CARD32 *) &chg[1])[0] = i * 0x010203;
+
+        fill = ReplayAddRequest(X_PolyFillRectangle, 0,
+                                sizeof(xPolyFillRectangleReq) +
+                                8 * sizeof(xRectangle));
+        fill->drawable = (i & 1) ? pid : wid;
+        fill->gc = gc;
+        rects = (xRectangle *) &fill[1];
+        for (j = 0; j < 8; j++) {
+            rects[j].x = (i * 7 + j * 61) % 448;
+            rects[j].y = (i * 13 + j * 37) % 448;
+            rects[j].width = 8 + j * 7;
+            rects[j].height = 8 + (i + j) % 48;
+        }
+
+        seg = ReplayAddRequest(X_PolySegment, 0,
+                               sizeof(xPolySegmentReq) +
+                               8 * sizeof(xSegment));
+        seg->drawable = wid;
+        seg->gc = gc;
+        segs = (xSegment *) &seg[1];
+        for (j = 0; j < 8; j++) {
+            segs[j].x1 = (i + j * 64) % 512;
+            segs[j].y1 = 0;
+            segs[j].x2 = 511 - segs[j].x1;
+            segs[j].y2 = 511;
+        }
+
+        copy = ReplayAddRequest(X_CopyArea, 0, sizeof(xCopyAreaReq));
+        copy->srcDrawable = pid;
+        copy->dstDrawable = wid;
+        copy->gc = gc;
+        copy->dstX = (i * 17) % 448;
+        copy->dstY = (i * 29) % 448;
+        copy->width = copy->height = 64;
+
+        prop = ReplayAddRequest(X_ChangeProperty, PropModeReplace,
+                                sizeof(xChangePropertyReq) + 8);
+        prop->window = wid;
+        prop->property = XA_WM_NAME;
+        prop->type = XA_STRING;
+        prop->format = 8;
+        prop->nUnits = 8;
+        snprintf((char *) &prop[1], 8, "%07d", i);
+
+        for (j = 0; render && j < 4; j++) {
+            comp = ReplayAddRequest(render->base, X_RenderComposite,
+                                    sizeof(xRenderCompositeReq));
+            comp->op = PictOpOver;
+            comp->src = srcPict;
+            comp->mask = None;
+            comp->dst = dstPict;
+            comp->xSrc = comp->ySrc = j * 16;
+            comp->xDst = (i * 11 + j * 97) % 480;
+            comp->yDst = (i * 19 + j * 53) % 480;
+            comp->width = comp->height = 16;
+        }
+
+        if (render && i % 16 == 8) {
+            comp = ReplayAddRequest(render->base, X_RenderComposite,
+                                    sizeof(xRenderCompositeReq));
+            comp->op = PictOpOver;
+            comp->src = tilePict;
+            comp->mask = None;
+            comp->dst = dstPict;
+            comp->xSrc = comp->ySrc = i % 64;
+            comp->width = comp->height = 512;
+        }
+
+        if (i % 16 == 0)
+            ((xResourceReq *) ReplayAddRequest(X_GetGeometry, 0,
+                                               sizeof(xResourceReq)))->id =
+                wid;
+    }
+
+    if (render) {
+        fp = ReplayAddRequest(render->base, X_RenderFreePicture,
+                              sizeof(xRenderFreePictureReq));
+        fp->picture = dstPict;
+        fp = ReplayAddRequest(render->base, X_RenderFreePicture,
+                              sizeof(xRenderFreePictureReq));
+        fp->picture = srcPict;
+        fp = ReplayAddRequest(render->base, X_RenderFreePicture,
+                              sizeof(xRenderFreePictureReq));
+        fp->picture = tilePict;
+        ((xResourceReq *) ReplayAddRequest(X_FreePixmap, 0,
+                                           sizeof(xResourceReq)))->id = argb;
+    }
+    ((xResourceReq *) ReplayAddRequest(X_FreeGC, 0,
+                                       sizeof(xResourceReq)))->id = gc;
+    ((xResourceReq *) ReplayAddRequest(X_FreePixmap, 0,
+                                       sizeof(xResourceReq)))->id = pid;
+    ((xResourceReq *) ReplayAddRequest(X_DestroyWindow, 0,
+                                       sizeof(xResourceReq)))->id = wid;
+    replay.idBase = base;
+}
+
+/*
+ * A segment holding one full-screen frame: a memfd handed over with
+ * ShmAttachFd where the server takes fds, else a SysV segment.
+ */
+static void
+ReplayAddShmAttach(CARD8 shm, XID shmseg)
+{
+    char *addr;
+
+#ifdef SHM_FD_PASSING
+    xShmAttachFdReq *attach;
+
+#ifdef HAVE_MEMFD_CREATE
+    replay.shmFd = memfd_create("replay", MFD_CLOEXEC);
+#else
+    char template[] = "/tmp/replay-XXXXXX";
+
+    replay.shmFd = mkstemp(template);
+    if (replay.shmFd >= 0)
+        unlink(template);
+#endif
+    if (replay.shmFd < 0 || ftruncate(replay.shmFd, replay.frameSize) < 0)
+        FatalError("replay: cannot create shm file: %s\n", strerror(errno));
+    addr = mmap(NULL, replay.frameSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                replay.shmFd, 0);
+    if (addr == MAP_FAILED)
+        FatalError("replay: cannot map shm file: %s\n", strerror(errno));
+    attach = ReplayAddRequest(shm, X_ShmAttachFd, sizeof(xShmAttachFdReq));
+    attach->shmseg = shmseg;
+    attach->readOnly = xFalse;
+#else
+    xShmAttachReq *attach;
+    int shmid;
+
+    shmid = shmget(IPC_PRIVATE, replay.frameSize, IPC_CREAT | 0600);
+    if (shmid < 0)
+        FatalError("replay: shmget failed: %s\n", strerror(errno));
+    addr = shmat(shmid, NULL, 0);
+    /* the segment stays around until both sides have detached */
+    shmctl(shmid, IPC_RMID, NULL);
+    if (addr == (char *) -1)
+        FatalError("replay: shmat failed: %s\n", strerror(errno));
+    attach = ReplayAddRequest(shm, X_ShmAttach, sizeof(xShmAttachReq));
+    attach->shmseg = shmseg;
+    attach->shmid = shmid;
+    attach->readOnly = xFalse;
+#endif
+
+    /* something other than a solid fill, so no layer can cheat */
+    memset(addr, 0x5a, replay.frameSize);
+}
+
+/*
+ * Full-screen frames pushed into a window, first with ShmPutImage and
+ * then by copying from a pixmap that lives in the segment itself.
+ */
+static void
+ReplayGenerateShm(CARD32 base, xWindowRoot *root)
+{
+    Window wid = base | 1;
+    GContext gc = base | 2;
+    Pixmap pid = base | 3;
+    XID shmseg = base | 4;
+    ExtensionEntry *shm = CheckExtension(SHMNAME);
+    ExtensionEntry *capture = CheckExtension(SHMCAPTURE_NAME);
+    int stride = PixmapBytePad(replay.width, root->rootDepth);
+    xCreateWindowReq *cw;
+    xCreateGCReq *cg;
+    xShmPutImageReq *put;
+    xShmCreatePixmapReq *cp;
+    xCopyAreaReq *copy;
+    xShmGetImageReq *get;
+    xShmCaptureGetImageReq *cget;
+    xPolyFillRectangleReq *fill;
+    xRectangle *rect;
+    int i;
+
+    if (!shm || !capture)
+        FatalError("replay: -shm needs the MIT-SHM and SHM-CAPTURE "
+                   "extensions\n");
+    replay.frameSize = (size_t) stride * replay.height;
+
+    cw = ReplayAddRequest(X_CreateWindow, CopyFromParent,
+                          sizeof(xCreateWindowReq));
+    cw->wid = wid;
+    cw->parent = root->windowId;
+    cw->width = replay.width;
+    cw->height = replay.height;
+    cw->class = InputOutput;
+    cw->visual = CopyFromParent;
+    ((xResourceReq *) ReplayAddRequest(X_MapWindow, 0,
+                                       sizeof(xResourceReq)))->id = wid;
+    cg = ReplayAddRequest(X_CreateGC, 0, sizeof(xCreateGCReq));
+    cg->gc = gc;
+    cg->drawable = wid;
+    ReplayAddShmAttach(shm->base, shmseg);
+
+    for (i = 0; i < REPLAY_SHM_FRAMES; i++) {
+        put = ReplayAddRequest(shm->base, X_ShmPutImage,
+                               sizeof(xShmPutImageReq));
+        put->drawable = wid;
+        put->gc = gc;
+        put->totalWidth = put->srcWidth = replay.width;
+        put->totalHeight = put->srcHeight = replay.height;
+        put->depth = root->rootDepth;
+        put->format = ZPixmap;
+        put->shmseg = shmseg;
+    }
+
+    cp = ReplayAddRequest(shm->base, X_ShmCreatePixmap,
+                          sizeof(xShmCreatePixmapReq));
+    cp->pid = pid;
+    cp->drawable = wid;
+    cp->width = replay.width;
+    cp->height = replay.height;
+    cp->depth = root->rootDepth;
+    cp->shmseg = shmseg;
+    for (i = 0; i < REPLAY_SHM_FRAMES; i++) {
+        copy = ReplayAddRequest(X_CopyArea, 0, sizeof(xCopyAreaReq));
+        copy->srcDrawable = pid;
+        copy->dstDrawable = wid;
+        copy->gc = gc;
+        copy->width = replay.width;
+        copy->height = replay.height;
+    }
+    replay.frames = 2 * REPLAY_SHM_FRAMES;
+
+    ((xResourceReq *) ReplayAddRequest(X_FreePixmap, 0,
+                                       sizeof(xResourceReq)))->id = pid;
+
+    for (i = 0; i < 2 * REPLAY_SHM_FRAMES; i++) {
+        fill = ReplayAddRequest(X_PolyFillRectangle, 0,
+                                sizeof(xPolyFillRectangleReq) +
+                                sizeof(xRectangle));
+        fill->drawable = wid;
+        fill->gc = gc;
+        rect = (xRectangle *) &fill[1];
+        rect->x = (i * 29) % (replay.width - 64);
+        rect->y = (i * 17) % (replay.height - 64);
+        rect->width = rect->height = 64;
+
+        if (i < REPLAY_SHM_FRAMES) {
+            get = ReplayAddRequest(shm->base, X_ShmGetImage,
+                                   sizeof(xShmGetImageReq));
+            get->drawable = root->windowId;
+            get->width = replay.width;
+            get->height = replay.height;
+            get->planeMask = ~0;
+            get->format = ZPixmap;
+            get->shmseg = shmseg;
+        }
+        else {
+            cget = ReplayAddRequest(capture->base, X_ShmCaptureGetImage,
+                                    sizeof(xShmCaptureGetImageReq));
+            cget->drawable = root->windowId;
+            cget->width = replay.width;
+            cget->height = replay.height;
+            cget->planeMask = ~0;
+            cget->format = ZPixmap;
+            cget->shmseg = shmseg;
+        }
+    }
+
+    ((xShmDetachReq *) ReplayAddRequest(shm->base, X_ShmDetach,
+                                        sizeof(xShmDetachReq)))->shmseg =
+        shmseg;
+    ((xResourceReq *) ReplayAddRequest(X_FreeGC, 0,
+                                       sizeof(xResourceReq)))->id = gc;
+    ((xResourceReq *) ReplayAddRequest(X_DestroyWindow, 0,
+                                       sizeof(xResourceReq)))->id = wid;
+    replay.idBase = base;
+}
+
+/*
+ * Client side of the connection.
+ */
+
+static void
+ReplaySnapshot(void)
+{
+    int major, minor;
+    ClientOpStatsPtr op;
+
+    for (major = 0; major < 256; major++)
+        for (minor = 0; minor < 256; minor++) {
+            op = GetRequestStats(major, minor);
+            if (op)
+                opStart[major][minor] = *op;
+            else
+                memset(&opStart[major][minor], 0, sizeof(ClientOpStatsRec));
+        }
+}
+
+static void
+ReplayAccumulate(void)
+{
+    int major, minor;
+    ClientOpStatsPtr op;
+
+    for (major = 0; major < 256; major++)
+        for (minor = 0; minor < 256; minor++) {
+            op = GetRequestStats(major, minor);
+            if (!op)
+                continue;
+            opTotal[major][minor].count +=
+                op->count - opStart[major][minor].count;
+            opTotal[major][minor].micros +=
+                op->micros - opStart[major][minor].micros;
+        }
+}
+
+static int
+CompareOpTime(const void *a, const void *b)
+{
+    const ClientOpStatsRec *oa = &opTotal[0][0] + *(const int *) a;
+    const ClientOpStatsRec *ob = &opTotal[0][0] + *(const int *) b;
+
+    return (oa->micros < ob->micros) - (oa->micros > ob->micros);
+}
+
+static void
+ReplayReport(void)
+{
+    unsigned long requests = replay.requests * replay.loops;
+    int *order, n, i;
+
+    printf("replay: %d passes of %lu requests in %llu us, "
+           "%.0f requests/s\n", replay.loops, replay.requests,
+           (unsigned long long) replay.micros,
+           replay.micros ? requests * 1e6 / replay.micros : 0.0);
+    printf("replay: %lu replies, %lu events, %lu errors\n",
+           replay.replies, replay.events, replay.errors);
+    if (replay.frames && replay.micros) {
+        double frames = (double) replay.frames * replay.loops;
+
+        printf("replay: %dx%d frames: %.1f frames/s, %.0f MB/s\n",
+               replay.width, replay.height, frames * 1e6 / replay.micros,
+               frames * replay.frameSize / replay.micros);
+    }
+
+    order = malloc(256 * 256 * sizeof(int));
+    if (!order)
+        return;
+    for (n = 0, i = 0; i < 256 * 256; i++)
+        if ((&opTotal[0][0])[i].count)
+            order[n++] = i;
+    qsort(order, n, sizeof(int), CompareOpTime);
+
+    printf("  %-40s %10s %12s %10s\n", "request", "count", "us",
+           "ns/request");
+    for (i = 0; i < n; i++) {
+        ClientOpStatsPtr op = &opTotal[0][0] + order[i];
+
+        printf("  %-40s %10lu %12llu %10llu\n",
+               LookupRequestName(order[i] >> 8, order[i] & 0xff),
+               op->count, (unsigned long long) op->micros,
+               (unsigned long long) (op->micros * 1000 / op->count));
+    }
+    free(order);
+    fflush(stdout);
+}
+
+static void
+ReplayConnect(void)
+{
+    static xConnClientPrefix prefix = {
+#if X_BYTE_ORDER == X_LITTLE_ENDIAN
+        .byteOrder = 'l',
+#else
+        .byteOrder = 'B',
+#endif
+        .majorVersion = X_PROTOCOL,
+        .minorVersion = X_PROTOCOL_REVISION,
+    };
+    int sv[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+        FatalError("replay: socketpair failed: %s\n", strerror(errno));
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    AddClientOnOpenFD(sv[1]);
+    AddGeneralSocket(sv[0]);
+
+    replay.fd = sv[0];
+    replay.phase = REPLAY_SETUP;
+    replay.out = (const CARD8 *) &prefix;
+    replay.outLen = sz_xConnClientPrefix;
+    replay.inLen = 0;
+    replay.skip = 0;
+    replay.lastSeq = 0;
+}
+
+static void
+ReplayDisconnect(void)
+{
+    RemoveGeneralSocket(replay.fd);
+    close(replay.fd);
+    replay.fd = -1;
+    if (++replay.pass == replay.loops) {
+        ReplayReport();
+        dispatchException |= DE_TERMINATE;
+    }
+}
+
+/* Parse the setup reply at the start of the input, return its size. */
+static size_t
+ReplaySetup(void)
+{
+    xConnSetupPrefix *prefix = (xConnSetupPrefix *) replay.in;
+    xConnSetup *setup = (xConnSetup *) &prefix[1];
+    xWindowRoot *root;
+    size_t size;
+
+    if (replay.inLen < sz_xConnSetupPrefix)
+        return 0;
+    size = sz_xConnSetupPrefix + (prefix->length << 2);
+    if (size > sizeof(replay.in))
+        FatalError("replay: connection setup reply too large\n");
+    if (replay.inLen < size)
+        return 0;
+    if (prefix->success != xTrue)
+        FatalError("replay: connection refused\n");
+
+    root = (xWindowRoot *) ((char *) &setup[1] +
+                            pad_to_int32(setup->nbytesVendor) +
+                            setup->numFormats * sz_xPixmapFormat);
+    if (!replay.data) {
+        if (replay.file)
+            ReplayLoadFile();
+        else if (replay.shm)
+            ReplayGenerateShm(setup->ridBase, root);
+        else
+            ReplayGenerate(setup->ridBase, root);
+    }
+    ReplayRebase(setup->ridBase, setup->ridMask);
+
+    replay.phase = REPLAY_STREAM;
+    replay.out = replay.data;
+    replay.outLen = replay.size;
+    replay.shmFdSent = FALSE;
+    ReplaySnapshot();
+    replay.started = GetTimeInMicros();
+    return size;
+}
+
+static void
+ReplayParse(void)
+{
+    size_t pos = 0, size, n;
+    xGenericReply *rep;
+    CARD32 seq;
+
+    while (replay.fd >= 0) {
+        if (replay.skip) {
+            n = min(replay.skip, replay.inLen - pos);
+            replay.skip -= n;
+            pos += n;
+            if (replay.skip)
+                break;
+            continue;
+        }
+        if (replay.phase == REPLAY_SETUP) {
+            memmove(replay.in, replay.in + pos, replay.inLen - pos);
+            replay.inLen -= pos;
+            pos = ReplaySetup();
+            if (!pos)
+                return;
+            continue;
+        }
+        if (replay.inLen - pos < sz_xGenericReply)
+            break;
+
+        rep = (xGenericReply *) (replay.in + pos);
+        size = sz_xGenericReply;
+        if (rep->type == X_Reply || rep->type == GenericEvent)
+            size += rep->length << 2;
+
+        /* extend the 16 bit sequence number, like Xlib does */
+        seq = (replay.lastSeq & ~0xffff) | rep->sequenceNumber;
+        if (seq < replay.lastSeq)
+            seq += 0x10000;
+        replay.lastSeq = seq;
+
+        if (rep->type == X_Error)
+            replay.errors++;
+        else if (rep->type != X_Reply)
+            replay.events++;
+        else if (replay.phase == REPLAY_SYNC && seq == replay.syncSeq) {
+            replay.micros += GetTimeInMicros() - replay.started;
+            ReplayAccumulate();
+            ReplayDisconnect();
+            return;
+        }
+        else
+            replay.replies++;
+
+        if (size > replay.inLen - pos) {
+            replay.skip = size - (replay.inLen - pos);
+            pos = replay.inLen;
+        }
+        else
+            pos += size;
+    }
+    memmove(replay.in, replay.in + pos, replay.inLen - pos);
+    replay.inLen -= pos;
+}
+
+static void
+ReplayRead(void)
+{
+    ssize_t n;
+
+    while (replay.fd >= 0) {
+        n = read(replay.fd, replay.in + replay.inLen,
+                 sizeof(replay.in) - replay.inLen);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (n <= 0)
+            FatalError("replay: server closed the connection\n");
+        replay.inLen += n;
+        ReplayParse();
+    }
+}
+
+/* Write the start of the stream with the shm fd attached. */
+static ssize_t
+ReplaySendFd(void)
+{
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct iovec iov = {
+        .iov_base = (void *) replay.out,
+        .iov_len = replay.outLen,
+    };
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof(control.buf),
+    };
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    ssize_t n;
+
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &replay.shmFd, sizeof(int));
+    n = sendmsg(replay.fd, &msg, 0);
+    if (n > 0)
+        replay.shmFdSent = TRUE;
+    return n;
+}
+
+static void
+ReplayWrite(void)
+{
+    static xReq sync = {
+        .reqType = X_GetInputFocus,
+        .length = sz_xReq >> 2,
+    };
+    ssize_t n;
+
+    while (replay.fd >= 0 && replay.outLen) {
+        if (replay.shmFd >= 0 && !replay.shmFdSent &&
+            replay.phase == REPLAY_STREAM)
+            n = ReplaySendFd();
+        else
+            n = write(replay.fd, replay.out, replay.outLen);
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+            return;
+        if (n < 0)
+            FatalError("replay: write failed: %s\n", strerror(errno));
+        replay.out += n;
+        replay.outLen -= n;
+        if (!replay.outLen && replay.phase == REPLAY_STREAM) {
+            replay.phase = REPLAY_SYNC;
+            replay.syncSeq = replay.requests + 1;
+            replay.out = (const CARD8 *) &sync;
+            replay.outLen = sz_xReq;
+        }
+    }
+}
+
+static void
+ReplayRun(void)
+{
+    if (dispatchException)
+        return;
+    if (replay.fd < 0)
+        ReplayConnect();
+    ReplayRead();
+    ReplayWrite();
+}
+
+static void
+ReplayBlockHandler(pointer data, OSTimePtr timeout, pointer readmask)
+{
+    ReplayRun();
+    if (dispatchException)
+        AdjustWaitForDelay(timeout, 0);
+}
+
+static void
+ReplayWakeupHandler(pointer data, int result, pointer readmask)
+{
+    ReplayRun();
+}
+
+/*
+ * Screen and input.
+ */
+
+static Bool
+ReplaySaveScreen(ScreenPtr pScreen, int on)
+{
+    return TRUE;
+}
+
+static Bool
+ReplayCursorOffScreen(ScreenPtr *ppScreen, int *x, int *y)
+{
+    return FALSE;
+}
+
+static void
+ReplayCrossScreen(ScreenPtr pScreen, Bool entering)
+{
+}
+
+static miPointerScreenFuncRec replayPointerCursorFuncs = {
+    ReplayCursorOffScreen,
+    ReplayCrossScreen,
+    miPointerWarpCursor
+};
+
+static Bool
+ReplayScreenInit(ScreenPtr pScreen, int argc, char **argv)
+{
+    int stride = PixmapBytePad(replay.width, REPLAY_DEPTH);
+
+    framebuffer = calloc(replay.height, stride);
+    if (!framebuffer)
+        return FALSE;
+
+    miSetVisualTypesAndMasks(REPLAY_DEPTH,
+                             ((1 << TrueColor) |
+                              (1 << DirectColor)),
+                             8, TrueColor, 0xff0000, 0x00ff00, 0x0000ff);
+    miSetPixmapDepths();
+
+    if (!fbScreenInit(pScreen, framebuffer, replay.width, replay.height,
+                      100, 100, stride / (REPLAY_BPP / 8), REPLAY_BPP))
+        return FALSE;
+    fbPictureInit(pScreen, 0, 0);
+
+    pScreen->SaveScreen = ReplaySaveScreen;
+    miDCInitialize(pScreen, &replayPointerCursorFuncs);
+
+    pScreen->blackPixel = 0;
+    pScreen->whitePixel = 0xffffff;
+
+    return fbCreateDefColormap(pScreen);
+}
+
+void
+InitOutput(ScreenInfo * screenInfo, int argc, char **argv)
+{
+    static const int depths[] = { 1, 4, 8, 16, 24, 32 };
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(depths); i++) {
+        screenInfo->formats[i].depth = depths[i];
+        screenInfo->formats[i].bitsPerPixel =
+            depths[i] == 1 ? 1 : depths[i] <= 8 ? 8 :
+            depths[i] <= 16 ? 16 : 32;
+        screenInfo->formats[i].scanlinePad = BITMAP_SCANLINE_PAD;
+    }
+    screenInfo->numPixmapFormats = ARRAY_SIZE(depths);
+    screenInfo->imageByteOrder = IMAGE_BYTE_ORDER;
+    screenInfo->bitmapScanlineUnit = BITMAP_SCANLINE_UNIT;
+    screenInfo->bitmapScanlinePad = BITMAP_SCANLINE_PAD;
+    screenInfo->bitmapBitOrder = BITMAP_BIT_ORDER;
+
+    if (AddScreen(ReplayScreenInit, argc, argv) == -1)
+        FatalError("Couldn't add screen\n");
+}
+
+void
+InitInput(int argc, char *argv[])
+{
+    (void) mieqInit();
+    RegisterBlockAndWakeupHandlers(ReplayBlockHandler, ReplayWakeupHandler,
+                                   NULL);
+}
+
+void
+CloseInput(void)
+{
+    mieqFini();
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Resource table test and benchmark: fills a client with many resources,
+ * times dixLookupResourceByType on them and checks that resources
+ * sharing an id are looked up and freed newest first, also while the
+ * table is being grown.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc.h"
+#include "os.h"
+#include "resource.h"
+#include "dixstruct.h"
+
+#define NRESOURCES      100000
+#define LOOKUP_ROUNDS   10
+
+static RESTYPE typeA, typeB;
+static int freed;
+static pointer freed_order[4];
+
+static int
+resource_delete(pointer value, XID id)
+{
+    if (freed < ARRAY_SIZE(freed_order))
+        freed_order[freed] = value;
+    freed++;
+    return Success;
+}
+
+static ClientPtr
+resource_setup(void)
+{
+    ClientPtr client;
+
+    serverClient = calloc(1, sizeof(ClientRec));
+    assert(serverClient);
+    clients[0] = serverClient;
+    assert(InitClientResources(serverClient));
+
+    typeA = CreateNewResourceType(resource_delete, "ResourceTestA");
+    typeB = CreateNewResourceType(resource_delete, "ResourceTestB");
+    assert(typeA && typeB);
+
+    client = calloc(1, sizeof(ClientRec));
+    assert(client);
+    client->index = 1;
+    client->clientAsMask = ((Mask) 1) << CLIENTOFFSET;
+    clients[1] = client;
+    currentMaxClients = 2;
+    assert(InitClientResources(client));
+    return client;
+}
+
+static void
+resource_benchmark(ClientPtr client)
+{
+    XID base = client->clientAsMask;
+    CARD64 start, micros;
+    pointer value;
+    int i, round;
+
+    freed = 0;
+    start = GetTimeInMicros();
+    for (i = 0; i < NRESOURCES; i++)
+        assert(AddResource(base + i, typeA, (pointer) (intptr_t) (i + 1)));
+    micros = GetTimeInMicros() - start;
+    printf("added %d resources in %llu us\n", NRESOURCES,
+           (unsigned long long) micros);
+
+    start = GetTimeInMicros();
+    for (round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (i = 0; i < NRESOURCES; i++) {
+            assert(dixLookupResourceByType(&value, base + i, typeA,
+                                           NULL, DixReadAccess) == Success);
+            assert(value == (pointer) (intptr_t) (i + 1));
+        }
+    }
+    micros = GetTimeInMicros() - start;
+    printf("%d lookups in %llu us, %.1f ns each\n",
+           NRESOURCES * LOOKUP_ROUNDS, (unsigned long long) micros,
+           micros * 1000.0 / (NRESOURCES * LOOKUP_ROUNDS));
+
+    /* misses, by id and by type */
+    for (i = NRESOURCES; i < 2 * NRESOURCES; i++)
+        assert(dixLookupResourceByType(&value, base + i, typeA,
+                                       NULL, DixReadAccess) == BadValue);
+    assert(dixLookupResourceByType(&value, base, typeB,
+                                   NULL, DixReadAccess) == BadValue);
+    assert(value == NULL);
+
+    /* free every other one by id, the rest with the client */
+    for (i = 0; i < NRESOURCES; i += 2)
+        FreeResource(base + i, RT_NONE);
+    assert(freed == NRESOURCES / 2);
+    for (i = 0; i < NRESOURCES; i++)
+        assert((dixLookupResourceByType(&value, base + i, typeA, NULL,
+                                        DixReadAccess) == Success) == (i & 1));
+}
+
+static void
+resource_same_id(ClientPtr client)
+{
+    XID id = client->clientAsMask | 0x1234;
+    pointer value;
+    int i;
+
+    /* grow the table while the id is being added */
+    for (i = 0; i < 3000; i++) {
+        if (i == 1000)
+            assert(AddResource(id, typeA, (pointer) 1));
+        if (i == 2000)
+            assert(AddResource(id, typeB, (pointer) 2));
+        assert(AddResource(client->clientAsMask | (0x100000 + i), typeB,
+                           (pointer) 4));
+    }
+    assert(AddResource(id, typeA, (pointer) 3));
+
+    assert(dixLookupResourceByType(&value, id, typeA, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (pointer) 3);
+    assert(dixLookupResourceByType(&value, id, typeB, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (pointer) 2);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == Success);
+    assert(value == (pointer) 3);
+
+    assert(ChangeResourceValue(id, typeA, (pointer) 5));
+    FreeResourceByType(id, typeA, TRUE);
+    assert(dixLookupResourceByType(&value, id, typeA, NULL,
+                                   DixReadAccess) == Success);
+    assert(value == (pointer) 1);
+    assert(AddResource(id, typeA, (pointer) 3));
+
+    freed = 0;
+    FreeResource(id, RT_NONE);
+    assert(freed == 3);
+    assert(freed_order[0] == (pointer) 3);
+    assert(freed_order[1] == (pointer) 2);
+    assert(freed_order[2] == (pointer) 1);
+    assert(dixLookupResourceByClass(&value, id, RC_ANY, NULL,
+                                    DixReadAccess) == BadValue);
+}
+
+static void
+resource_count(pointer value, XID id, pointer cdata)
+{
+    (*(int *) cdata)++;
+}
+
+static void
+resource_free_found(pointer value, XID id, pointer cdata)
+{
+    (*(int *) cdata)++;
+    FreeResource(id, RT_NONE);
+}
+
+static void
+resource_iterate(ClientPtr client)
+{
+    int count;
+
+    count = 0;
+    FindClientResourcesByType(client, typeA, resource_count, &count);
+    assert(count == NRESOURCES / 2);
+
+    /* freeing the resource found does not make the walk skip any */
+    count = 0;
+    freed = 0;
+    FindClientResourcesByType(client, typeB, resource_free_found, &count);
+    assert(count == 3000);
+    assert(freed == 3000);
+
+    count = 0;
+    FindClientResourcesByType(client, 0, resource_count, &count);
+    assert(count == NRESOURCES / 2);
+
+    freed = 0;
+    FreeClientResources(client);
+    assert(freed == NRESOURCES / 2);
+}
+
+int
+main(int argc, char **argv)
+{
+    ClientPtr client = resource_setup();
+
+    resource_benchmark(client);
+    resource_same_id(client);
+    resource_iterate(client);
+
+    return 0;
+}
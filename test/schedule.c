@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Scheduler benchmark: simulates an interactive client, which wakes up
+ * every frame and needs a little server time, competing with a number
+ * of clients flooding the server with requests.  Reports how long the
+ * interactive client waits before it is dispatched and how the flooding
+ * clients share the server according to their weights.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc.h"
+#include "dixstruct.h"
+
+#define SIM_MICROS      (10 * 1000000)  /* simulated run time */
+#define FRAME_MICROS    16667           /* interactive client period */
+#define REPLY_MICROS    200             /* work per interactive wakeup */
+#define INTERACTIVE     1               /* client index */
+
+struct sched_result {
+    unsigned long wakeups;
+    CARD64 total_latency;
+    CARD64 max_latency;
+    CARD64 busy[MAXCLIENTS];
+};
+
+static void
+sched_setup(int nclients)
+{
+    int i;
+
+    for (i = 1; i <= nclients; i++) {
+        clients[i] = calloc(1, sizeof(ClientRec));
+        assert(clients[i]);
+        clients[i]->index = i;
+        clients[i]->smart_weight = SMART_DEFAULT_WEIGHT;
+    }
+    currentMaxClients = nclients + 1;
+    SmartScheduleTime = 0;
+    SmartScheduleSlice = SmartScheduleInterval;
+}
+
+static void
+sched_teardown(int nclients)
+{
+    int i;
+
+    for (i = 1; i <= nclients; i++) {
+        free(clients[i]);
+        clients[i] = NULL;
+    }
+}
+
+/* clients 2 .. nflood + 1 always have requests queued and use up their
+ * whole slice every time they run.  Latency is only measured once all
+ * of them had their first turn, as they all connect at the same time. */
+static void
+sched_simulate(int nflood, struct sched_result *res)
+{
+    int ready[MAXCLIENTS];
+    CARD64 now = 0, wake = FRAME_MICROS, run, warmup;
+    int i, n, pick;
+
+    warmup = (CARD64) (nflood + 1) * SmartScheduleInterval * 1000;
+
+    while (now < warmup + SIM_MICROS) {
+        n = 0;
+        if (now >= wake)
+            ready[n++] = INTERACTIVE;
+        for (i = 0; i < nflood; i++)
+            ready[n++] = INTERACTIVE + 1 + i;
+        if (!n) {
+            now = wake;
+            continue;
+        }
+
+        SmartScheduleTime = now / 1000;
+        pick = SmartScheduleClient(ready, n);
+        if (pick == INTERACTIVE) {
+            if (wake >= warmup) {
+                res->wakeups++;
+                res->total_latency += now - wake;
+                if (now - wake > res->max_latency)
+                    res->max_latency = now - wake;
+            }
+            run = REPLY_MICROS;
+            while (wake <= now)
+                wake += FRAME_MICROS;
+        }
+        else
+            run = (CARD64) SmartScheduleSlice * 1000;
+
+        SmartScheduleAccount(clients[pick], run);
+        res->busy[pick] += run;
+        now += run;
+    }
+}
+
+static void
+sched_latency(void)
+{
+    /* beyond about 80 flooders the interactive client would need more
+     * than its fair share and gets throttled like everybody else */
+    static const int floods[] = { 1, 2, 4, 16, 64 };
+    struct sched_result *res;
+    int i;
+
+    printf("flooders  wakeups  avg latency  max latency\n");
+    for (i = 0; i < ARRAY_SIZE(floods); i++) {
+        res = calloc(1, sizeof(*res));
+        assert(res);
+        sched_setup(floods[i] + 1);
+        sched_simulate(floods[i], res);
+        sched_teardown(floods[i] + 1);
+
+        printf("%8d %8lu %9llu us %9llu us\n", floods[i], res->wakeups,
+               (unsigned long long) (res->total_latency / res->wakeups),
+               (unsigned long long) res->max_latency);
+
+        /* the interactive client never misses more than one slice,
+         * however many clients are flooding */
+        assert(res->max_latency <= SmartScheduleInterval * 1000);
+        free(res);
+    }
+}
+
+static void
+sched_weights(void)
+{
+    struct sched_result *res;
+    const int nflood = 4;
+    double share;
+    int i;
+
+    res = calloc(1, sizeof(*res));
+    assert(res);
+    sched_setup(nflood + 1);
+    /* the first flooder is worth two of the others */
+    clients[INTERACTIVE + 1]->smart_weight = 2 * SMART_DEFAULT_WEIGHT;
+    sched_simulate(nflood, res);
+
+    for (i = 2; i <= nflood; i++) {
+        share = (double) res->busy[INTERACTIVE + 1] /
+            res->busy[INTERACTIVE + i];
+        printf("weight %u vs %u: %.2f times the server time\n",
+               clients[INTERACTIVE + 1]->smart_weight,
+               clients[INTERACTIVE + i]->smart_weight, share);
+        assert(share > 1.9 && share < 2.1);
+    }
+    sched_teardown(nflood + 1);
+    free(res);
+}
+
+int
+main(int argc, char **argv)
+{
+    sched_latency();
+    sched_weights();
+
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Shadow update test: for every depth and rotation the update procs are
+ * run on random damage, with and without threads, and the frame buffer
+ * is compared pixel by pixel with where each shadow pixel must land.
+ * Built with -DBENCHMARK (shadow-bench) it also times a full screen
+ * update both ways.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/X.h>
+#include "misc.h"
+#include "os.h"
+#include "opaque.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "regionstr.h"
+#include "shadow.h"
+#include "tests.h"
+
+#define SHADOW_WIDTH    1920
+#define SHADOW_HEIGHT   1080
+#define BENCH_MICROS    200000
+#define SENTINEL        0xa5
+
+static ScreenRec screen;
+static PixmapRec shadow;
+static DamageRec damage;
+static shadowBufRec buf;
+
+static CARD8 *fb;
+static int fbStride;
+
+static void *
+shadow_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+              CARD32 *size, void *closure)
+{
+    *size = fbStride - offset;
+    return fb + row * fbStride + offset;
+}
+
+static CARD32
+shadow_pixel(CARD8 *line, int x, int bpp)
+{
+    switch (bpp) {
+    case 8:
+        return line[x];
+    case 16:
+        return ((CARD16 *) line)[x];
+    default:
+        return ((CARD32 *) line)[x];
+    }
+}
+
+/* where shadow pixel (x, y) goes in the frame buffer */
+static void
+shadow_map(int rotation, int x, int y, int *row, int *col)
+{
+    int w = SHADOW_WIDTH, h = SHADOW_HEIGHT;
+
+    switch (rotation) {
+    case 0:
+        *row = y;
+        *col = x;
+        break;
+    case 90:
+        *row = w - x - 1;
+        *col = y;
+        break;
+    case 180:
+        *row = h - y - 1;
+        *col = w - x - 1;
+        break;
+    default:
+        *row = x;
+        *col = h - y - 1;
+        break;
+    }
+}
+
+static void
+shadow_setup(int bpp, int rotation)
+{
+    int x, fbWidth, fbHeight;
+
+    shadow.drawable.type = DRAWABLE_PIXMAP;
+    shadow.drawable.bitsPerPixel = bpp;
+    shadow.drawable.width = SHADOW_WIDTH;
+    shadow.drawable.height = SHADOW_HEIGHT;
+    shadow.devKind = SHADOW_WIDTH * bpp / 8;
+    free(shadow.devPrivate.ptr);
+    shadow.devPrivate.ptr = malloc(shadow.devKind * SHADOW_HEIGHT);
+    assert(shadow.devPrivate.ptr);
+    for (x = 0; x < shadow.devKind * SHADOW_HEIGHT; x++)
+        ((CARD8 *) shadow.devPrivate.ptr)[x] = test_random(256);
+
+    screen.width = SHADOW_WIDTH;
+    screen.height = SHADOW_HEIGHT;
+
+    fbWidth = rotation == 90 || rotation == 270 ? SHADOW_HEIGHT : SHADOW_WIDTH;
+    fbHeight = rotation == 90 || rotation == 270 ? SHADOW_WIDTH : SHADOW_HEIGHT;
+    fbStride = fbWidth * bpp / 8;
+    free(fb);
+    fb = malloc(fbStride * fbHeight);
+    assert(fb);
+
+    buf.pDamage = &damage;
+    buf.pPixmap = &shadow;
+    buf.window = shadow_window;
+}
+
+static void
+shadow_check(ShadowUpdateProc update, int bpp, int rotation)
+{
+    static CARD8 inside[SHADOW_WIDTH * SHADOW_HEIGHT];
+    BoxRec boxes[8];
+    RegionRec region;
+    BoxPtr pbox;
+    int i, n, x, y, row, col;
+    int bytes = bpp / 8;
+
+    n = 1 + test_random(ARRAY_SIZE(boxes));
+    for (i = 0; i < n; i++) {
+        boxes[i].x1 = test_random(SHADOW_WIDTH);
+        boxes[i].y1 = test_random(SHADOW_HEIGHT);
+        boxes[i].x2 = boxes[i].x1 + 1 +
+            test_random(SHADOW_WIDTH - boxes[i].x1);
+        boxes[i].y2 = boxes[i].y1 + 1 +
+            test_random(SHADOW_HEIGHT - boxes[i].y1);
+    }
+    RegionInitBoxes(&region, boxes, n);
+    RegionCopy(&damage.damage, &region);
+    RegionUninit(&region);
+
+    memset(inside, 0, sizeof(inside));
+    pbox = RegionRects(&damage.damage);
+    for (n = RegionNumRects(&damage.damage); n--; pbox++)
+        for (y = pbox->y1; y < pbox->y2; y++)
+            memset(inside + y * SHADOW_WIDTH + pbox->x1, 1,
+                   pbox->x2 - pbox->x1);
+
+    memset(fb, SENTINEL, fbStride * (rotation == 90 || rotation == 270 ?
+                                     SHADOW_WIDTH : SHADOW_HEIGHT));
+    (*update) (&screen, &buf);
+
+    for (y = 0; y < SHADOW_HEIGHT; y++) {
+        CARD8 *line = (CARD8 *) shadow.devPrivate.ptr + y * shadow.devKind;
+
+        for (x = 0; x < SHADOW_WIDTH; x++) {
+            shadow_map(rotation, x, y, &row, &col);
+            if (inside[y * SHADOW_WIDTH + x]) {
+                assert(shadow_pixel(fb + row * fbStride, col, bpp) ==
+                       shadow_pixel(line, x, bpp));
+            }
+            else {
+                for (i = 0; i < bytes; i++)
+                    assert(fb[row * fbStride + col * bytes + i] == SENTINEL);
+            }
+        }
+    }
+}
+
+#ifdef BENCHMARK
+static double
+shadow_benchmark(ShadowUpdateProc update)
+{
+    BoxRec box = { 0, 0, SHADOW_WIDTH, SHADOW_HEIGHT };
+    CARD64 start, micros;
+    int n = 0;
+
+    RegionReset(&damage.damage, &box);
+    start = GetTimeInMicros();
+    do {
+        (*update) (&screen, &buf);
+        n++;
+    } while ((micros = GetTimeInMicros() - start) < BENCH_MICROS);
+    return (double) micros / n / 1000;
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        int bpp;
+        int rotation;
+        ShadowUpdateProc update;
+    } procs[] = {
+        {"Rotate8", 8, 0, shadowUpdateRotate8},
+        {"Rotate8_90", 8, 90, shadowUpdateRotate8_90},
+        {"Rotate8_180", 8, 180, shadowUpdateRotate8_180},
+        {"Rotate8_270", 8, 270, shadowUpdateRotate8_270},
+        {"Rotate16", 16, 0, shadowUpdateRotate16},
+        {"Rotate16_90", 16, 90, shadowUpdateRotate16_90},
+        {"Rotate16_180", 16, 180, shadowUpdateRotate16_180},
+        {"Rotate16_270", 16, 270, shadowUpdateRotate16_270},
+        {"Rotate32", 32, 0, shadowUpdateRotate32},
+        {"Rotate32_90", 32, 90, shadowUpdateRotate32_90},
+        {"Rotate32_180", 32, 180, shadowUpdateRotate32_180},
+        {"Rotate32_270", 32, 270, shadowUpdateRotate32_270},
+        {"Packed", 32, 0, shadowUpdatePacked},
+    };
+    int i, round;
+#ifdef BENCHMARK
+    double single, threaded;
+#endif
+
+    RegionNull(&damage.damage);
+
+    for (i = 0; i < ARRAY_SIZE(procs); i++) {
+        shadow_setup(procs[i].bpp, procs[i].rotation);
+
+        buf.threaded = FALSE;
+        for (round = 0; round < 8; round++)
+            shadow_check(procs[i].update, procs[i].bpp, procs[i].rotation);
+#ifdef BENCHMARK
+        single = shadow_benchmark(procs[i].update);
+#endif
+
+        renderThreads = 4;
+        buf.threaded = TRUE;
+        for (round = 0; round < 8; round++)
+            shadow_check(procs[i].update, procs[i].bpp, procs[i].rotation);
+#ifdef BENCHMARK
+        threaded = shadow_benchmark(procs[i].update);
+#endif
+        renderThreads = 1;
+
+#ifdef BENCHMARK
+        printf("%-12s %.2f ms per frame, %.2f ms with 4 threads\n",
+               procs[i].name, single, threaded);
+#endif
+    }
+
+    RegionUninit(&damage.damage);
+    free(shadow.devPrivate.ptr);
+    free(fb);
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * XYToWindow test: builds a tree of about 10000 windows and checks that
+ * XYToWindow finds the same windows as a plain walk of the sibling
+ * lists, also after windows were moved, restacked, mapped, unmapped and
+ * had their border width changed through ConfigureWindow and friends,
+ * so that a change dix/window.c forgets to invalidate the window index
+ * for shows up here.  Built with -DBENCHMARK (xytowindow-bench) it also
+ * times both for a stream of pointer positions.
+ *
+ * The tree is never realized, so mi only updates the geometry and
+ * leaves the clip lists alone.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "misc.h"
+#include "os.h"
+#include "privates.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "window.h"
+#include "inputstr.h"
+#include "input.h"
+#include "mi.h"
+#include "tests.h"
+
+#define SCREEN_WIDTH    3840
+#define SCREEN_HEIGHT   2160
+#define NTOPLEVELS      100
+#define NCHILDREN       100     /* per toplevel */
+#define NPOINTS         100000
+
+static ScreenRec screen;
+static ClientRec client;
+
+static Bool
+pick_position_window(WindowPtr pWin, int x, int y)
+{
+    return TRUE;
+}
+
+/* Links a new unmapped window on top of its siblings.  The whole tree
+ * is built before the first XYToWindow, so there is no index yet that
+ * could go stale. */
+static WindowPtr
+pick_window(WindowPtr pParent, int x, int y, int w, int h, int bw)
+{
+    WindowPtr pWin = dixAllocateScreenObjectWithPrivates(NULL, WindowRec,
+                                                         PRIVATE_WINDOW);
+
+    assert(pWin);
+    pWin->drawable.type = DRAWABLE_WINDOW;
+    pWin->drawable.class = InputOutput;
+    pWin->drawable.pScreen = &screen;
+    pWin->parent = pParent;
+    pWin->drawable.x = (pParent ? pParent->drawable.x : 0) + x + bw;
+    pWin->drawable.y = (pParent ? pParent->drawable.y : 0) + y + bw;
+    pWin->origin.x = x + bw;
+    pWin->origin.y = y + bw;
+    pWin->drawable.width = w;
+    pWin->drawable.height = h;
+    pWin->borderWidth = bw;
+    pWin->overrideRedirect = TRUE;
+    RegionNull(&pWin->clipList);
+    RegionNull(&pWin->borderClip);
+    RegionNull(&pWin->winSize);
+    RegionNull(&pWin->borderSize);
+    if (pParent) {
+        pWin->nextSib = pParent->firstChild;
+        if (pParent->firstChild)
+            pParent->firstChild->prevSib = pWin;
+        else
+            pParent->lastChild = pWin;
+        pParent->firstChild = pWin;
+        SetWinSize(pWin);
+        SetBorderSize(pWin);
+    }
+    return pWin;
+}
+
+/* the sibling walk XYToWindow did before it had an index */
+static WindowPtr
+pick_reference(WindowPtr pRoot, int x, int y)
+{
+    WindowPtr pWin = pRoot->firstChild, pFound = pRoot;
+
+    while (pWin) {
+        if (pWin->mapped &&
+            x >= pWin->drawable.x - (int) pWin->borderWidth &&
+            x < pWin->drawable.x + (int) pWin->drawable.width +
+            (int) pWin->borderWidth &&
+            y >= pWin->drawable.y - (int) pWin->borderWidth &&
+            y < pWin->drawable.y + (int) pWin->drawable.height +
+            (int) pWin->borderWidth) {
+            pFound = pWin;
+            pWin = pWin->firstChild;
+        }
+        else
+            pWin = pWin->nextSib;
+    }
+    return pFound;
+}
+
+static void
+pick_configure(WindowPtr pWin, Mask mask, XID *vlist)
+{
+    assert(ConfigureWindow(pWin, mask, vlist, &client) == Success);
+}
+
+static void
+pick_move(WindowPtr pWin, int dx, int dy)
+{
+    int bw = pWin->borderWidth;
+    XID vlist[2];
+
+    vlist[0] = pWin->origin.x - bw + dx;
+    vlist[1] = pWin->origin.y - bw + dy;
+    pick_configure(pWin, CWX | CWY, vlist);
+}
+
+static void
+pick_stack(WindowPtr pWin, int mode)
+{
+    XID vlist[1] = { mode };
+
+    pick_configure(pWin, CWStackMode, vlist);
+}
+
+/* CWBorderWidth alone keeps the outer corner in place and moves the
+ * window; with CWX and CWY keeping the inside in place it's a reborder */
+static void
+pick_reborder(WindowPtr pWin, int bw, Bool keepInside)
+{
+    int d = bw - (int) pWin->borderWidth;
+    XID vlist[3];
+
+    if (keepInside) {
+        vlist[0] = pWin->origin.x - pWin->borderWidth - d;
+        vlist[1] = pWin->origin.y - pWin->borderWidth - d;
+        vlist[2] = bw;
+        pick_configure(pWin, CWX | CWY | CWBorderWidth, vlist);
+    }
+    else {
+        vlist[0] = bw;
+        pick_configure(pWin, CWBorderWidth, vlist);
+    }
+    assert(pWin->borderWidth == bw);
+}
+
+/* points along the outer edge of the border of pWin */
+static void
+pick_check_border(SpritePtr pSprite, WindowPtr pRoot, WindowPtr pWin)
+{
+    int bw = pWin->borderWidth;
+    int x1 = pWin->drawable.x - bw, y1 = pWin->drawable.y - bw;
+    int x2 = pWin->drawable.x + pWin->drawable.width + bw - 1;
+    int y2 = pWin->drawable.y + pWin->drawable.height + bw - 1;
+    int x, y;
+
+    for (x = x1; x <= x2; x += 7) {
+        if (x < 0 || x >= SCREEN_WIDTH)
+            continue;
+        if (y1 >= 0)
+            assert(XYToWindow(pSprite, x, y1) ==
+                   pick_reference(pRoot, x, y1));
+        if (y2 < SCREEN_HEIGHT)
+            assert(XYToWindow(pSprite, x, y2) ==
+                   pick_reference(pRoot, x, y2));
+    }
+    for (y = y1; y <= y2; y += 7) {
+        if (y < 0 || y >= SCREEN_HEIGHT)
+            continue;
+        if (x1 >= 0)
+            assert(XYToWindow(pSprite, x1, y) ==
+                   pick_reference(pRoot, x1, y));
+        if (x2 < SCREEN_WIDTH)
+            assert(XYToWindow(pSprite, x2, y) ==
+                   pick_reference(pRoot, x2, y));
+    }
+}
+
+static void
+pick_check(SpritePtr pSprite, WindowPtr pRoot, int npoints)
+{
+    int i, x, y;
+
+    for (i = 0; i < npoints; i++) {
+        x = test_random(SCREEN_WIDTH);
+        y = test_random(SCREEN_HEIGHT);
+        assert(XYToWindow(pSprite, x, y) == pick_reference(pRoot, x, y));
+    }
+}
+
+#ifdef BENCHMARK
+static void
+pick_benchmark(SpritePtr pSprite, WindowPtr pRoot)
+{
+    CARD64 start, indexed, walked;
+    int i, x = 0, y = 0;
+    WindowPtr found = NULL;
+
+    /* a pointer wandering around in small steps, as motion events do */
+    start = GetTimeInMicros();
+    for (i = 0; i < NPOINTS; i++) {
+        x = (x + test_random(9) - 4 + SCREEN_WIDTH) % SCREEN_WIDTH;
+        y = (y + test_random(9) - 4 + SCREEN_HEIGHT) % SCREEN_HEIGHT;
+        found = XYToWindow(pSprite, x, y);
+    }
+    indexed = GetTimeInMicros() - start;
+
+    start = GetTimeInMicros();
+    for (i = 0; i < NPOINTS; i++) {
+        x = (x + test_random(9) - 4 + SCREEN_WIDTH) % SCREEN_WIDTH;
+        y = (y + test_random(9) - 4 + SCREEN_HEIGHT) % SCREEN_HEIGHT;
+        found = pick_reference(pRoot, x, y);
+    }
+    walked = GetTimeInMicros() - start;
+    assert(found);
+
+    printf("%d motion events: %.1f ns per XYToWindow, "
+           "%.1f ns per sibling walk\n", NPOINTS,
+           indexed * 1000.0 / NPOINTS, walked * 1000.0 / NPOINTS);
+}
+#endif
+
+int
+main(int argc, char **argv)
+{
+    SpriteRec sprite = { 0 };
+    WindowPtr pRoot, pTop, pChild, toplevels[NTOPLEVELS];
+    int i, j;
+
+    assert(InitWindowIndex());
+
+    screen.PositionWindow = pick_position_window;
+    screen.MoveWindow = miMoveWindow;
+    screen.ChangeBorderWidth = miChangeBorderWidth;
+
+    pRoot = pick_window(NULL, 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0);
+    pRoot->mapped = TRUE;
+    for (i = 0; i < NTOPLEVELS; i++) {
+        pTop = pick_window(pRoot, test_random(SCREEN_WIDTH - 400),
+                           test_random(SCREEN_HEIGHT - 300),
+                           200 + test_random(800), 150 + test_random(600),
+                           test_random(3));
+        toplevels[i] = pTop;
+        for (j = 0; j < NCHILDREN; j++)
+            MapWindow(pick_window(pTop, test_random(pTop->drawable.width),
+                                  test_random(pTop->drawable.height),
+                                  8 + test_random(64), 8 + test_random(32),
+                                  test_random(2)), &client);
+        /* a few are unmapped */
+        if (i % 10)
+            MapWindow(pTop, &client);
+    }
+
+    sprite.spriteTraceSize = 10;
+    sprite.spriteTrace = calloc(sprite.spriteTraceSize, sizeof(WindowPtr));
+    assert(sprite.spriteTrace);
+    sprite.spriteTrace[0] = pRoot;
+
+    pick_check(&sprite, pRoot, NPOINTS);
+#ifdef BENCHMARK
+    pick_benchmark(&sprite, pRoot);
+#endif
+
+    /* move, restack, map and unmap windows, as a window manager would */
+    for (i = 0; i < 200; i++) {
+        pTop = toplevels[test_random(NTOPLEVELS)];
+        pick_move(pTop, test_random(41) - 20, test_random(41) - 20);
+        pick_check(&sprite, pRoot, 100);
+        if (i % 3 == 0)
+            pick_stack(pTop, Above);
+        else if (i % 3 == 1)
+            pick_stack(pTop, Below);
+        if (i % 7 == 0)
+            pick_stack(pTop->lastChild, Above);
+        if (i % 11 == 0)
+            MoveWindowInStack(pTop->firstChild, NullWindow);
+        pick_check(&sprite, pRoot, 100);
+        pChild = pTop->firstChild;
+        pick_move(pChild, test_random(41) - 20, test_random(41) - 20);
+        pick_check(&sprite, pRoot, 100);
+        if (i % 5 == 0) {
+            UnmapWindow(pTop, FALSE);
+            pick_check(&sprite, pRoot, 100);
+            MapWindow(pTop, &client);
+        }
+        if (i % 13 == 0) {
+            UnmapWindow(pChild, FALSE);
+            pick_check(&sprite, pRoot, 100);
+        }
+        pick_check(&sprite, pRoot, 100);
+    }
+    pick_check(&sprite, pRoot, NPOINTS);
+
+    /* grow and shrink borders, of toplevels and of their children */
+    for (i = 0; i < 100; i++) {
+        pTop = toplevels[test_random(NTOPLEVELS)];
+        pick_stack(pTop, Above);
+        pick_check(&sprite, pRoot, 10);
+        pick_reborder(pTop, test_random(20), i % 2);
+        pick_check_border(&sprite, pRoot, pTop);
+        pick_reborder(pTop->firstChild, test_random(6), i % 3 == 0);
+        pick_check_border(&sprite, pRoot, pTop->firstChild);
+    }
+    pick_check(&sprite, pRoot, NPOINTS);
+
+    free(sprite.spriteTrace);
+    return 0;
+}